@@ -0,0 +1,26 @@
+#version 450
+
+layout(location = 0) out vec4 outColour;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColour;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
+} ubo;
+
+// Written by the G-buffer subpass (gbuffer.frag). See DeferredLightingSystem.
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inputAlbedo;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inputDepth;
+
+void main() {
+    // Nothing was drawn here: keep the clear colour
+    if (subpassLoad(inputDepth).x >= 1.f) {
+        discard;
+    }
+
+    // The light volumes add every light on top
+    outColour = vec4(subpassLoad(inputAlbedo).xyz * ubo.ambientLightColour.xyz * ubo.ambientLightColour.w, 1.f);
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// Model::Stream::POSITION: vec3 floats for FULL meshes, UNORM xyz (w is padding) for COMPACT ones, whose dequantisation
+// is folded into instance.modelMatrix. Either way only xyz is read.
+layout(location = 0) in vec4 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColour;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
+} ubo;
+
+// Same instance data as simple.vert, only the model matrix is read
+struct InstanceData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// The colour pass tests against this depth with EQUAL, so both must compute gl_Position the exact same way
+invariant gl_Position;
+
+void main() {
+    const InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+    const vec4 positionWorld = instance.modelMatrix * vec4(position.xyz, 1.f);
+
+    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * positionWorld;
+}
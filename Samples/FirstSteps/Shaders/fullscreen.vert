@@ -0,0 +1,7 @@
+#version 450
+
+// One triangle covering the screen: draw 3 vertices without any vertex input
+void main() {
+    const vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2.f - 1.f, 0.f, 1.f);
+}
@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec3 fragColour;
+layout(location = 1) in vec3 fragPosWS;
+layout(location = 2) in vec3 fragNormalWS;
+
+// Matches SwapChain::GBufferAttachment. Lighting happens in the next subpass (light_volume.frag).
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+    outAlbedo = vec4(fragColour, 1.f);
+    outNormal = vec4(normalize(fragNormalWS), 0.f);
+}
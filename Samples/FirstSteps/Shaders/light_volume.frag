@@ -0,0 +1,78 @@
+#version 450
+
+layout(location = 0) in vec4 fragClipPosition;
+layout(location = 1) flat in uint fragLightIndex;
+
+layout(location = 0) out vec4 outColour;
+
+// Matches PointLight in FrameInfo.h
+struct PointLight {
+    vec4 position; //w is the range
+    vec4 colour; //w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColour;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
+} ubo;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+} lightBuffer;
+
+// Written by the G-buffer subpass (gbuffer.frag). See DeferredLightingSystem.
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inputAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inputNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inputDepth;
+
+// The view space position behind this pixel, from its depth: solves depth = (P22 * z + P32) / (P23 * z + P33) for z,
+// then ndc * w = P00 * x + P20 * z + P30 (and the same for y). Works for both perspective and orthographic projections.
+vec3 reconstructViewPosition(const vec2 ndc, const float depth) {
+    const mat4 P = ubo.projectionMatrix;
+    const float z = (depth * P[3][3] - P[3][2]) / (P[2][2] - depth * P[2][3]);
+    const float w = P[2][3] * z + P[3][3];
+    return vec3((ndc.x * w - P[2][0] * z - P[3][0]) / P[0][0],
+                (ndc.y * w - P[2][1] * z - P[3][1]) / P[1][1],
+                z);
+}
+
+void main() {
+    const float depth = subpassLoad(inputDepth).x;
+    if (depth >= 1.f) {
+        discard;
+    }
+
+    const PointLight light = lightBuffer.lights[fragLightIndex];
+    const vec3 fragPosWS = (ubo.inverseViewMatrix * vec4(reconstructViewPosition(fragClipPosition.xy / fragClipPosition.w, depth), 1.f)).xyz;
+
+    vec3 directionToLight = light.position.xyz - fragPosWS;
+    const float distanceSquared = dot(directionToLight, directionToLight);
+    // Same falloff as simple.frag: exactly 0 at the range, which the volume covers
+    const float rangeRatio = distanceSquared / (light.position.w * light.position.w);
+    if (rangeRatio >= 1.f) {
+        discard;
+    }
+    const float window = 1.f - rangeRatio * rangeRatio;
+    const float attenuation = window * window / distanceSquared;
+    directionToLight = normalize(directionToLight);
+
+    const vec3 surfaceNormal = normalize(subpassLoad(inputNormal).xyz);
+    const vec3 cameraPosWS = ubo.inverseViewMatrix[3].xyz;
+    const vec3 viewDirection = normalize(cameraPosWS - fragPosWS);
+
+    const float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.f);
+    const vec3 intensity = light.colour.xyz * light.colour.w * attenuation;
+
+    vec3 halfAngle = normalize(directionToLight + viewDirection);
+    float blinnTerm = dot(surfaceNormal, halfAngle);
+    blinnTerm = clamp(blinnTerm, 0.f, 1.f);
+    blinnTerm = pow(blinnTerm, 512.f);
+
+    // Added onto the ambient term (ONE, ONE blending)
+    const vec3 albedo = subpassLoad(inputAlbedo).xyz;
+    outColour = vec4((intensity * cosAngIncidence + intensity * blinnTerm) * albedo, 0.f);
+}
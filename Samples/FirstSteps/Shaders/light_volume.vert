@@ -0,0 +1,63 @@
+#version 450
+
+// A cube around every light's sphere of influence: 6 faces of 2 triangles, from gl_VertexIndex
+const vec2 FACE_CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0),
+    vec2(1.0, -1.0),
+    vec2(1.0, 1.0),
+    vec2(-1.0, -1.0),
+    vec2(1.0, 1.0),
+    vec2(-1.0, 1.0)
+);
+
+layout(location = 0) out vec4 fragClipPosition;
+layout(location = 1) flat out uint fragLightIndex;
+
+// Matches PointLight in FrameInfo.h
+struct PointLight {
+    vec4 position; //w is the range
+    vec4 colour; //w is intensity
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColour;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
+} ubo;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+} lightBuffer;
+
+void main() {
+    const PointLight light = lightBuffer.lights[gl_InstanceIndex];
+    const uint face = uint(gl_VertexIndex) / 6u;
+    const uint axis = face / 2u;
+    const float side = (face & 1u) != 0u ? 1.f : -1.f;
+    const vec2 corner = FACE_CORNERS[gl_VertexIndex % 6];
+
+    vec3 offset = vec3(0.f);
+    offset[axis] = side;
+    offset[(axis + 1u) % 3u] = corner.x;
+    offset[(axis + 2u) % 3u] = corner.y;
+
+    // Only the faces seen from inside are lit, so every covered pixel is shaded once whether or not the camera is in
+    // the volume. The test is done here rather than with face culling, so it doesn't depend on the cube's winding.
+    const vec3 cameraPosWS = ubo.inverseViewMatrix[3].xyz;
+    vec3 faceNormal = vec3(0.f);
+    faceNormal[axis] = side;
+    if (dot(cameraPosWS - (light.position.xyz + faceNormal * light.position.w), faceNormal) > 0.f) {
+        // Collapsed to a point: nothing gets rasterised
+        gl_Position = vec4(0.f, 0.f, 0.f, 1.f);
+        fragClipPosition = gl_Position;
+        fragLightIndex = gl_InstanceIndex;
+        return;
+    }
+
+    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * vec4(light.position.xyz + offset * light.position.w, 1.f);
+    fragClipPosition = gl_Position;
+    fragLightIndex = gl_InstanceIndex;
+}
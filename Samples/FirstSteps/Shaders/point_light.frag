@@ -1,29 +1,20 @@
 #version 450
 
 layout(location = 0) in vec2 fragOffset;
+layout(location = 1) flat in vec4 fragColour;
 
 layout(location = 0) out vec4 outColour;
 
-struct PointLight {
-    vec4 position; //w is unused
-    vec4 colour; //w is intensity
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projectionMatrix;
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColour;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 colour;
-    float radius;
-} push;
-
+const float PI = 3.14159265;
 
 void main() {
     const float dist = sqrt(dot(fragOffset, fragOffset));
@@ -31,5 +22,6 @@ void main() {
         discard;
     }
 
-    outColour = vec4(push.colour.rgb, 1.f);
+    // Fades out towards the edge; blended, so the billboards are drawn back to front
+    outColour = vec4(fragColour.rgb, 0.5 * (cos(dist * PI) + 1.0));
 }
@@ -10,35 +10,37 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout(location = 0) out vec2 fragOffset;
-
-struct PointLight {
-    vec4 position; //w is unused
-    vec4 colour; //w is intensity
-};
+layout(location = 1) flat out vec4 fragColour;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projectionMatrix;
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColour;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    vec4 position;
-    vec4 colour;
-    float radius;
-} push;
+// Matches PointLightSystem::LightInstance, sorted back to front
+struct LightInstance {
+    vec4 position; //w is the billboard radius
+    vec4 colour; //w is intensity
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer LightBuffer {
+    LightInstance lights[];
+} lightBuffer;
 
 void main() {
+    const LightInstance light = lightBuffer.lights[gl_InstanceIndex];
     fragOffset = OFFSETS[gl_VertexIndex];
+    fragColour = light.colour;
     const vec3 cameraRightWorld = { ubo.viewMatrix[0][0], ubo.viewMatrix[1][0] , ubo.viewMatrix[2][0] };
     const vec3 cameraUpWorld = { ubo.viewMatrix[0][1], ubo.viewMatrix[1][1] , ubo.viewMatrix[2][1] };
 
-    const vec3 positionWorld = push.position.xyz +
-                               push.radius * fragOffset.x * cameraRightWorld +
-                               push.radius * fragOffset.y * cameraUpWorld;
+    const vec3 positionWorld = light.position.xyz +
+                               light.position.w * fragOffset.x * cameraRightWorld +
+                               light.position.w * fragOffset.y * cameraUpWorld;
 
     gl_Position = ubo.projectionMatrix * ubo.viewMatrix * vec4(positionWorld, 1.f);
 }
@@ -6,8 +6,9 @@ layout(location = 2) in vec3 fragNormalWS;
 
 layout(location = 0) out vec4 outColour;
 
+// Matches PointLight in FrameInfo.h
 struct PointLight {
-    vec4 position; //w is unused
+    vec4 position; //w is the range
     vec4 colour; //w is intensity
 };
 
@@ -16,14 +17,27 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColour;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+} lightBuffer;
+
+// Per cluster [offset, count] pairs, then the light indices they point into (LightClusters::getClusterData())
+layout(std430, set = 0, binding = 2) readonly buffer ClusterBuffer {
+    uint data[];
+} clusterBuffer;
+
+// Same mapping as LightClusters::findCluster()
+uint findCluster(vec3 positionWS) {
+    const float viewDepth = (ubo.viewMatrix * vec4(positionWS, 1.f)).z;
+    const float sliceDepth = ubo.clusterGrid.w != 0u ? log(max(viewDepth, 1e-6f)) : viewDepth;
+    const vec3 cluster = floor(vec3(gl_FragCoord.xy * ubo.clusterScale.xy, sliceDepth * ubo.clusterScale.z + ubo.clusterScale.w));
+    const uvec3 index = uvec3(clamp(cluster, vec3(0.f), vec3(ubo.clusterGrid.xyz - 1u)));
+    return (index.z * ubo.clusterGrid.y + index.y) * ubo.clusterGrid.x + index.x;
+}
 
 void main() {
     vec3 diffuseLight = ubo.ambientLightColour.rgb * ubo.ambientLightColour.w;
@@ -33,11 +47,19 @@ void main() {
     vec3 cameraPosWS = ubo.inverseViewMatrix[3].xyz;
     vec3 viewDirection = normalize(cameraPosWS - fragPosWS);
 
-    for (int i = 0; i < ubo.numLights; ++i) {
-        PointLight light = ubo.pointLights[i];
+    // Only the lights that reach this fragment's cluster
+    const uint cluster = findCluster(fragPosWS);
+    const uint lightOffset = clusterBuffer.data[2u * cluster];
+    const uint lightCount = clusterBuffer.data[2u * cluster + 1u];
+    for (uint i = 0u; i < lightCount; ++i) {
+        PointLight light = lightBuffer.lights[clusterBuffer.data[lightOffset + i]];
         
         vec3 directionToLight = light.position.xyz - fragPosWS.xyz;
-        const float attenuation = 1.f / dot(directionToLight, directionToLight); //distance squared
+        const float distanceSquared = dot(directionToLight, directionToLight);
+        // Windowed down to exactly 0 at the range, past which the light isn't in the cluster lists
+        const float rangeRatio = distanceSquared / (light.position.w * light.position.w);
+        const float window = clamp(1.f - rangeRatio * rangeRatio, 0.f, 1.f);
+        const float attenuation = window * window / distanceSquared;
         directionToLight = normalize(directionToLight);
 
         const float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0.f);
@@ -9,29 +9,33 @@ layout(location = 0) out vec3 fragColour;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWS;
 
-struct PointLight {
-    vec4 position; //w is unused
-    vec4 colour; //w is intensity
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projectionMatrix;
     mat4 viewMatrix;
     mat4 inverseViewMatrix;
     vec4 ambientLightColour;
-    PointLight pointLights[10];
-    int numLights;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
 } ubo;
 
-layout(push_constant) uniform Push {
+// One entry per drawn object, written by SimpleRenderSystem every frame. gl_InstanceIndex includes firstInstance.
+struct InstanceData {
     mat4 modelMatrix;
     mat4 normalMatrix;
-} push;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// Must match depth_only.vert bit for bit: the colour pass tests EQUAL against a depth pre-pass
+invariant gl_Position;
 
 void main() {
-    const vec4 positionWorld = push.modelMatrix * vec4(position, 1.f);
+    const InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+    const vec4 positionWorld = instance.modelMatrix * vec4(position, 1.f);
 
-    fragNormalWS = normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWS = normalize(mat3(instance.normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColour = colour;
 
@@ -0,0 +1,53 @@
+#version 450
+
+// CompactVertex layout: UNORM positions relative to the mesh bounds (the dequantisation is folded into
+// instance.modelMatrix), octahedral encoded normals, 8 bit colours and half float UVs.
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 colour;
+layout(location = 2) in vec2 normalOct;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColour;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWS;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionMatrix;
+    mat4 viewMatrix;
+    mat4 inverseViewMatrix;
+    vec4 ambientLightColour;
+    uvec4 clusterGrid; //xyz: cluster grid size, w: 1 if depth slices are logarithmic
+    vec4 clusterScale; //xy: clusters per pixel, zw: depth slice scale and bias
+} ubo;
+
+// One entry per drawn object, written by SimpleRenderSystem every frame. gl_InstanceIndex includes firstInstance.
+struct InstanceData {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    InstanceData instances[];
+} instanceBuffer;
+
+// Must match depth_only.vert bit for bit: the colour pass tests EQUAL against a depth pre-pass
+invariant gl_Position;
+
+vec3 decodeOctahedral(const vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+    const float fold = max(-normal.z, 0.f);
+    normal.x += normal.x >= 0.f ? -fold : fold;
+    normal.y += normal.y >= 0.f ? -fold : fold;
+    return normalize(normal);
+}
+
+void main() {
+    const InstanceData instance = instanceBuffer.instances[gl_InstanceIndex];
+    const vec4 positionWorld = instance.modelMatrix * vec4(position.xyz, 1.f);
+
+    fragNormalWS = normalize(mat3(instance.normalMatrix) * decodeOctahedral(normalOct));
+    fragPosWorld = positionWorld.xyz;
+    fragColour = colour.rgb;
+
+    gl_Position = ubo.projectionMatrix * ubo.viewMatrix * positionWorld;
+}
@@ -1,8 +1,15 @@
 #include "Application.h"
 #include "Renderer/SimpleRenderSystem.h"
 #include "Renderer/PointLightSystem.h"
+#include "Renderer/GpuCullingSystem.h"
+#include "Renderer/DepthPyramid.h"
+#include "Renderer/DeferredLightingSystem.h"
 #include "Utilities/Camera.h"
 #include "Utilities/Buffer.h"
+#include "Utilities/UploadManager.h"
+#include "Utilities/GeometryArena.h"
+#include "Utilities/OcclusionRasterizer.h"
+#include "Utilities/GpuTimer.h"
 #include "Engine/KeyboardInputController.h"
 
 #define GLM_FORCE_RADIANS
@@ -13,17 +20,52 @@
 #include <stdexcept>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
 
 constexpr bool USE_ORTHO = false;
 constexpr float MAX_FRAME_TIME = 0.33f;
+constexpr float STATS_INTERVAL = 1.f;
+// Extra vases laid out on a grid to stress per-object CPU costs. Compare "objects" (one draw each without
+// instancing) against "draw calls" in the stats output, e.g. with 10000.
+constexpr uint32_t STRESS_OBJECT_COUNT = 0u;
+// Extra dim lights on rings just above the scene, e.g. 4000. They are clustered, so shading cost follows how many
+// reach each pixel rather than the total; compare the "Lights" stats line. The billboards draw in one instanced draw.
+constexpr uint32_t STRESS_LIGHT_COUNT = 0u;
+// Draw the scene from GPU side draw commands (one indirect draw per batch) instead of walking it on the CPU
+constexpr bool USE_INDIRECT_RENDERING = false;
+// Repeat the GPU's frustum culling on the CPU and report frames where the visible counts differ
+constexpr bool VALIDATE_GPU_CULLING = false;
+// Two-phase Hi-Z occlusion culling on top of the GPU frustum culling. Needs USE_INDIRECT_RENDERING.
+constexpr bool USE_OCCLUSION_CULLING = false;
+// A wall between the camera and the stress grid, so most of STRESS_OBJECT_COUNT is occluded. Compare "occluded" and
+// "triangles" in the stats output with USE_OCCLUSION_CULLING on and off.
+constexpr bool OCCLUSION_STRESS_WALL = false;
+// Rasterise occluders (GameObject::_isOccluder) on the CPU and skip the objects they hide. Direct rendering only: the
+// CPU alternative to USE_OCCLUSION_CULLING.
+constexpr bool USE_SOFTWARE_OCCLUSION = false;
+constexpr uint32_t SOFTWARE_OCCLUSION_WIDTH = 320u;
+constexpr uint32_t SOFTWARE_OCCLUSION_HEIGHT = 192u;
+// Write albedo and normals to a transient G-buffer, then light it in a second subpass with one volume per light instead
+// of the clustered forward shading. Compare the "GPU time" stats line. Turns off USE_OCCLUSION_CULLING, whose two
+// render passes are forward only. Only the default: --forward / --deferred on the command line pick one at startup.
+constexpr bool USE_DEFERRED_SHADING = false;
+// Lay down depth from position only vertex streams first, then shade with an EQUAL depth test so overdraw costs no
+// fragment shading. Direct rendering only; models only get the extra streams when it's on. Compare the "forward" (or
+// "G-buffer") entry of the "GPU time" stats line with it on and off: it wins once shading saved outweighs the extra
+// geometry pass.
+constexpr bool USE_DEPTH_PREPASS = false;
 
 namespace Divide {
 
     Application::Application()
+        : _deferredShading(USE_DEFERRED_SHADING)
     {
         _globalPoolPtr = DescriptorPool::Builder(_device)
-            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .setMaxSets(1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 2)
             .build();
 
         loadGameObjects();
@@ -34,32 +76,52 @@ namespace Divide {
     }
 
     void Application::run() {
-        std::vector<std::unique_ptr<Buffer>> uboBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < uboBuffers.size(); ++i) {
-            uboBuffers[i] = std::make_unique<Buffer>(
-                _device,
-                sizeof(GlobalUbo),
-                1,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            );
-            uboBuffers[i]->map();
-        }
-
+        // Every frame's GlobalUbo and lights live in the frame allocator, so a single set serves all frames in flight.
+        // Bindings follow GlobalBinding.
         auto globalSetLayout = DescriptorSetLayout::Builder(_device)
-            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
             .build();
 
-        std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < globalDescriptorSets.size(); ++i) {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
+        VkDescriptorSet globalDescriptorSet = VK_NULL_HANDLE;
+        {
+            auto uboInfo = _frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+            // Runtime sized arrays, so as much as a frame could ever allocate
+            auto storageInfo = _frameAllocator.descriptorInfo(_frameAllocator.getStats().frameCapacity);
             DescriptorWriter(*globalSetLayout, *_globalPoolPtr)
-                .writeBuffer(0, &bufferInfo)
-                .build(globalDescriptorSets[i]);
+                .writeBuffer(0, &uboInfo)
+                .writeBuffer(1, &storageInfo)
+                .writeBuffer(2, &storageInfo)
+                .build(globalDescriptorSet);
         }
 
-        SimpleRenderSystem simpleRenderSystem{ _device, _renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
-        PointLightSystem pointLightSystem{ _device, _renderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+        // Before anything is created against the render passes
+        _renderer.setDeferredShading(_deferredShading);
+        const bool deferredShading = _renderer.isDeferredShadingEnabled();
+        const VkRenderPass sceneRenderPass = deferredShading ? _renderer.getDeferredRenderPass() : _renderer.getSwapChainRenderPass();
+
+        SimpleRenderSystem simpleRenderSystem{ _device, sceneRenderPass, globalSetLayout->getDescriptorSetLayout(), _frameAllocator, _gpuScene, deferredShading };
+        if constexpr (USE_INDIRECT_RENDERING) {
+            simpleRenderSystem.setRenderMode(SimpleRenderSystem::RenderMode::INDIRECT);
+        }
+        simpleRenderSystem.setDepthPrePass(USE_DEPTH_PREPASS);
+        DepthPyramid depthPyramid{ _device, SwapChain::MAX_FRAMES_IN_FLIGHT };
+        GpuCullingSystem gpuCullingSystem{ _device, _gpuScene, depthPyramid, _frameAllocator, SwapChain::MAX_FRAMES_IN_FLIGHT };
+        gpuCullingSystem.setValidation(VALIDATE_GPU_CULLING);
+        gpuCullingSystem.setOcclusionCulling(USE_OCCLUSION_CULLING && USE_INDIRECT_RENDERING && !deferredShading);
+        std::unique_ptr<OcclusionRasterizer> occlusionRasterizer{};
+        if constexpr (USE_SOFTWARE_OCCLUSION) {
+            occlusionRasterizer = std::make_unique<OcclusionRasterizer>(SOFTWARE_OCCLUSION_WIDTH, SOFTWARE_OCCLUSION_HEIGHT);
+        }
+        PointLightSystem pointLightSystem{ _device, sceneRenderPass, globalSetLayout->getDescriptorSetLayout(), _frameAllocator, deferredShading ? SwapChain::LIGHTING_SUBPASS : 0u };
+        // The light volumes find their lights themselves; only forward shading walks the clusters
+        pointLightSystem.setClustering(!deferredShading);
+        std::unique_ptr<DeferredLightingSystem> deferredLightingSystem{};
+        if (deferredShading) {
+            deferredLightingSystem = std::make_unique<DeferredLightingSystem>(_device, sceneRenderPass, globalSetLayout->getDescriptorSetLayout(), SwapChain::MAX_FRAMES_IN_FLIGHT);
+        }
+        GpuTimer gpuTimer{ _device, SwapChain::MAX_FRAMES_IN_FLIGHT };
         Camera camera{};
 
         auto viewerObject = GameObject::CreateGameObject();
@@ -67,6 +129,9 @@ namespace Divide {
         KeyboardInputController cameraController{};
 
         auto currentTime = std::chrono::high_resolution_clock::now();
+        float statsTimer = 0.f;
+        bool firstFrame = true;
+        bool allModelsResident = false;
 
         while (!_window.shouldClose()) {
             glfwPollEvents();
@@ -77,6 +142,13 @@ namespace Divide {
 
             frameTime = glm::min(frameTime, MAX_FRAME_TIME);
 
+            _modelLoader.update();
+            if (!allModelsResident && _modelLoader.getPendingCount() == 0u) {
+                allModelsResident = true;
+                std::cout << "All models resident after " << getElapsedMS() << " ms" << std::endl;
+                printModelStats();
+            }
+
             cameraController.moveInPlaneXZ(_window.getGLFWWindow(), frameTime, viewerObject);
             camera.setViewYXZ(viewerObject._transform.translation, viewerObject._transform.rotation);
 
@@ -89,13 +161,26 @@ namespace Divide {
 
             if (auto commandBuffer = _renderer.beginFrame()) {
                 const int frameIndex = _renderer.getFrameIndex();
+                // beginFrame() waited on this frame's fence, so its transient data can be overwritten
+                _frameAllocator.beginFrame(frameIndex);
+                _device.getGeometryArena().beginFrame(static_cast<uint32_t>(frameIndex));
+                gpuTimer.beginFrame(commandBuffer, static_cast<uint32_t>(frameIndex));
+                const FrameAllocator::Slice uboSlice = _frameAllocator.allocate(sizeof(GlobalUbo), FrameAllocator::Usage::UNIFORM);
+
+                RenderStats stats{};
+                // Only the frames that get printed pay for the extra bookkeeping
+                stats.countUnsortedBinds = statsTimer + frameTime >= STATS_INTERVAL;
                 FrameInfo frameInfo{
                     frameIndex,
                     frameTime,
                     commandBuffer,
                     camera,
-                    globalDescriptorSets[frameIndex],
-                    _gameObjects
+                    globalDescriptorSet,
+                    { uboSlice.offset, 0u, 0u },
+                    _frameAllocator,
+                    _gameObjects,
+                    _renderer.getSwapChainExtent(),
+                    stats
                 };
                 
                 // update
@@ -105,25 +190,181 @@ namespace Divide {
                 ubo.inverseViewMatrix = camera.getInverseView();
 
                 pointLightSystem.update(frameInfo, ubo);
+                const bool indirect = simpleRenderSystem.getRenderMode() == SimpleRenderSystem::RenderMode::INDIRECT;
+                const bool occlusionCulling = indirect && gpuCullingSystem.isOcclusionCullingEnabled();
+                if (indirect) {
+                    _gpuScene.update(static_cast<uint32_t>(frameIndex), _gameObjects);
+                    if (occlusionCulling) {
+                        // May wait for the device to idle, so before anything references the pyramid
+                        depthPyramid.setExtent(_renderer.getSwapChainExtent());
+                    }
+                    // Writes the draw commands, so it has to come before the render pass
+                    gpuTimer.beginScope(commandBuffer, "culling");
+                    gpuCullingSystem.cull(frameInfo);
+                    gpuTimer.endScope(commandBuffer);
+                } else if (occlusionRasterizer != nullptr) {
+                    rasterizeOccluders(*occlusionRasterizer, camera);
+                }
+                simpleRenderSystem.setOcclusionRasterizer(indirect ? nullptr : occlusionRasterizer.get());
 
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+                std::memcpy(uboSlice.mapped, &ubo, sizeof(GlobalUbo));
                 
                 // render
-                _renderer.beginSwapChainRenderPass(commandBuffer);
-                simpleRenderSystem.renderGameObjects(frameInfo);
-                pointLightSystem.render(frameInfo);
-                _renderer.endSwapChainRenderPass(commandBuffer);
+                if (deferredShading) {
+                    _renderer.beginDeferredRenderPass(commandBuffer);
+                    gpuTimer.beginScope(commandBuffer, "G-buffer");
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                    gpuTimer.endScope(commandBuffer);
+
+                    _renderer.nextSubpass(commandBuffer);
+                    gpuTimer.beginScope(commandBuffer, "lighting");
+                    const DeferredLightingSystem::GBufferViews gBuffer{
+                        _renderer.getCurrentGBufferImageView(SwapChain::GBufferAttachment::ALBEDO),
+                        _renderer.getCurrentGBufferImageView(SwapChain::GBufferAttachment::NORMAL),
+                        _renderer.getCurrentDepthImageView()
+                    };
+                    deferredLightingSystem->render(frameInfo, gBuffer, pointLightSystem.getLightCount());
+                    pointLightSystem.render(frameInfo);
+                    gpuTimer.endScope(commandBuffer);
+                    _renderer.endSwapChainRenderPass(commandBuffer);
+                } else if (occlusionCulling) {
+                    gpuTimer.beginScope(commandBuffer, "forward");
+                    // Last frame's visible set, then whatever the depth it left behind doesn't hide
+                    _renderer.beginSwapChainRenderPass(commandBuffer, SwapChain::RenderPassType::FIRST);
+                    simpleRenderSystem.renderGameObjects(frameInfo, 0u);
+                    _renderer.endSwapChainRenderPass(commandBuffer);
+
+                    depthPyramid.build(commandBuffer, static_cast<uint32_t>(frameIndex), _renderer.getCurrentDepthImage(), _renderer.getCurrentDepthImageView(), _renderer.getSwapChainDepthFormat());
+                    gpuCullingSystem.cullOccluded(frameInfo);
+
+                    _renderer.beginSwapChainRenderPass(commandBuffer, SwapChain::RenderPassType::LAST);
+                    simpleRenderSystem.renderGameObjects(frameInfo, 1u);
+                    pointLightSystem.render(frameInfo);
+                    _renderer.endSwapChainRenderPass(commandBuffer);
+                    gpuTimer.endScope(commandBuffer);
+                } else {
+                    _renderer.beginSwapChainRenderPass(commandBuffer);
+                    gpuTimer.beginScope(commandBuffer, "forward");
+                    simpleRenderSystem.renderGameObjects(frameInfo);
+                    pointLightSystem.render(frameInfo);
+                    gpuTimer.endScope(commandBuffer);
+                    _renderer.endSwapChainRenderPass(commandBuffer);
+                }
                 _renderer.endFrame();
+
+                if (firstFrame) {
+                    firstFrame = false;
+                    std::cout << "First frame submitted after " << getElapsedMS() << " ms" << std::endl;
+                }
+
+                statsTimer += frameTime;
+                if (statsTimer >= STATS_INTERVAL) {
+                    statsTimer = 0.f;
+                    printStats(stats, pointLightSystem.isClusteringEnabled() ? &pointLightSystem.getClusterStats() : nullptr, gpuTimer, simpleRenderSystem.getRenderMode() == SimpleRenderSystem::RenderMode::INDIRECT ? &gpuCullingSystem : nullptr);
+                }
             }
         }
 
         vkDeviceWaitIdle(_device.device());
     }
 
+    void Application::rasterizeOccluders(OcclusionRasterizer& rasterizer, const Camera& camera) const {
+        rasterizer.beginFrame(camera.getProjection() * camera.getView());
+        for (const auto& kv : _gameObjects) {
+            const GameObject& obj = kv.second;
+            if (!obj._isOccluder || obj._model == nullptr || !obj._model->isResident()) {
+                continue;
+            }
+
+            const Model::OccluderMesh& mesh = obj._model->getOccluderMesh();
+            if (!mesh.indices.empty()) {
+                rasterizer.addOccluder(obj._transform.mat4(), mesh.positions.data(), mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()));
+            }
+        }
+        rasterizer.rasterize();
+    }
+
+    float Application::getElapsedMS() const {
+        return std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - _startTime).count();
+    }
+
+    void Application::printStats(const RenderStats& stats, const LightClusters::Stats* lightStats, const GpuTimer& gpuTimer, const GpuCullingSystem* gpuCulling) const {
+        std::cout << "Objects: " << stats.objects << " visible, " << stats.objectsCulled << " culled, draw calls: " << stats.drawCalls << ", buffer binds: " << stats.bufferBinds << ", triangles: " << stats.triangles << ", objects per LOD:";
+        for (const uint32_t count : stats.lodHistogram) {
+            std::cout << " " << count;
+        }
+        std::cout << ", meshlets culled: " << stats.meshletsCulled << ", occluded: " << stats.objectsOccluded << std::endl;
+
+        std::cout << "State changes: " << stats.pipelineBinds << " pipeline binds, " << stats.bufferBinds << " buffer binds";
+        if (stats.unsortedPipelineBinds > 0u) {
+            std::cout << " (" << stats.unsortedPipelineBinds << " and " << stats.unsortedBufferBinds << " unsorted)";
+        }
+        std::cout << std::endl;
+
+        if (lightStats != nullptr) {
+            std::cout << "Lights: " << lightStats->visibleLights << " / " << lightStats->lights << " in view, " << lightStats->occupiedClusters << " / " << LightClusters::CLUSTER_COUNT
+                      << " clusters occupied, " << lightStats->lightIndices << " light indices, at most " << lightStats->maxLightsPerCluster << " per cluster";
+            if (lightStats->occupiedClusters > 0u) {
+                std::cout << " (" << static_cast<float>(lightStats->lightIndices) / lightStats->occupiedClusters << " on average)";
+            }
+            std::cout << std::endl;
+        }
+
+        if (!gpuTimer.getResults().empty()) {
+            std::cout << "GPU time:";
+            for (const GpuTimer::Scope& scope : gpuTimer.getResults()) {
+                std::cout << " " << scope.name << " " << scope.milliseconds << " ms";
+            }
+            std::cout << std::endl;
+        }
+
+        const FrameAllocator::Stats& frameStats = _frameAllocator.getStats();
+        std::cout << "Frame data: " << frameStats.allocationCount << " allocations, " << frameStats.usedBytes << " bytes this frame, peak "
+                  << frameStats.peakUsedBytes << " / " << frameStats.frameCapacity << " bytes" << std::endl;
+
+        if (gpuCulling != nullptr) {
+            const GpuScene::Stats& sceneStats = _gpuScene.getStats();
+            std::cout << "GPU scene: " << sceneStats.objects << " / " << sceneStats.capacity << " objects in " << sceneStats.batches << " batches, "
+                      << sceneStats.updatedObjects << " updated (" << sceneStats.uploadedBytes << " bytes) last frame, " << sceneStats.rebuilds << " rebuilds" << std::endl;
+
+            const GpuCullingSystem::Stats& cullStats = gpuCulling->getStats();
+            std::cout << "GPU culling: " << cullStats.visible << " visible, " << cullStats.frustumCulled << " outside the frustum, "
+                      << cullStats.occluded << " occluded (" << SwapChain::MAX_FRAMES_IN_FLIGHT << " frames late)";
+            if constexpr (VALIDATE_GPU_CULLING) {
+                std::cout << ", " << cullStats.mismatches << " / " << cullStats.validatedFrames << " frames differ from the CPU";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    void Application::printModelStats() {
+        const ModelRegistry::Stats stats = _modelRegistry.getStats();
+        std::cout << "Model registry: " << stats.hits << " hits, " << stats.misses << " misses, "
+                  << stats.liveModels << " models shared by " << stats.references << " objects, "
+                  << stats.residentBytes / 1024 << " KB resident, " << stats.savedBytes / 1024 << " KB saved by sharing" << std::endl;
+
+        const GeometryArena::Stats geometryStats = _device.getGeometryArena().getStats();
+        std::cout << "Geometry arena: " << geometryStats.rangeCount << " models in " << geometryStats.pageCount << " pages, "
+                  << geometryStats.usedBytes / 1024 << " / " << geometryStats.reservedBytes / 1024 << " KB used" << std::endl;
+
+        const MemoryAllocator::Stats memoryStats = _device.getMemoryAllocator().getStats();
+        std::cout << "Device memory: " << memoryStats.allocationCount << " allocations in " << memoryStats.blockCount << " blocks + "
+                  << memoryStats.dedicatedAllocationCount << " dedicated, " << memoryStats.usedBytes / 1024 << " / " << memoryStats.reservedBytes / 1024
+                  << " KB used, fragmentation " << memoryStats.fragmentation << std::endl;
+
+        const UploadManager::Stats uploadStats = _device.getUploadManager().getStats();
+        std::cout << "Uploads: " << uploadStats.copies << " copies (" << uploadStats.uploadedBytes / 1024 << " KB) in " << uploadStats.submissions
+                  << " submissions, staging ring " << uploadStats.ringUsedBytes / 1024 << " / " << uploadStats.ringSize / 1024 << " KB (peak "
+                  << uploadStats.peakRingUsedBytes / 1024 << " KB), " << uploadStats.stalls << " stalls, " << uploadStats.oversizedUploads << " oversized" << std::endl;
+    }
+
     void Application::loadGameObjects() {
+        // The position streams are only worth their memory if the depth pre-pass draws them (direct rendering only)
+        Model::ImportOptions importOptions = Model::getRuntimeImportOptions();
+        importOptions.positionStream = USE_DEPTH_PREPASS && !USE_INDIRECT_RENDERING;
+
         {
-            std::shared_ptr<Model> model = Model::createModelFromFile(_device, "Assets/Models/smooth_vase.obj");
+            std::shared_ptr<Model> model = _modelRegistry.acquire("Assets/Models/smooth_vase.obj", importOptions);
             auto gameObject = GameObject::CreateGameObject();
             gameObject._model = model;
             gameObject._transform.translation = { .5f, .5f, 0.f };
@@ -131,7 +372,7 @@ namespace Divide {
             _gameObjects.emplace(gameObject.getId(), std::move(gameObject));
         }
         {
-            std::shared_ptr<Model> model = Model::createModelFromFile(_device, "Assets/Models/flat_vase.obj");
+            std::shared_ptr<Model> model = _modelRegistry.acquire("Assets/Models/flat_vase.obj", importOptions);
             auto gameObject = GameObject::CreateGameObject();
             gameObject._model = model;
             gameObject._transform.translation = { -.5f, .5f, 0.f };
@@ -139,14 +380,34 @@ namespace Divide {
             _gameObjects.emplace(gameObject.getId(), std::move(gameObject));
         }
         {
-            std::shared_ptr<Model> model = Model::createModelFromFile(_device, "Assets/Models/quad.obj");
+            std::shared_ptr<Model> model = _modelRegistry.acquire("Assets/Models/quad.obj", importOptions);
             auto gameObject = GameObject::CreateGameObject();
             gameObject._model = model;
             gameObject._transform.translation = { 0.f, .5f, 0.f };
             gameObject._transform.scale = glm::vec3(3.f);
             _gameObjects.emplace(gameObject.getId(), std::move(gameObject));
         }
-        
+        if constexpr (OCCLUSION_STRESS_WALL) {
+            std::shared_ptr<Model> model = _modelRegistry.acquire("Assets/Models/cube.obj", importOptions);
+            auto gameObject = GameObject::CreateGameObject();
+            gameObject._model = model;
+            gameObject._transform.translation = { 0.f, 0.f, .75f };
+            gameObject._transform.scale = glm::vec3(4.f, 3.f, .05f);
+            gameObject._isOccluder = true;
+            _gameObjects.emplace(gameObject.getId(), std::move(gameObject));
+        }
+        if constexpr (STRESS_OBJECT_COUNT > 0u) {
+            std::shared_ptr<Model> model = _modelRegistry.acquire("Assets/Models/smooth_vase.obj", importOptions);
+            const uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(STRESS_OBJECT_COUNT))));
+            for (uint32_t i = 0u; i < STRESS_OBJECT_COUNT; ++i) {
+                auto gameObject = GameObject::CreateGameObject();
+                gameObject._model = model;
+                gameObject._transform.translation = { (static_cast<float>(i % gridSize) - gridSize * 0.5f) * 0.25f, .5f, static_cast<float>(i / gridSize) * 0.25f + 1.f };
+                gameObject._transform.scale = glm::vec3(.5f);
+                _gameObjects.emplace(gameObject.getId(), std::move(gameObject));
+            }
+        }
+
          const std::vector<glm::vec3> lightColours{
               {1.f, .1f, .1f},
               {.1f, .1f, 1.f},
@@ -163,5 +424,15 @@ namespace Divide {
              pointLight._transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
              _gameObjects.emplace(pointLight.getId(), std::move(pointLight));
          }
+
+         if constexpr (STRESS_LIGHT_COUNT > 0u) {
+             for (uint32_t i = 0u; i < STRESS_LIGHT_COUNT; ++i) {
+                 auto pointLight = GameObject::MakePointLight(0.01f, 0.02f, lightColours[i % lightColours.size()]);
+                 auto rotateLight = glm::rotate(glm::mat4(1.f), (i * glm::two_pi<float>()) / STRESS_LIGHT_COUNT, {0.f, -1.f, 0.f});
+                 const float ringRadius = 0.5f + static_cast<float>(i % 16u) * 0.25f;
+                 pointLight._transform.translation = glm::vec3(rotateLight * glm::vec4(-ringRadius, -0.25f, -ringRadius, 1.f));
+                 _gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+             }
+         }
     }
 }; //namespace Divide
\ No newline at end of file
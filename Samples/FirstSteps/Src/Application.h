@@ -3,13 +3,25 @@
 #include "Utilities/Window.h"
 #include "Utilities/Device.h"
 #include "Utilities/Model.h"
+#include "Utilities/ModelLoader.h"
+#include "Utilities/ModelRegistry.h"
 #include "Engine/GameObject.h"
 #include "Engine/Renderer.h"
 #include "Utilities/Descriptors.h"
+#include "Utilities/FrameAllocator.h"
+#include "Utilities/LightClusters.h"
+#include "Engine/FrameInfo.h"
+#include "Engine/GpuScene.h"
 
+#include <chrono>
 #include <memory>
 
 namespace Divide {
+    class Camera;
+    class GpuCullingSystem;
+    class GpuTimer;
+    class OcclusionRasterizer;
+
     class Application {
     public:
         static constexpr int WIDTH = 800;
@@ -24,15 +36,31 @@ namespace Divide {
         Application& operator=(Application&&) = delete;
 
         void run();
+        // Forward (clustered) or deferred shading for the next run(). Defaults to USE_DEFERRED_SHADING in Application.cpp.
+        inline void setDeferredShading(const bool enabled) { _deferredShading = enabled; }
 
     private:
         void loadGameObjects();
+        // 'gpuCulling' is only set when rendering indirectly, 'lightStats' only when the lights are clustered
+        void printStats(const RenderStats& stats, const LightClusters::Stats* lightStats, const GpuTimer& gpuTimer, const GpuCullingSystem* gpuCulling) const;
+        void printModelStats();
+        // Fills 'rasterizer' with this frame's occluders, for the direct path's software occlusion test
+        void rasterizeOccluders(OcclusionRasterizer& rasterizer, const Camera& camera) const;
+        // Time since the application was constructed
+        [[nodiscard]] float getElapsedMS() const;
 
         Window _window{WIDTH, HEIGHT, "Hiya Vulkan"};
         Device _device{_window};
         Renderer _renderer{ _window, _device };
+        FrameAllocator _frameAllocator{ _device, SwapChain::MAX_FRAMES_IN_FLIGHT };
+        GpuScene _gpuScene{ _device, SwapChain::MAX_FRAMES_IN_FLIGHT };
+        ModelLoader _modelLoader{ _device };
+        ModelRegistry _modelRegistry{ _modelLoader };
 
         std::unique_ptr<DescriptorPool> _globalPoolPtr{};
         GameObject::Map _gameObjects;
+        bool _deferredShading = false;
+
+        std::chrono::high_resolution_clock::time_point _startTime{ std::chrono::high_resolution_clock::now() };
     };
 }; //namespace Divide
\ No newline at end of file
@@ -5,11 +5,14 @@
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+
 namespace Divide {
-    constexpr uint32_t MAX_LIGHTS = 10u;
+    class FrameAllocator;
 
+    // Matches PointLight in simple.frag (std430). The lights are clustered (LightClusters), so there is no fixed limit.
     struct PointLight {
-        glm::vec4 position{};  //w is unused;
+        glm::vec4 position{};  //w is the range: the light contributes nothing further away
         glm::vec4 colour{}; //w is intensity;
     };
 
@@ -18,8 +21,43 @@ namespace Divide {
         glm::mat4 viewMatrix{ 1.f };
         glm::mat4 inverseViewMatrix{ 1.f };
         glm::vec4 ambientLightColour{ 1.f, 1.f, 1.f, .02f };
-        PointLight pointLights[MAX_LIGHTS];
-        int numLights = 0;
+        // xyz: cluster grid size, w: 1 if depth slices are logarithmic (LightClusters::DepthSlicing)
+        glm::uvec4 clusterGrid{ 1u, 1u, 1u, 0u };
+        // xy: clusters per pixel, zw: depth slice scale and bias
+        glm::vec4 clusterScale{ 0.f };
+    };
+
+    // The global set's (set 0) bindings, all dynamic, in the order their offsets are bound
+    enum class GlobalBinding : uint8_t {
+        UBO = 0, // GlobalUbo
+        LIGHTS,  // PointLight array
+        LIGHT_CLUSTERS, // LightClusters::getClusterData()
+        COUNT
+    };
+    constexpr uint32_t GLOBAL_DYNAMIC_OFFSET_COUNT = static_cast<uint32_t>(GlobalBinding::COUNT);
+
+    // Filled in by the render systems every frame
+    struct RenderStats {
+        // Objects that passed culling and were submitted for drawing, i.e. the draw call count without instancing
+        uint32_t objects = 0u;
+        uint32_t drawCalls = 0u;
+        // Vertex/index buffer binds; one per geometry arena page in use, not per object
+        uint32_t bufferBinds = 0u;
+        uint32_t pipelineBinds = 0u;
+        // Binds the direct path would have needed drawing in scene (map) order instead of sorted (RenderQueue). Only
+        // counted with countUnsortedBinds, which the caller sets in frames whose stats get printed: it costs extra passes.
+        uint32_t unsortedPipelineBinds = 0u;
+        uint32_t unsortedBufferBinds = 0u;
+        bool countUnsortedBinds = false;
+        uint64_t triangles = 0u;
+        // Number of objects drawn at each LOD
+        std::array<uint32_t, Model::MAX_LODS> lodHistogram{};
+        // Objects rejected by the frustum test (FrustumCuller)
+        uint32_t objectsCulled = 0u;
+        // Objects in the frustum but hidden behind the depth pyramid (GpuCullingSystem) or software occluders (OcclusionRasterizer)
+        uint32_t objectsOccluded = 0u;
+        // Meshlets rejected by the CPU frustum/cone tests
+        uint32_t meshletsCulled = 0u;
     };
 
     struct FrameInfo {
@@ -28,6 +66,12 @@ namespace Divide {
         VkCommandBuffer commandBuffer;
         Camera& camera;
         VkDescriptorSet globalDescriptorSet;
+        // Dynamic offsets of the global set's bindings, indexed by GlobalBinding. PointLightSystem::update() fills in the lights.
+        std::array<uint32_t, GLOBAL_DYNAMIC_OFFSET_COUNT> globalOffsets;
+        // Per-frame/per-draw data goes here; bind slices through dynamic descriptors
+        FrameAllocator& frameAllocator;
         GameObject::Map& gameObjects;
+        VkExtent2D extent;
+        RenderStats& stats;
     };
 }; //namespace Divide
\ No newline at end of file
@@ -57,6 +57,13 @@ namespace Divide {
             }};
     }
 
+    glm::vec4 GameObject::getBoundingSphere() const {
+        const glm::vec4& sphere = _model->getBoundingSphere();
+        const float maxScale = glm::max(glm::abs(_transform.scale.x), glm::max(glm::abs(_transform.scale.y), glm::abs(_transform.scale.z)));
+        const glm::vec3 centre = glm::vec3(_transform.mat4() * glm::vec4(glm::vec3(sphere), 1.f));
+        return glm::vec4(centre, sphere.w * maxScale);
+    }
+
     GameObject GameObject::MakePointLight(const float intensity, const float radius, const glm::vec3 colour) {
         GameObject gameObj = GameObject::CreateGameObject();
         gameObj._colour = colour;
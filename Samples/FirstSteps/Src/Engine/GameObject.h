@@ -38,10 +38,14 @@ namespace Divide {
         //GameObject& operator=(GameObject&&) = delete;
 
         [[nodiscard]] inline id_t getId() const { return _id; }
+        // World space bounding sphere of the model (xyz: centre, w: radius). Requires a model.
+        [[nodiscard]] glm::vec4 getBoundingSphere() const;
 
         std::shared_ptr<Model> _model{};
         glm::vec3 _colour{};
         TransformComponent _transform{};
+        // Rasterised into the software occlusion buffer (see OcclusionRasterizer) using the model's occluder mesh
+        bool _isOccluder = false;
 
         std::unique_ptr<PointLightComponent> _pointLightPtr = nullptr;
     private:
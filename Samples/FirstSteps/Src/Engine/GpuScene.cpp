@@ -0,0 +1,267 @@
+#include "GpuScene.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <tuple>
+
+namespace Divide {
+
+    namespace {
+        bool isSameTransform(const TransformComponent& lhs, const TransformComponent& rhs) {
+            return lhs.translation == rhs.translation && lhs.scale == rhs.scale && lhs.rotation == rhs.rotation;
+        }
+    };
+
+    GpuScene::GpuScene(Device& device, const uint32_t frameCount, const uint32_t initialCapacity)
+        : _device(device)
+        , _frameCount(frameCount)
+        , _allFramesMask(frameCount >= 32u ? ~0u : (1u << frameCount) - 1u)
+    {
+        assert(frameCount > 0u && frameCount <= 32u && "Stale frames are tracked in a 32 bit mask");
+
+        _staleSlots.resize(frameCount);
+        reserve(std::max(initialCapacity, 1u));
+    }
+
+    bool GpuScene::isDrawable(const GameObject& gameObject) {
+        // Still streaming in (see ModelLoader), or not something indexed draws can express
+        return gameObject._model != nullptr && gameObject._model->isResident() && gameObject._model->hasIndexBuffer();
+    }
+
+    void GpuScene::update(const uint32_t frameIndex, const GameObject::Map& gameObjects) {
+        assert(frameIndex < _frameCount && "Invalid frame index");
+
+        _stats.updatedObjects = 0u;
+        _stats.uploadedBytes = 0u;
+
+        bool layoutChanged = false;
+        uint32_t drawableCount = 0u;
+        for (const auto& kv : gameObjects) {
+            const GameObject& obj = kv.second;
+            if (!isDrawable(obj)) {
+                continue;
+            }
+
+            ++drawableCount;
+            const auto it = _slots.find(obj.getId());
+            if (it == _slots.end() || _entries[it->second]._model != obj._model.get()) {
+                layoutChanged = true;
+                break;
+            }
+
+            Entry& entry = _entries[it->second];
+            if (!isSameTransform(entry._transform, obj._transform)) {
+                writeObject(it->second, obj);
+                markStale(it->second);
+            }
+        }
+
+        if (layoutChanged || drawableCount != _entries.size()) {
+            rebuild(gameObjects);
+        }
+
+        flush(frameIndex);
+    }
+
+    void GpuScene::rebuild(const GameObject::Map& gameObjects) {
+        _sortedObjects.clear();
+        for (const auto& kv : gameObjects) {
+            if (isDrawable(kv.second)) {
+                _sortedObjects.push_back(&kv.second);
+            }
+        }
+
+        // Batches become contiguous runs of slots
+        std::sort(_sortedObjects.begin(), _sortedObjects.end(), [](const GameObject* lhs, const GameObject* rhs) {
+            return std::make_tuple(lhs->_model->getVertexFormat(), lhs->_model->getGeometry().getBindKey(), lhs->_model.get(), lhs->getId()) <
+                   std::make_tuple(rhs->_model->getVertexFormat(), rhs->_model->getGeometry().getBindKey(), rhs->_model.get(), rhs->getId());
+        });
+
+        const uint32_t objectCount = static_cast<uint32_t>(_sortedObjects.size());
+        reserve(objectCount);
+
+        _entries.assign(objectCount, {});
+        _transforms.resize(objectCount);
+        _infos.resize(objectCount);
+        _batches.clear();
+        _slots.clear();
+        _stats.triangles = 0u;
+
+        for (uint32_t slot = 0u; slot < objectCount; ++slot) {
+            const GameObject& obj = *_sortedObjects[slot];
+            Model& model = *obj._model;
+
+            const bool newBatch = _batches.empty() ||
+                                  _batches.back().model->getVertexFormat() != model.getVertexFormat() ||
+                                  _batches.back().model->getGeometry().getBindKey() != model.getGeometry().getBindKey();
+            if (newBatch) {
+                Batch batch{};
+                batch.model = &model;
+                batch.firstCommand = slot;
+                _batches.push_back(batch);
+            }
+            _batches.back().commandCount += 1u;
+
+            _slots[obj.getId()] = slot;
+            _entries[slot]._id = obj.getId();
+            _entries[slot]._model = &model;
+
+            const VkDrawIndexedIndirectCommand command = model.getIndirectCommand(0u, 1u, slot);
+            ObjectInfo& info = _infos[slot];
+            info.firstIndex = command.firstIndex;
+            info.indexCount = command.indexCount;
+            info.vertexOffset = command.vertexOffset;
+            info.batch = static_cast<uint32_t>(_batches.size() - 1u);
+            info.batchFirstCommand = _batches.back().firstCommand;
+            writeObject(slot, obj);
+
+            _stats.triangles += command.indexCount / 3u;
+        }
+
+        // Every copy gets rewritten in full, which covers any individually stale slots too
+        for (std::vector<uint32_t>& staleSlots : _staleSlots) {
+            staleSlots.clear();
+        }
+        _rebuiltFrames = _allFramesMask;
+
+        _stats.objects = objectCount;
+        _stats.batches = static_cast<uint32_t>(_batches.size());
+        _stats.rebuilds += 1u;
+    }
+
+    void GpuScene::reserve(const uint32_t objectCount) {
+        if (objectCount <= _capacity) {
+            return;
+        }
+
+        // The old buffers may still be read by frames in flight. Growing is rare enough to simply wait them out.
+        if (_capacity > 0u) {
+            vkDeviceWaitIdle(_device.device());
+        }
+
+        _capacity = std::max(objectCount, _capacity * 2u);
+
+        const VkDeviceSize alignment = std::max(_device.properties.limits.minStorageBufferOffsetAlignment, VkDeviceSize{ 1u });
+        const VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        for (uint8_t i = 0u; i < static_cast<uint8_t>(BufferType::COUNT); ++i) {
+            const BufferType type = static_cast<BufferType>(i);
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            if (type == BufferType::DRAW_COMMANDS || type == BufferType::DRAW_COUNTS) {
+                // Written by the culling pass, which clears the counts first
+                usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            }
+
+            // Host visible throughout: the CPU fills transforms/infos in place and reads the draw counts back for stats
+            auto& buffer = _buffers[i];
+            buffer = std::make_unique<Buffer>(_device, getElementSize(type) * getElementCount(type) * _capacity, _frameCount, usage, memoryFlags, alignment);
+            if (buffer->map() != VK_SUCCESS) {
+                throw std::runtime_error("Failed to map the GPU scene buffers!");
+            }
+        }
+
+        _rebuiltFrames = _allFramesMask;
+        _stats.capacity = _capacity;
+        ++_generation;
+    }
+
+    void GpuScene::writeObject(const uint32_t slot, const GameObject& gameObject) {
+        const Model& model = *gameObject._model;
+        const TransformComponent& transform = gameObject._transform;
+
+        _entries[slot]._transform = transform;
+        _transforms[slot].modelMatrix = transform.mat4() * model.getDequantisationMatrix();
+        _transforms[slot].normalMatrix = transform.normalMatrix();
+
+        _infos[slot].boundingSphere = gameObject.getBoundingSphere();
+    }
+
+    void GpuScene::markStale(const uint32_t slot) {
+        Entry& entry = _entries[slot];
+        for (uint32_t frame = 0u; frame < _frameCount; ++frame) {
+            if ((entry._staleFrames & (1u << frame)) == 0u) {
+                _staleSlots[frame].push_back(slot);
+            }
+        }
+        entry._staleFrames = _allFramesMask;
+    }
+
+    void GpuScene::flush(const uint32_t frameIndex) {
+        const uint32_t frameBit = 1u << frameIndex;
+
+        const auto copy = [this](const BufferType type, const uint32_t frame, const VkDeviceSize offset, const void* data, const VkDeviceSize size) {
+            const Buffer& buffer = *_buffers[static_cast<size_t>(type)];
+            std::memcpy(static_cast<std::byte*>(buffer.getMappedMemory()) + buffer.getAlignmentSize() * frame + offset, data, size);
+            _stats.uploadedBytes += size;
+        };
+
+        if ((_rebuiltFrames & frameBit) != 0u) {
+            const uint32_t objectCount = static_cast<uint32_t>(_entries.size());
+            if (objectCount > 0u) {
+                copy(BufferType::TRANSFORMS, frameIndex, 0u, _transforms.data(), sizeof(ObjectTransform) * objectCount);
+                copy(BufferType::OBJECT_INFO, frameIndex, 0u, _infos.data(), sizeof(ObjectInfo) * objectCount);
+            }
+            for (Entry& entry : _entries) {
+                entry._staleFrames &= ~frameBit;
+            }
+            _staleSlots[frameIndex].clear();
+            _rebuiltFrames &= ~frameBit;
+            _stats.updatedObjects = objectCount;
+            return;
+        }
+
+        for (const uint32_t slot : _staleSlots[frameIndex]) {
+            copy(BufferType::TRANSFORMS, frameIndex, sizeof(ObjectTransform) * slot, &_transforms[slot], sizeof(ObjectTransform));
+            copy(BufferType::OBJECT_INFO, frameIndex, sizeof(ObjectInfo) * slot, &_infos[slot], sizeof(ObjectInfo));
+            _entries[slot]._staleFrames &= ~frameBit;
+        }
+        _stats.updatedObjects = static_cast<uint32_t>(_staleSlots[frameIndex].size());
+        _staleSlots[frameIndex].clear();
+    }
+
+    VkDeviceSize GpuScene::getElementSize(const BufferType type) {
+        switch (type) {
+            case BufferType::TRANSFORMS: return sizeof(ObjectTransform);
+            case BufferType::OBJECT_INFO: return sizeof(ObjectInfo);
+            case BufferType::DRAW_COMMANDS: return sizeof(VkDrawIndexedIndirectCommand);
+            // There can't be more batches than objects
+            case BufferType::DRAW_COUNTS: return sizeof(uint32_t);
+            default: break;
+        }
+        assert(false && "Invalid GPU scene buffer type");
+        return 0u;
+    }
+
+    uint32_t GpuScene::getElementCount(const BufferType type) {
+        return type == BufferType::DRAW_COMMANDS || type == BufferType::DRAW_COUNTS ? MAX_DRAW_PHASES : 1u;
+    }
+
+    uint32_t GpuScene::getFrameOffset(const BufferType type, const uint32_t frameIndex) const {
+        return static_cast<uint32_t>(_buffers[static_cast<size_t>(type)]->getAlignmentSize() * frameIndex);
+    }
+
+    VkDescriptorBufferInfo GpuScene::getDescriptorInfo(const BufferType type) const {
+        return VkDescriptorBufferInfo{ getBuffer(type), 0u, getElementSize(type) * getElementCount(type) * _capacity };
+    }
+
+    VkDeviceSize GpuScene::getCommandOffset(const uint32_t frameIndex, const uint32_t batch, const uint32_t phase) const {
+        assert(phase < MAX_DRAW_PHASES && "Invalid draw phase");
+        return getFrameOffset(BufferType::DRAW_COMMANDS, frameIndex) + sizeof(VkDrawIndexedIndirectCommand) * (VkDeviceSize{ _capacity } * phase + _batches[batch].firstCommand);
+    }
+
+    VkDeviceSize GpuScene::getCountOffset(const uint32_t frameIndex, const uint32_t batch, const uint32_t phase) const {
+        assert(phase < MAX_DRAW_PHASES && "Invalid draw phase");
+        return getFrameOffset(BufferType::DRAW_COUNTS, frameIndex) + sizeof(uint32_t) * (VkDeviceSize{ _capacity } * phase + batch);
+    }
+
+    const uint32_t* GpuScene::getDrawCounts(const uint32_t frameIndex) const {
+        const Buffer& buffer = *_buffers[static_cast<size_t>(BufferType::DRAW_COUNTS)];
+        return reinterpret_cast<const uint32_t*>(static_cast<const std::byte*>(buffer.getMappedMemory()) + getFrameOffset(BufferType::DRAW_COUNTS, frameIndex));
+    }
+
+    const VkDrawIndexedIndirectCommand* GpuScene::getDrawCommands(const uint32_t frameIndex) const {
+        const Buffer& buffer = *_buffers[static_cast<size_t>(BufferType::DRAW_COMMANDS)];
+        return reinterpret_cast<const VkDrawIndexedIndirectCommand*>(static_cast<const std::byte*>(buffer.getMappedMemory()) + getFrameOffset(BufferType::DRAW_COMMANDS, frameIndex));
+    }
+}; //namespace Divide
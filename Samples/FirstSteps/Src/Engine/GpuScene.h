@@ -0,0 +1,157 @@
+#pragma once
+
+#include "GameObject.h"
+#include "Utilities/Buffer.h"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Divide {
+    // GPU side mirror of the drawable objects for indirect rendering. Every object owns a slot holding its transform
+    // and its culling data (bounds, draw range). Slots are sorted into batches of objects that share a pipeline and a
+    // geometry arena page: one indirect draw submits a whole batch. The draw commands and per-batch draw counts are
+    // left to the GPU (see GpuCullingSystem), which writes a command per visible object with the slot as
+    // firstInstance, so the vertex shaders find their transform through gl_InstanceIndex.
+    //
+    // update() diffs the scene against what was last written: objects that only moved rewrite their own slot, while
+    // objects appearing, disappearing or changing model rebuild the slot layout. Every frame in flight has its own copy
+    // of the buffers (host visible, persistently mapped) so writing one never races the GPU reading another.
+    class GpuScene {
+    public:
+        static constexpr uint32_t DEFAULT_CAPACITY = 1024u;
+        // Independent draw lists per frame, e.g. for occlusion culling's early and late draws
+        static constexpr uint32_t MAX_DRAW_PHASES = 2u;
+
+        // Matches InstanceData in simple.vert / simple_compact.vert (std430)
+        struct ObjectTransform {
+            // Includes the model's dequantisation matrix
+            glm::mat4 modelMatrix{ 1.f };
+            glm::mat4 normalMatrix{ 1.f };
+        };
+
+        // What GPU side culling needs to know about an object. Matches ObjectInfo in cull.comp (std430).
+        struct ObjectInfo {
+            // xyz: centre, w: radius. World space.
+            glm::vec4 boundingSphere{};
+            // LOD 0 of the object's model, as its draw command should reference it
+            uint32_t firstIndex = 0u;
+            uint32_t indexCount = 0u;
+            int32_t vertexOffset = 0;
+            // Draw count to bump and the first command slot of the object's batch
+            uint32_t batch = 0u;
+            uint32_t batchFirstCommand = 0u;
+            uint32_t padding[3]{};
+        };
+
+        // Every buffer holds one region per frame in flight
+        enum class BufferType : uint8_t {
+            TRANSFORMS = 0,   // ObjectTransform per slot. CPU written.
+            OBJECT_INFO,      // ObjectInfo per slot. CPU written.
+            DRAW_COMMANDS,    // VkDrawIndexedIndirectCommand per slot and draw phase. GPU written.
+            DRAW_COUNTS,      // uint32_t per batch and draw phase. GPU written, host readable.
+            COUNT
+        };
+
+        // A run of draw commands sharing a vertex format (pipeline) and an arena page (vertex/index buffer binds)
+        struct Batch {
+            // Any model of the batch; they all bind the same buffers
+            Model* model = nullptr;
+            uint32_t firstCommand = 0u;
+            uint32_t commandCount = 0u;
+        };
+
+        struct Stats {
+            uint32_t objects = 0u;
+            uint32_t batches = 0u;
+            uint32_t capacity = 0u;
+            // Triangles of every object's LOD 0, i.e. what drawing every slot would submit
+            uint64_t triangles = 0u;
+            // Last update(): slots rewritten and bytes copied into the frame's buffers
+            uint32_t updatedObjects = 0u;
+            VkDeviceSize uploadedBytes = 0u;
+            // Slot layout rebuilds since creation
+            uint32_t rebuilds = 0u;
+        };
+
+        GpuScene(Device& device, uint32_t frameCount, uint32_t initialCapacity = DEFAULT_CAPACITY);
+
+        GpuScene(const GpuScene&) = delete;
+        GpuScene& operator=(const GpuScene&) = delete;
+        GpuScene(GpuScene&&) = delete;
+        GpuScene& operator=(GpuScene&&) = delete;
+
+        // Brings 'frameIndex''s buffers up to date with 'gameObjects'. Only call once that frame's fence has signalled.
+        // Objects without a resident, indexed model are left out. Growing past the capacity waits for the device to idle.
+        void update(uint32_t frameIndex, const GameObject::Map& gameObjects);
+
+        [[nodiscard]] inline const std::vector<Batch>& getBatches() const { return _batches; }
+        [[nodiscard]] inline uint32_t getObjectCount() const { return static_cast<uint32_t>(_entries.size()); }
+        [[nodiscard]] inline uint32_t getCapacity() const { return _capacity; }
+        // CPU copy of every slot's culling data, as last flushed
+        [[nodiscard]] inline const std::vector<ObjectInfo>& getObjectInfos() const { return _infos; }
+
+        [[nodiscard]] inline VkBuffer getBuffer(const BufferType type) const { return _buffers[static_cast<size_t>(type)]->getBuffer(); }
+        // Start of 'frameIndex''s region. Doubles as the dynamic offset for getDescriptorInfo().
+        [[nodiscard]] uint32_t getFrameOffset(BufferType type, uint32_t frameIndex) const;
+        // For a *_DYNAMIC descriptor covering one region
+        [[nodiscard]] VkDescriptorBufferInfo getDescriptorInfo(BufferType type) const;
+        // Offset of the batch's first command / its draw count in 'frameIndex''s region. Each phase's list starts
+        // getCapacity() elements after the previous one's.
+        [[nodiscard]] VkDeviceSize getCommandOffset(uint32_t frameIndex, uint32_t batch, uint32_t phase = 0u) const;
+        [[nodiscard]] VkDeviceSize getCountOffset(uint32_t frameIndex, uint32_t batch, uint32_t phase = 0u) const;
+        // Host view of 'frameIndex''s draw counts / commands, every phase. Only meaningful once that frame's fence has signalled.
+        [[nodiscard]] const uint32_t* getDrawCounts(uint32_t frameIndex) const;
+        [[nodiscard]] const VkDrawIndexedIndirectCommand* getDrawCommands(uint32_t frameIndex) const;
+
+        // Changes whenever the buffers are reallocated, at which point descriptors pointing at them must be rewritten
+        [[nodiscard]] inline uint32_t getGeneration() const { return _generation; }
+
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+
+    private:
+        struct Entry {
+            GameObject::id_t _id = 0u;
+            const Model* _model = nullptr;
+            // As last written, to spot moved objects
+            TransformComponent _transform{};
+            // Bit per frame in flight whose copy of this slot is out of date
+            uint32_t _staleFrames = 0u;
+        };
+
+        [[nodiscard]] static bool isDrawable(const GameObject& gameObject);
+        [[nodiscard]] static VkDeviceSize getElementSize(BufferType type);
+        // Per slot
+        [[nodiscard]] static uint32_t getElementCount(BufferType type);
+        void rebuild(const GameObject::Map& gameObjects);
+        void reserve(uint32_t objectCount);
+        void writeObject(uint32_t slot, const GameObject& gameObject);
+        void markStale(uint32_t slot);
+        void flush(uint32_t frameIndex);
+
+        Device& _device;
+        const uint32_t _frameCount;
+        const uint32_t _allFramesMask;
+        uint32_t _capacity = 0u;
+        uint32_t _generation = 0u;
+
+        // One instance per frame in flight, indexed by BufferType
+        std::array<std::unique_ptr<Buffer>, static_cast<size_t>(BufferType::COUNT)> _buffers{};
+
+        // CPU copies of the slot data, indexed by slot
+        std::vector<Entry> _entries{};
+        std::vector<ObjectTransform> _transforms{};
+        std::vector<ObjectInfo> _infos{};
+        std::vector<Batch> _batches{};
+        std::unordered_map<GameObject::id_t, uint32_t> _slots{};
+
+        // Per frame in flight: slots to rewrite, unless the whole copy is stale after a rebuild
+        std::vector<std::vector<uint32_t>> _staleSlots{};
+        uint32_t _rebuiltFrames = 0u;
+        // Reused by rebuild()
+        std::vector<const GameObject*> _sortedObjects{};
+
+        Stats _stats{};
+    };
+}; //namespace Divide
@@ -0,0 +1,92 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+namespace Divide {
+
+    namespace {
+        constexpr uint32_t PASS_SHIFT = 62u;
+        constexpr uint32_t PIPELINE_SHIFT = 60u;
+        constexpr uint32_t GEOMETRY_SHIFT = 48u;
+        constexpr uint32_t MODEL_SHIFT = 32u;
+        constexpr uint32_t LOD_SHIFT = 29u;
+        constexpr uint32_t PER_OBJECT_SHIFT = 28u;
+        constexpr uint32_t DEPTH_BITS = 28u;
+        constexpr uint32_t DEPTH_MAX = (1u << DEPTH_BITS) - 1u;
+
+        static_assert(static_cast<uint32_t>(RenderQueue::Pass::COUNT) <= 4u, "Pass doesn't fit its key bits");
+        static_assert(static_cast<uint32_t>(Model::VertexFormat::COUNT) <= 4u, "Pipeline doesn't fit its key bits");
+        static_assert(Model::MAX_LODS <= 8u, "LOD doesn't fit its key bits");
+
+        // Pipeline and geometry binds needed to record 'packets' in order
+        std::pair<uint32_t, uint32_t> countPacketBinds(const std::vector<RenderQueue::Packet>& packets) {
+            uint32_t pipelineBinds = 0u;
+            uint32_t geometryBinds = 0u;
+            const Model* previous = nullptr;
+            for (const RenderQueue::Packet& packet : packets) {
+                const Model& model = *packet.model;
+                if (previous == nullptr || model.getVertexFormat() != previous->getVertexFormat()) {
+                    ++pipelineBinds;
+                }
+                if (previous == nullptr || model.getGeometry().getBindKey() != previous->getGeometry().getBindKey()) {
+                    ++geometryBinds;
+                }
+                previous = &model;
+            }
+            return { pipelineBinds, geometryBinds };
+        }
+    };
+
+    uint64_t RenderQueue::makeKey(const Pass pass, const Model& model, const uint32_t lod, const bool perObject, const float normalisedDepth) {
+        const GeometryArena::Range& geometry = model.getGeometry();
+        const uint64_t page = ((geometry.poolIndex & 0xFu) << 8u) | (geometry.pageIndex & 0xFFu);
+        const uint64_t depth = static_cast<uint64_t>(std::clamp(normalisedDepth, 0.f, 1.f) * DEPTH_MAX);
+
+        return (uint64_t{ static_cast<uint8_t>(pass) } << PASS_SHIFT) |
+               (uint64_t{ static_cast<uint8_t>(model.getVertexFormat()) } << PIPELINE_SHIFT) |
+               (page << GEOMETRY_SHIFT) |
+               (uint64_t{ model.getSortId() & 0xFFFFu } << MODEL_SHIFT) |
+               (uint64_t{ lod } << LOD_SHIFT) |
+               (uint64_t{ perObject ? 1u : 0u } << PER_OBJECT_SHIFT) |
+               depth;
+    }
+
+    void RenderQueue::begin(const glm::mat4& view, const glm::mat4& projection) {
+        _packets.clear();
+        _keys.clear();
+        _order.clear();
+        _sorted = false;
+
+        _depthRow = { view[0][2], view[1][2], view[2][2], view[3][2] };
+        // View space depths that map to 0 and 1: (P22 * z + P32) / (P23 * z + P33)
+        _nearDepth = -projection[3][2] / projection[2][2];
+        const float farDepth = (projection[3][3] - projection[3][2]) / (projection[2][2] - projection[2][3]);
+        _depthScale = farDepth > _nearDepth ? 1.f / (farDepth - _nearDepth) : 1.f;
+    }
+
+    void RenderQueue::add(const Pass pass, const Packet& packet, const glm::vec3& centre) {
+        const float depth = glm::dot(_depthRow, glm::vec4(centre, 1.f));
+        _keys.push_back(makeKey(pass, *packet.model, packet.lod, packet.perObject, (depth - _nearDepth) * _depthScale));
+        _order.push_back(static_cast<uint32_t>(_packets.size()));
+        _packets.push_back(packet);
+    }
+
+    void RenderQueue::sort(const bool countBinds) {
+        if (countBinds) {
+            std::tie(_stats.unsortedPipelineBinds, _stats.unsortedGeometryBinds) = countPacketBinds(_packets);
+        }
+
+        _radixSort.sort(_keys.data(), _order.data(), size());
+        _sortedPackets.resize(_packets.size());
+        for (uint32_t i = 0u; i < size(); ++i) {
+            _sortedPackets[i] = _packets[_order[i]];
+        }
+        _sorted = true;
+
+        if (countBinds) {
+            std::tie(_stats.sortedPipelineBinds, _stats.sortedGeometryBinds) = countPacketBinds(_sortedPackets);
+        }
+    }
+}; //namespace Divide
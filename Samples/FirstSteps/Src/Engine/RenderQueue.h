@@ -0,0 +1,74 @@
+#pragma once
+
+#include "GameObject.h"
+#include "Utilities/RadixSort.h"
+
+#include <vector>
+
+namespace Divide {
+    // A frame's draws as compact packets, each with a 64 bit sort key:
+    //
+    //   [63:62] pass | [61:60] pipeline | [59:48] geometry page | [47:32] model | [31:29] LOD | [28] per object | [27:0] depth
+    //
+    // Sorting by key (RadixSort) groups the draws by the state they need, the most expensive change first. Within a
+    // model and LOD it orders them front to back, so instanced draws help early depth rejection. The packets and keys
+    // are kept between frames, so extraction and sorting don't allocate in steady state.
+    //
+    // Fields that overflow their bits (e.g. a 17th arena pool) are truncated. That makes the order worse, never wrong:
+    // whoever records the packets still compares the real state.
+    class RenderQueue {
+    public:
+        enum class Pass : uint8_t {
+            OPAQUE = 0,
+            COUNT
+        };
+
+        struct Packet {
+            GameObject* object = nullptr;
+            Model* model = nullptr;
+            uint32_t lod = 0u;
+            // Drawn on its own (e.g. through the meshlet path) rather than as part of an instanced draw
+            bool perObject = false;
+        };
+
+        // Binds needed to record the packets in the order they were added, and in sorted order. Only updated by
+        // sort(true), as counting them takes two extra passes over the packets.
+        struct Stats {
+            uint32_t unsortedPipelineBinds = 0u;
+            uint32_t unsortedGeometryBinds = 0u;
+            uint32_t sortedPipelineBinds = 0u;
+            uint32_t sortedGeometryBinds = 0u;
+        };
+
+        // Empties the queue. Depths are measured along 'view' and quantised over the depth range of 'projection'.
+        void begin(const glm::mat4& view, const glm::mat4& projection);
+        // 'centre' is the object's world space position its depth is taken at
+        void add(Pass pass, const Packet& packet, const glm::vec3& centre);
+        // 'countBinds' also updates getStats(), for the stats output; leave it off in frames that don't print them
+        void sort(bool countBinds = false);
+
+        [[nodiscard]] inline uint32_t size() const { return static_cast<uint32_t>(_packets.size()); }
+        [[nodiscard]] inline bool empty() const { return _packets.empty(); }
+        // Sorted by key once sort() has run, in the order they were added before
+        [[nodiscard]] inline const Packet& getPacket(const uint32_t index) const { return _sorted ? _sortedPackets[index] : _packets[index]; }
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+
+        [[nodiscard]] static uint64_t makeKey(Pass pass, const Model& model, uint32_t lod, bool perObject, float normalisedDepth);
+
+    private:
+        // View space depth of a world position: dot(_depthRow, (position, 1))
+        glm::vec4 _depthRow{ 0.f };
+        float _nearDepth = 0.f;
+        float _depthScale = 1.f;
+
+        std::vector<Packet> _packets{};
+        std::vector<uint64_t> _keys{};
+        // Index of every key's packet, permuted along with the keys
+        std::vector<uint32_t> _order{};
+        // _packets gathered in key order, so recording walks memory linearly
+        std::vector<Packet> _sortedPackets{};
+        RadixSort _radixSort{};
+        Stats _stats{};
+        bool _sorted = false;
+    };
+}; //namespace Divide
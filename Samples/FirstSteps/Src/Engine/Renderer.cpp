@@ -45,16 +45,24 @@ namespace Divide {
 
         vkDeviceWaitIdle(_device.device());
         if (_swapChainPtr == nullptr) {
-            _swapChainPtr = std::make_unique<SwapChain>(_device, extent);
+            _swapChainPtr = std::make_unique<SwapChain>(_device, extent, _deferredShading);
         } else {
             std::shared_ptr<SwapChain> oldSwapChain = std::move(_swapChainPtr);
-            _swapChainPtr = std::make_unique<SwapChain>(_device, extent, oldSwapChain);
+            _swapChainPtr = std::make_unique<SwapChain>(_device, extent, oldSwapChain, _deferredShading);
             if (!oldSwapChain->compareSwapFormats(*_swapChainPtr.get())) {
                 throw std::runtime_error("Swap chain image(or depth) format has changed!");
             }
         }
     }
 
+    void Renderer::setDeferredShading(const bool enabled) {
+        assert(!_isFrameStarted && "Can't change the render passes while a frame is in progress!");
+        if (_deferredShading != enabled) {
+            _deferredShading = enabled;
+            recreateSwapChain();
+        }
+    }
+
     [[nodiscard]] VkCommandBuffer Renderer::beginFrame() {
         assert(!_isFrameStarted && "Can't call beginFrame while already in progress!");
         auto result = _swapChainPtr->acquireNextImage(&_currentImageIndex);
@@ -103,13 +111,13 @@ namespace Divide {
         _currentFrameIndex = ++_currentFrameIndex % SwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
-    void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+    void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, const SwapChain::RenderPassType type) {
         assert(_isFrameStarted && "Can't call beginSwapChainRenderPass while frame is not in progress!");
         assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame!");
 
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = _swapChainPtr->getRenderPass();
+        renderPassInfo.renderPass = _swapChainPtr->getRenderPass(type);
         renderPassInfo.framebuffer = _swapChainPtr->getFrameBuffer(static_cast<int>(_currentImageIndex));
         renderPassInfo.renderArea.offset = { 0, 0 };
         renderPassInfo.renderArea.extent = _swapChainPtr->getSwapChainExtent();
@@ -138,6 +146,50 @@ namespace Divide {
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
 
+    void Renderer::beginDeferredRenderPass(VkCommandBuffer commandBuffer) {
+        assert(_isFrameStarted && "Can't call beginDeferredRenderPass while frame is not in progress!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame!");
+        assert(_deferredShading && "Deferred shading isn't enabled!");
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = _swapChainPtr->getDeferredRenderPass();
+        renderPassInfo.framebuffer = _swapChainPtr->getDeferredFrameBuffer(static_cast<int>(_currentImageIndex));
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = _swapChainPtr->getSwapChainExtent();
+
+        // Swap chain image, depth, then the G-buffer (SwapChain::GBufferAttachment)
+        std::array<VkClearValue, 2 + SwapChain::GBUFFER_ATTACHMENT_COUNT> clearValues{};
+        clearValues[0].color = { 0.1f, 0.1f, 0.8f, 1.0f };
+        clearValues[1].depthStencil = { 1.f, 0 };
+
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        VkViewport viewport{};
+        viewport.x = 0.f;
+        viewport.y = 0.f;
+        viewport.width = static_cast<float>(_swapChainPtr->getSwapChainExtent().width);
+        viewport.height = static_cast<float>(_swapChainPtr->getSwapChainExtent().height);
+        viewport.minDepth = 0.f;
+        viewport.maxDepth = 1.f;
+
+        VkRect2D scissor{ {0, 0}, _swapChainPtr->getSwapChainExtent() };
+
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    }
+
+    void Renderer::nextSubpass(VkCommandBuffer commandBuffer) {
+        assert(_isFrameStarted && "Can't call nextSubpass while frame is not in progress!");
+        assert(commandBuffer == getCurrentCommandBuffer() && "Can't advance a render pass on command buffer from a different frame!");
+
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
     void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
         assert(_isFrameStarted && "Can't call endSwapChainRenderPass while frame is not in progress!");
         assert(commandBuffer == getCurrentCommandBuffer() && "Can't end render pass on command buffer from a different frame!");
@@ -21,7 +21,12 @@ namespace Divide {
         Renderer& operator=(Renderer&&) = delete;
 
         [[nodiscard]] inline VkRenderPass getSwapChainRenderPass() const { return _swapChainPtr->getRenderPass(); }
+        // Only valid with deferred shading enabled. See SwapChain::GBUFFER_SUBPASS.
+        [[nodiscard]] inline VkRenderPass getDeferredRenderPass() const { return _swapChainPtr->getDeferredRenderPass(); }
+        [[nodiscard]] inline bool isDeferredShadingEnabled() const { return _deferredShading; }
         [[nodiscard]] inline float getAspectRatio() const { return _swapChainPtr->extentAspectRatio(); }
+        [[nodiscard]] inline VkExtent2D getSwapChainExtent() const { return _swapChainPtr->getSwapChainExtent(); }
+        [[nodiscard]] inline VkFormat getSwapChainDepthFormat() const { return _swapChainPtr->getSwapChainDepthFormat(); }
         [[nodiscard]] bool isFrameInProgress() const { return _isFrameStarted; }
 
         [[nodiscard]] inline VkCommandBuffer getCurrentCommandBuffer() const {
@@ -34,11 +39,35 @@ namespace Divide {
             return _currentFrameIndex;
         }
 
+        // The depth attachment of the image being rendered to this frame. See SwapChain::RenderPassType for when it can be sampled.
+        [[nodiscard]] inline VkImage getCurrentDepthImage() const {
+            assert(_isFrameStarted && "Cannot get depth image when frame not in progress!");
+            return _swapChainPtr->getDepthImage(static_cast<int>(_currentImageIndex));
+        }
+
+        [[nodiscard]] inline VkImageView getCurrentDepthImageView() const {
+            assert(_isFrameStarted && "Cannot get depth image view when frame not in progress!");
+            return _swapChainPtr->getDepthImageView(static_cast<int>(_currentImageIndex));
+        }
+
+        // This frame's G-buffer, for the deferred lighting subpass's input attachments
+        [[nodiscard]] inline VkImageView getCurrentGBufferImageView(const SwapChain::GBufferAttachment attachment) const {
+            assert(_isFrameStarted && "Cannot get G-buffer image view when frame not in progress!");
+            return _swapChainPtr->getGBufferImageView(static_cast<int>(_currentImageIndex), attachment);
+        }
+
+        // Rebuilds the swap chain with (or without) the deferred render pass and G-buffer. Call outside of a frame,
+        // before creating anything that uses the render passes.
+        void setDeferredShading(bool enabled);
+
         [[nodiscard]] VkCommandBuffer beginFrame();
 
         void endFrame();
-        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, SwapChain::RenderPassType type = SwapChain::RenderPassType::SINGLE);
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+        // Starts in the G-buffer subpass; nextSubpass() moves on to lighting. Ends with endSwapChainRenderPass().
+        void beginDeferredRenderPass(VkCommandBuffer commandBuffer);
+        void nextSubpass(VkCommandBuffer commandBuffer);
 
     private:
         void createCommandBuffers();
@@ -52,5 +81,6 @@ namespace Divide {
         uint32_t _currentImageIndex{ 0u };
         int _currentFrameIndex{ 0 };
         bool _isFrameStarted{ false };
+        bool _deferredShading{ false };
     };
 }; //namespace Divide;
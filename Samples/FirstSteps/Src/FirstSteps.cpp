@@ -2,10 +2,28 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <string>
+
+int main(int argc, char** argv) {
+    // Shading path override, so forward and deferred can be compared on the same build
+    std::optional<bool> deferredShading{};
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--forward" || argument == "--deferred") {
+            deferredShading = argument == "--deferred";
+        } else {
+            std::cerr << "Unknown argument [ " << argument << " ]" << std::endl
+                      << "Usage: FirstSteps [--forward | --deferred]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
-int main() {
     Divide::Application app{};
+    if (deferredShading.has_value()) {
+        app.setDeferredShading(*deferredShading);
+    }
 
     try {
         app.run();
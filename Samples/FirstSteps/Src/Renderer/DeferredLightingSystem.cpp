@@ -0,0 +1,132 @@
+#include "DeferredLightingSystem.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Divide {
+
+    // 6 faces of 2 triangles, built from gl_VertexIndex in light_volume.vert
+    constexpr uint32_t LIGHT_VOLUME_VERTEX_COUNT = 36u;
+
+    DeferredLightingSystem::DeferredLightingSystem(Device& device, VkRenderPass deferredRenderPass, VkDescriptorSetLayout globalSetLayout, const uint32_t frameCount)
+        : _device{ device }
+    {
+        _gBufferSetLayoutPtr = DescriptorSetLayout::Builder(_device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build();
+
+        _gBufferPoolPtr = DescriptorPool::Builder(_device)
+            .setMaxSets(frameCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3 * frameCount)
+            .build();
+
+        // Allocated empty: nothing reads them before render() writes them
+        _gBufferSets.resize(frameCount);
+        for (VkDescriptorSet& set : _gBufferSets) {
+            if (!DescriptorWriter(*_gBufferSetLayoutPtr, *_gBufferPoolPtr).build(set)) {
+                throw std::runtime_error("Failed to allocate G-buffer descriptors!");
+            }
+        }
+
+        createPipelineLayout(globalSetLayout);
+        createPipelines(deferredRenderPass);
+    }
+
+    DeferredLightingSystem::~DeferredLightingSystem()
+    {
+        vkDestroyPipelineLayout(_device.device(), _pipelineLayout, nullptr);
+    }
+
+    void DeferredLightingSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, _gBufferSetLayoutPtr->getDescriptorSetLayout() };
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+        if (vkCreatePipelineLayout(_device.device(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+    }
+
+    void DeferredLightingSystem::createPipelines(VkRenderPass renderPass) {
+        assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+
+        {
+            // Overwrites the swap chain image wherever something was drawn; the depth test is done by hand, against 1
+            PipelineConfigInfo pipelineConfig{};
+            Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+            pipelineConfig.attributeDescriptions.clear();
+            pipelineConfig.bindingDescriptions.clear();
+            pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+            pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.subpass = SwapChain::LIGHTING_SUBPASS;
+            pipelineConfig.pipelineLayout = _pipelineLayout;
+            _ambientPipelinePtr = std::make_unique<Pipeline>(_device, "Shaders/fullscreen.vert.spv", "Shaders/deferred_ambient.frag.spv", pipelineConfig);
+        }
+        {
+            // The volume's far faces, wherever the scene is in front of them. Lights add up.
+            PipelineConfigInfo pipelineConfig{};
+            Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+            pipelineConfig.attributeDescriptions.clear();
+            pipelineConfig.bindingDescriptions.clear();
+            pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+            pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+            pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+            pipelineConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+            pipelineConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.subpass = SwapChain::LIGHTING_SUBPASS;
+            pipelineConfig.pipelineLayout = _pipelineLayout;
+            _lightVolumePipelinePtr = std::make_unique<Pipeline>(_device, "Shaders/light_volume.vert.spv", "Shaders/light_volume.frag.spv", pipelineConfig);
+        }
+    }
+
+    void DeferredLightingSystem::render(FrameInfo& frameInfo, const GBufferViews& gBuffer, const uint32_t lightCount) {
+        assert(static_cast<size_t>(frameInfo.frameIndex) < _gBufferSets.size() && "Invalid frame index");
+
+        // This frame index's previous use has completed (its fence signalled), so the set is free to rewrite
+        VkDescriptorSet& gBufferSet = _gBufferSets[frameInfo.frameIndex];
+        VkDescriptorImageInfo albedoInfo{ VK_NULL_HANDLE, gBuffer.albedo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        VkDescriptorImageInfo normalInfo{ VK_NULL_HANDLE, gBuffer.normal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        VkDescriptorImageInfo depthInfo{ VK_NULL_HANDLE, gBuffer.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+        DescriptorWriter(*_gBufferSetLayoutPtr, *_gBufferPoolPtr)
+            .writeImage(0, &albedoInfo)
+            .writeImage(1, &normalInfo)
+            .writeImage(2, &depthInfo)
+            .overwrite(gBufferSet);
+
+        const VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, gBufferSet };
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                _pipelineLayout,
+                                0,
+                                2,
+                                descriptorSets,
+                                GLOBAL_DYNAMIC_OFFSET_COUNT,
+                                frameInfo.globalOffsets.data()
+        );
+
+        _ambientPipelinePtr->bind(frameInfo.commandBuffer);
+        vkCmdDraw(frameInfo.commandBuffer, 3, 1, 0, 0);
+        frameInfo.stats.drawCalls += 1u;
+        frameInfo.stats.triangles += 1u;
+
+        if (lightCount == 0u) {
+            return;
+        }
+
+        _lightVolumePipelinePtr->bind(frameInfo.commandBuffer);
+        vkCmdDraw(frameInfo.commandBuffer, LIGHT_VOLUME_VERTEX_COUNT, lightCount, 0, 0);
+        frameInfo.stats.drawCalls += 1u;
+        frameInfo.stats.triangles += uint64_t{ LIGHT_VOLUME_VERTEX_COUNT / 3u } * lightCount;
+    }
+}; //namespace Divide
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Utilities/Pipeline.h"
+#include "Utilities/Device.h"
+#include "Utilities/Descriptors.h"
+#include "Utilities/SwapChain.h"
+
+#include "Engine/FrameInfo.h"
+
+#include <memory>
+#include <vector>
+
+namespace Divide {
+    // The lighting subpass of the deferred render pass (SwapChain::LIGHTING_SUBPASS). Reads the G-buffer and depth
+    // written by the previous subpass as input attachments, so on tilers they never leave tile memory, and shades in two
+    // draws: a fullscreen triangle for the ambient term, then every light's volume (a cube around its range, one
+    // instanced draw) added on top. Each pixel only pays for the lights whose volume covers it.
+    class DeferredLightingSystem {
+    public:
+        // This frame's G-buffer (Renderer::getCurrentGBufferImageView()) and depth buffer
+        struct GBufferViews {
+            VkImageView albedo = VK_NULL_HANDLE;
+            VkImageView normal = VK_NULL_HANDLE;
+            VkImageView depth = VK_NULL_HANDLE;
+        };
+
+        DeferredLightingSystem(Device& device, VkRenderPass deferredRenderPass, VkDescriptorSetLayout globalSetLayout, uint32_t frameCount);
+        ~DeferredLightingSystem();
+
+        DeferredLightingSystem(const DeferredLightingSystem&) = delete;
+        DeferredLightingSystem& operator=(const DeferredLightingSystem&) = delete;
+        DeferredLightingSystem(DeferredLightingSystem&&) = delete;
+        DeferredLightingSystem& operator=(DeferredLightingSystem&&) = delete;
+
+        // Records into the lighting subpass. The first 'lightCount' lights of the global set's LIGHTS binding are drawn,
+        // as written by PointLightSystem::update().
+        void render(FrameInfo& frameInfo, const GBufferViews& gBuffer, uint32_t lightCount);
+
+    private:
+        void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+        void createPipelines(VkRenderPass renderPass);
+
+        Device& _device;
+
+        // Set 1: albedo, normal and depth input attachments. The views change with the swap chain image, so every
+        // frame in flight has its own set, rewritten in render().
+        std::unique_ptr<DescriptorSetLayout> _gBufferSetLayoutPtr{};
+        std::unique_ptr<DescriptorPool> _gBufferPoolPtr{};
+        std::vector<VkDescriptorSet> _gBufferSets{};
+
+        std::unique_ptr<Pipeline> _ambientPipelinePtr{};
+        std::unique_ptr<Pipeline> _lightVolumePipelinePtr{};
+        VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+    };
+}; //namespace Divide
@@ -0,0 +1,335 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace Divide {
+
+    // Matches local_size_x/y in depth_reduce.comp
+    constexpr uint32_t REDUCE_GROUP_SIZE = 8u;
+
+    // Matches Push in depth_reduce.comp
+    struct ReducePushConstants {
+        uint32_t srcWidth = 0u;
+        uint32_t srcHeight = 0u;
+        uint32_t dstWidth = 0u;
+        uint32_t dstHeight = 0u;
+    };
+
+    namespace {
+        uint32_t previousPowerOfTwo(const uint32_t value) {
+            uint32_t result = 1u;
+            while (result * 2u <= value) {
+                result *= 2u;
+            }
+            return result;
+        }
+
+        VkImageAspectFlags getDepthAspects(const VkFormat format) {
+            // Layout transitions of combined depth/stencil images have to name both aspects
+            switch (format) {
+                case VK_FORMAT_D16_UNORM_S8_UINT:
+                case VK_FORMAT_D24_UNORM_S8_UINT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+                default: break;
+            }
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        }
+    };
+
+    DepthPyramid::DepthPyramid(Device& device, const uint32_t frameCount)
+        : _device{ device }
+        , _frameCount{ frameCount }
+    {
+        _setLayoutPtr = DescriptorSetLayout::Builder(_device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+        _poolPtr = DescriptorPool::Builder(_device)
+            .setMaxSets(frameCount + MAX_LEVELS)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount + MAX_LEVELS)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount + MAX_LEVELS)
+            .build();
+
+        createPipelineLayout();
+        _pipelinePtr = std::make_unique<ComputePipeline>(_device, "Shaders/depth_reduce.comp.spv", _pipelineLayout);
+        createSampler();
+        createResources({ 1u, 1u });
+    }
+
+    DepthPyramid::~DepthPyramid()
+    {
+        destroyResources();
+        vkDestroySampler(_device.device(), _sampler, nullptr);
+        vkDestroyPipelineLayout(_device.device(), _pipelineLayout, nullptr);
+    }
+
+    void DepthPyramid::createPipelineLayout() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(ReducePushConstants);
+
+        const VkDescriptorSetLayout setLayout = _setLayoutPtr->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(_device.device(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+    }
+
+    void DepthPyramid::createSampler() {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.minLod = 0.f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        if (vkCreateSampler(_device.device(), &samplerInfo, nullptr, &_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create depth pyramid sampler!");
+        }
+    }
+
+    void DepthPyramid::createResources(const VkExtent2D extent) {
+        _extent = extent;
+        _width = previousPowerOfTwo(std::max(extent.width, 1u));
+        _height = previousPowerOfTwo(std::max(extent.height, 1u));
+        _levelCount = 1u;
+        while ((std::max(_width, _height) >> _levelCount) > 0u) {
+            ++_levelCount;
+        }
+        assert(_levelCount <= MAX_LEVELS && "Depth pyramid too large");
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { _width, _height, 1u };
+        imageInfo.mipLevels = _levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = VK_FORMAT_R32_SFLOAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        _device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _image, _imageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = _image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = _levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(_device.device(), &viewInfo, nullptr, &_imageView) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create depth pyramid view!");
+        }
+
+        _levelViews.resize(_levelCount);
+        for (uint32_t level = 0u; level < _levelCount; ++level) {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            if (vkCreateImageView(_device.device(), &viewInfo, nullptr, &_levelViews[level]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create depth pyramid level view!");
+            }
+        }
+
+        // Every later access expects GENERAL
+        {
+            VkCommandBuffer commandBuffer = _device.beginSingleTimeCommands();
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = _image;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, _levelCount, 0u, 1u };
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            // Until the first build(), so an occlusion test reads "nothing drawn" rather than garbage
+            const VkClearColorValue farPlane{ { 1.f, 1.f, 1.f, 1.f } };
+            vkCmdClearColorImage(commandBuffer, _image, VK_IMAGE_LAYOUT_GENERAL, &farPlane, 1, &barrier.subresourceRange);
+
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            _device.endSingleTimeCommands(commandBuffer);
+        }
+
+        _poolPtr->resetPool();
+        _depthSets.resize(_frameCount);
+        for (VkDescriptorSet& set : _depthSets) {
+            VkDescriptorImageInfo dstInfo{ VK_NULL_HANDLE, _levelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+            if (!DescriptorWriter(*_setLayoutPtr, *_poolPtr).writeImage(1, &dstInfo).build(set)) {
+                throw std::runtime_error("Failed to allocate depth pyramid descriptors!");
+            }
+        }
+
+        _levelSets.resize(_levelCount - 1u);
+        for (uint32_t level = 1u; level < _levelCount; ++level) {
+            VkDescriptorImageInfo srcInfo{ _sampler, _levelViews[level - 1u], VK_IMAGE_LAYOUT_GENERAL };
+            VkDescriptorImageInfo dstInfo{ VK_NULL_HANDLE, _levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+            if (!DescriptorWriter(*_setLayoutPtr, *_poolPtr).writeImage(0, &srcInfo).writeImage(1, &dstInfo).build(_levelSets[level - 1u])) {
+                throw std::runtime_error("Failed to allocate depth pyramid descriptors!");
+            }
+        }
+
+        ++_generation;
+    }
+
+    void DepthPyramid::destroyResources() {
+        for (VkImageView view : _levelViews) {
+            vkDestroyImageView(_device.device(), view, nullptr);
+        }
+        _levelViews.clear();
+        vkDestroyImageView(_device.device(), _imageView, nullptr);
+        vkDestroyImage(_device.device(), _image, nullptr);
+        _device.freeMemory(_imageMemory);
+
+        _imageView = VK_NULL_HANDLE;
+        _image = VK_NULL_HANDLE;
+    }
+
+    void DepthPyramid::setExtent(const VkExtent2D extent) {
+        if (extent.width == _extent.width && extent.height == _extent.height) {
+            return;
+        }
+
+        // Resizes follow swap chain recreation, which already waited for the device
+        vkDeviceWaitIdle(_device.device());
+        destroyResources();
+        createResources(extent);
+    }
+
+    VkDescriptorImageInfo DepthPyramid::getDescriptorInfo() const {
+        return VkDescriptorImageInfo{ _sampler, _imageView, VK_IMAGE_LAYOUT_GENERAL };
+    }
+
+    void DepthPyramid::build(VkCommandBuffer commandBuffer, const uint32_t frameIndex, VkImage depthImage, VkImageView depthView, const VkFormat depthFormat) {
+        assert(frameIndex < _frameCount && "Invalid frame index");
+
+        const VkImageSubresourceRange depthRange{ getDepthAspects(depthFormat), 0u, 1u, 0u, 1u };
+
+        // The depth buffer becomes readable, and the pyramid's previous contents may still be read by the last frame's
+        // occlusion tests
+        {
+            std::array<VkImageMemoryBarrier, 2> barriers{};
+            for (VkImageMemoryBarrier& barrier : barriers) {
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            }
+            barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barriers[0].image = depthImage;
+            barriers[0].subresourceRange = depthRange;
+
+            barriers[1].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barriers[1].image = _image;
+            barriers[1].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0u, _levelCount, 0u, 1u };
+
+            // Depth is written in both fragment test stages
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr,
+                                 static_cast<uint32_t>(barriers.size()),
+                                 barriers.data());
+        }
+
+        // This frame index's previous build has completed (its fence signalled), so the set is free to rewrite
+        VkDescriptorImageInfo depthInfo{ _sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        DescriptorWriter(*_setLayoutPtr, *_poolPtr).writeImage(0, &depthInfo).overwrite(_depthSets[frameIndex]);
+
+        _pipelinePtr->bind(commandBuffer);
+
+        uint32_t srcWidth = _extent.width;
+        uint32_t srcHeight = _extent.height;
+        for (uint32_t level = 0u; level < _levelCount; ++level) {
+            const VkDescriptorSet set = level == 0u ? _depthSets[frameIndex] : _levelSets[level - 1u];
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &set, 0, nullptr);
+
+            ReducePushConstants push{};
+            push.srcWidth = srcWidth;
+            push.srcHeight = srcHeight;
+            push.dstWidth = std::max(_width >> level, 1u);
+            push.dstHeight = std::max(_height >> level, 1u);
+            vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstants), &push);
+            vkCmdDispatch(commandBuffer,
+                          ComputePipeline::getGroupCount(push.dstWidth, REDUCE_GROUP_SIZE),
+                          ComputePipeline::getGroupCount(push.dstHeight, REDUCE_GROUP_SIZE),
+                          1u);
+
+            // Read by the next level, or by whoever samples the finished pyramid
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = _image;
+            barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1u, 0u, 1u };
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            srcWidth = push.dstWidth;
+            srcHeight = push.dstHeight;
+        }
+
+        // Hand the depth buffer back to the following render pass
+        {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = depthImage;
+            barrier.subresourceRange = depthRange;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                                 0,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr,
+                                 1,
+                                 &barrier);
+        }
+    }
+}; //namespace Divide
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Utilities/Pipeline.h"
+#include "Utilities/Device.h"
+#include "Utilities/Descriptors.h"
+
+#include <memory>
+#include <vector>
+
+namespace Divide {
+    // Hierarchical depth (Hi-Z) buffer: a mip chain where every texel holds the farthest depth of the area it covers,
+    // built from a frame's depth buffer with a compute downsample (depth_reduce.comp). Level 0 is the depth buffer's
+    // size rounded down to powers of two. Occlusion tests sample it to reject anything behind what was already drawn
+    // (see GpuCullingSystem).
+    //
+    // The image always stays in VK_IMAGE_LAYOUT_GENERAL. It starts out 1x1 so descriptors pointing at it are valid
+    // before the first build().
+    class DepthPyramid {
+    public:
+        static constexpr uint32_t MAX_LEVELS = 16u;
+
+        DepthPyramid(Device& device, uint32_t frameCount);
+        ~DepthPyramid();
+
+        DepthPyramid(const DepthPyramid&) = delete;
+        DepthPyramid& operator=(const DepthPyramid&) = delete;
+        DepthPyramid(DepthPyramid&&) = delete;
+        DepthPyramid& operator=(DepthPyramid&&) = delete;
+
+        // Resizes the pyramid for a depth buffer of 'extent', waiting for the device to idle if it changed. Call at the
+        // start of a frame, before recording anything that references the pyramid.
+        void setExtent(VkExtent2D extent);
+
+        // Records the downsample of 'depthImage' (of the size last given to setExtent()). The image is expected in, and
+        // handed back in, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL with its contents stored
+        // (see SwapChain::RenderPassType::FIRST). Compute shaders can sample the pyramid afterwards.
+        void build(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkImage depthImage, VkImageView depthView, VkFormat depthFormat);
+
+        // For a combined image sampler covering every level, in VK_IMAGE_LAYOUT_GENERAL
+        [[nodiscard]] VkDescriptorImageInfo getDescriptorInfo() const;
+        [[nodiscard]] inline uint32_t getWidth() const { return _width; }
+        [[nodiscard]] inline uint32_t getHeight() const { return _height; }
+        [[nodiscard]] inline uint32_t getLevelCount() const { return _levelCount; }
+        // Changes whenever the image is recreated, at which point descriptors pointing at it must be rewritten
+        [[nodiscard]] inline uint32_t getGeneration() const { return _generation; }
+
+    private:
+        void createPipelineLayout();
+        void createSampler();
+        void createResources(VkExtent2D extent);
+        void destroyResources();
+
+        Device& _device;
+        const uint32_t _frameCount;
+
+        VkExtent2D _extent{ 0u, 0u };
+        uint32_t _width = 0u;
+        uint32_t _height = 0u;
+        uint32_t _levelCount = 0u;
+        uint32_t _generation = 0u;
+
+        VkImage _image = VK_NULL_HANDLE;
+        MemoryAllocation _imageMemory{};
+        // Every level, for sampling
+        VkImageView _imageView = VK_NULL_HANDLE;
+        // One per level, for the downsample's reads and writes
+        std::vector<VkImageView> _levelViews{};
+        // Nearest filtering: the reductions are done by hand
+        VkSampler _sampler = VK_NULL_HANDLE;
+
+        // Binding 0: source (combined image sampler), binding 1: destination level (storage image)
+        std::unique_ptr<DescriptorSetLayout> _setLayoutPtr{};
+        std::unique_ptr<DescriptorPool> _poolPtr{};
+        // Level 0 reads the current depth buffer, so every frame in flight has its own set, rewritten in build()
+        std::vector<VkDescriptorSet> _depthSets{};
+        // Level i reads level i - 1, starting at level 1
+        std::vector<VkDescriptorSet> _levelSets{};
+
+        std::unique_ptr<ComputePipeline> _pipelinePtr{};
+        VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+    };
+}; //namespace Divide
@@ -0,0 +1,361 @@
+#include "GpuCullingSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace Divide {
+
+    // Matches local_size_x in cull.comp
+    constexpr uint32_t CULL_GROUP_SIZE = 64u;
+
+    // Matches the PASS_* and FLAG_* constants in cull.comp
+    constexpr uint32_t PASS_FRUSTUM = 0u;
+    constexpr uint32_t PASS_EARLY = 1u;
+    constexpr uint32_t PASS_LATE = 2u;
+    constexpr uint32_t FLAG_COMPACT = 1u;
+    constexpr uint32_t FLAG_OCCLUSION = 2u;
+
+    // Matches CullData in cull.comp (std140)
+    struct CullData {
+        std::array<glm::vec4, 6> frustumPlanes{};
+        glm::mat4 viewMatrix{ 1.f };
+        glm::vec4 projection{};
+        uint32_t objectCount = 0u;
+        uint32_t flags = 0u;
+        uint32_t padding[2]{};
+    };
+
+    // Matches Push in cull.comp
+    struct CullPushConstants {
+        uint32_t pass = PASS_FRUSTUM;
+        uint32_t commandBase = 0u;
+        uint32_t countBase = 0u;
+    };
+
+    GpuCullingSystem::GpuCullingSystem(Device& device, GpuScene& gpuScene, DepthPyramid& depthPyramid, FrameAllocator& frameAllocator, const uint32_t frameCount)
+        : _device{ device }
+        , _gpuScene{ gpuScene }
+        , _depthPyramid{ depthPyramid }
+        , _compact{ device.supportsDrawIndirectCount() }
+    {
+        _submissions.resize(frameCount);
+
+        _statsBuffer = std::make_unique<Buffer>(_device,
+                                                sizeof(uint32_t),
+                                                frameCount,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                std::max(_device.properties.limits.minStorageBufferOffsetAlignment, VkDeviceSize{ 1u }));
+        if (_statsBuffer->map() != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map the culling stats buffer!");
+        }
+
+        createDescriptors(frameAllocator);
+        createPipelineLayout();
+        _pipelinePtr = std::make_unique<ComputePipeline>(_device, "Shaders/cull.comp.spv", _pipelineLayout);
+    }
+
+    GpuCullingSystem::~GpuCullingSystem()
+    {
+        vkDestroyPipelineLayout(_device.device(), _pipelineLayout, nullptr);
+    }
+
+    void GpuCullingSystem::createDescriptors(FrameAllocator& frameAllocator) {
+        _setLayoutPtr = DescriptorSetLayout::Builder(_device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+        _poolPtr = DescriptorPool::Builder(_device)
+            .setMaxSets(1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 4)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+            .build();
+
+        // The frame allocator and stats buffer never move, so they're only written once
+        auto cullDataInfo = frameAllocator.descriptorInfo(sizeof(CullData));
+        auto statsInfo = _statsBuffer->descriptorInfo(sizeof(uint32_t));
+        DescriptorWriter(*_setLayoutPtr, *_poolPtr)
+            .writeBuffer(4, &cullDataInfo)
+            .writeBuffer(6, &statsInfo)
+            .build(_descriptorSet);
+
+        writeDescriptor();
+    }
+
+    void GpuCullingSystem::writeDescriptor() {
+        // Reallocated scene buffers mean a new capacity, so the visibility buffer follows
+        if (_visibilityBuffer == nullptr || _sceneGeneration != _gpuScene.getGeneration()) {
+            _visibilityBuffer = std::make_unique<Buffer>(_device,
+                                                         sizeof(uint32_t),
+                                                         _gpuScene.getCapacity(),
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            _visibilityRebuilds = ~0u;
+        }
+
+        auto objectInfo = _gpuScene.getDescriptorInfo(GpuScene::BufferType::OBJECT_INFO);
+        auto commandInfo = _gpuScene.getDescriptorInfo(GpuScene::BufferType::DRAW_COMMANDS);
+        auto countInfo = _gpuScene.getDescriptorInfo(GpuScene::BufferType::DRAW_COUNTS);
+        auto visibilityInfo = _visibilityBuffer->descriptorInfo();
+        auto pyramidInfo = _depthPyramid.getDescriptorInfo();
+
+        DescriptorWriter(*_setLayoutPtr, *_poolPtr)
+            .writeBuffer(0, &objectInfo)
+            .writeBuffer(1, &commandInfo)
+            .writeBuffer(2, &countInfo)
+            .writeBuffer(3, &visibilityInfo)
+            .writeImage(5, &pyramidInfo)
+            .overwrite(_descriptorSet);
+
+        _sceneGeneration = _gpuScene.getGeneration();
+        _pyramidGeneration = _depthPyramid.getGeneration();
+    }
+
+    void GpuCullingSystem::createPipelineLayout() {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullPushConstants);
+
+        const VkDescriptorSetLayout setLayout = _setLayoutPtr->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        if (vkCreatePipelineLayout(_device.device(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+    }
+
+    void GpuCullingSystem::readBack(FrameInfo& frameInfo, const uint32_t frameIndex) {
+        Submission& submission = _submissions[frameIndex];
+        if (!submission.recorded) {
+            return;
+        }
+        submission.recorded = false;
+
+        // Reallocated buffers lost the results
+        if (submission.generation != _gpuScene.getGeneration()) {
+            return;
+        }
+
+        const uint32_t capacity = _gpuScene.getCapacity();
+        const uint32_t* counts = _gpuScene.getDrawCounts(frameIndex);
+        uint32_t visible = 0u;
+        for (uint32_t phase = 0u; phase < submission.phaseCount; ++phase) {
+            for (uint32_t batch = 0u; batch < submission.batchCount; ++batch) {
+                visible += counts[capacity * phase + batch];
+            }
+        }
+        const uint32_t occluded = *reinterpret_cast<const uint32_t*>(static_cast<const std::byte*>(_statsBuffer->getMappedMemory()) + _statsBuffer->getAlignmentSize() * frameIndex);
+
+        _stats.visible = visible;
+        _stats.occluded = occluded;
+        _stats.frustumCulled = submission.objectCount - visible - occluded;
+        frameInfo.stats.objects += visible;
+        frameInfo.stats.objectsCulled += _stats.frustumCulled;
+        frameInfo.stats.objectsOccluded += occluded;
+        frameInfo.stats.lodHistogram[0] += visible;
+
+        // The commands can only be matched up with their batches if the layout hasn't been rebuilt since
+        if (submission.rebuilds == _gpuScene.getStats().rebuilds) {
+            const VkDrawIndexedIndirectCommand* commands = _gpuScene.getDrawCommands(frameIndex);
+            const auto& batches = _gpuScene.getBatches();
+            for (uint32_t phase = 0u; phase < submission.phaseCount; ++phase) {
+                for (uint32_t batch = 0u; batch < submission.batchCount; ++batch) {
+                    const uint32_t first = capacity * phase + batches[batch].firstCommand;
+                    const uint32_t count = _compact ? counts[capacity * phase + batch] : batches[batch].commandCount;
+                    for (uint32_t command = first; command < first + count; ++command) {
+                        frameInfo.stats.triangles += uint64_t{ commands[command].indexCount / 3u } * commands[command].instanceCount;
+                    }
+                }
+            }
+        }
+
+        if (submission.validated) {
+            // Everything in the frustum is either drawn or occluded
+            _stats.validatedFrames += 1u;
+            if (visible + occluded != submission.expectedVisible) {
+                _stats.mismatches += 1u;
+                std::cerr << "GPU culling mismatch: " << visible + occluded << " objects in the frustum on the GPU, " << submission.expectedVisible << " on the CPU" << std::endl;
+            }
+        }
+    }
+
+    void GpuCullingSystem::cull(FrameInfo& frameInfo) {
+        const uint32_t frameIndex = static_cast<uint32_t>(frameInfo.frameIndex);
+        assert(frameIndex < _submissions.size() && "Invalid frame index");
+
+        // The frame's fence has signalled, so whatever it wrote last time is final
+        readBack(frameInfo, frameIndex);
+
+        // The scene's buffers or the pyramid were reallocated. Both wait for the device to idle first, so the set is unused.
+        if (_sceneGeneration != _gpuScene.getGeneration() || _pyramidGeneration != _depthPyramid.getGeneration()) {
+            writeDescriptor();
+        }
+
+        const uint32_t objectCount = _gpuScene.getObjectCount();
+        const uint32_t batchCount = static_cast<uint32_t>(_gpuScene.getBatches().size());
+        if (objectCount == 0u) {
+            return;
+        }
+
+        const Camera& camera = frameInfo.camera;
+        CullData cullData{};
+        cullData.frustumPlanes = camera.getFrustumPlanes();
+        cullData.viewMatrix = camera.getView();
+        cullData.projection = { camera.getProjection()[0][0], camera.getProjection()[1][1], camera.getProjection()[2][2], camera.getProjection()[3][2] };
+        cullData.objectCount = objectCount;
+        cullData.flags = (_compact ? FLAG_COMPACT : 0u) | (_occlusionCulling && camera.isPerspective() ? FLAG_OCCLUSION : 0u);
+        _cullDataOffset = frameInfo.frameAllocator.push(cullData);
+
+        Submission& submission = _submissions[frameIndex];
+        submission.recorded = true;
+        submission.generation = _gpuScene.getGeneration();
+        submission.rebuilds = _gpuScene.getStats().rebuilds;
+        submission.objectCount = objectCount;
+        submission.batchCount = batchCount;
+        submission.phaseCount = _occlusionCulling ? 2u : 1u;
+        submission.validated = _validate;
+        if (_validate) {
+            // Same spheres and planes as the GPU gets this frame
+            _culler.clear();
+            _culler.reserve(objectCount);
+            for (const GpuScene::ObjectInfo& info : _gpuScene.getObjectInfos()) {
+                _culler.addSphere(info.boundingSphere);
+            }
+            submission.expectedVisible = _culler.cull(cullData.frustumPlanes, _visibleObjects);
+        }
+
+        const VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+        const VkBuffer counts = _gpuScene.getBuffer(GpuScene::BufferType::DRAW_COUNTS);
+        const VkDeviceSize countOffset = _gpuScene.getFrameOffset(GpuScene::BufferType::DRAW_COUNTS, frameIndex);
+        const VkDeviceSize countSize = sizeof(uint32_t) * GpuScene::MAX_DRAW_PHASES * _gpuScene.getCapacity();
+
+        // This frame index's previous draws read the counts, and the last late pass wrote the visibility
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0,
+                                 1,
+                                 &barrier,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr);
+        }
+
+        vkCmdFillBuffer(commandBuffer, counts, countOffset, countSize, 0u);
+        vkCmdFillBuffer(commandBuffer, _statsBuffer->getBuffer(), _statsBuffer->getAlignmentSize() * frameIndex, sizeof(uint32_t), 0u);
+        // New slots: nothing was visible last frame, so the early pass draws nothing and the late pass everything unoccluded
+        const uint32_t rebuilds = _gpuScene.getStats().rebuilds;
+        if (_visibilityRebuilds != rebuilds) {
+            vkCmdFillBuffer(commandBuffer, _visibilityBuffer->getBuffer(), 0u, VK_WHOLE_SIZE, 0u);
+            _visibilityRebuilds = rebuilds;
+        }
+
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0,
+                                 1,
+                                 &barrier,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr);
+        }
+
+        dispatch(commandBuffer, frameIndex, _occlusionCulling ? PASS_EARLY : PASS_FRUSTUM, 0u);
+    }
+
+    void GpuCullingSystem::cullOccluded(FrameInfo& frameInfo) {
+        const uint32_t frameIndex = static_cast<uint32_t>(frameInfo.frameIndex);
+        assert(_occlusionCulling && "Occlusion culling is disabled");
+
+        // cull() had nothing to do
+        if (!_submissions[frameIndex].recorded) {
+            return;
+        }
+
+        // The early pass read the visibility this pass overwrites
+        {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        dispatch(frameInfo.commandBuffer, frameIndex, PASS_LATE, 1u);
+    }
+
+    void GpuCullingSystem::dispatch(VkCommandBuffer commandBuffer, const uint32_t frameIndex, const uint32_t pass, const uint32_t drawPhase) {
+        _pipelinePtr->bind(commandBuffer);
+
+        const uint32_t dynamicOffsets[] = {
+            _gpuScene.getFrameOffset(GpuScene::BufferType::OBJECT_INFO, frameIndex),
+            _gpuScene.getFrameOffset(GpuScene::BufferType::DRAW_COMMANDS, frameIndex),
+            _gpuScene.getFrameOffset(GpuScene::BufferType::DRAW_COUNTS, frameIndex),
+            _cullDataOffset,
+            static_cast<uint32_t>(_statsBuffer->getAlignmentSize() * frameIndex)
+        };
+        vkCmdBindDescriptorSets(commandBuffer,
+                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                _pipelineLayout,
+                                0,
+                                1,
+                                &_descriptorSet,
+                                static_cast<uint32_t>(std::size(dynamicOffsets)),
+                                dynamicOffsets
+        );
+
+        CullPushConstants push{};
+        push.pass = pass;
+        push.commandBase = _gpuScene.getCapacity() * drawPhase;
+        push.countBase = _gpuScene.getCapacity() * drawPhase;
+        vkCmdPushConstants(commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+        vkCmdDispatch(commandBuffer, ComputePipeline::getGroupCount(_gpuScene.getObjectCount(), CULL_GROUP_SIZE), 1u, 1u);
+
+        // The draws read the phase's commands and counts as indirect parameters, and the host reads them (and the
+        // stats) back once the fence signals
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+    }
+}; //namespace Divide
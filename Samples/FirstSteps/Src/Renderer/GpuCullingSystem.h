@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Utilities/Pipeline.h"
+#include "Utilities/Device.h"
+#include "Utilities/Buffer.h"
+#include "Utilities/Descriptors.h"
+#include "Utilities/FrameAllocator.h"
+#include "Utilities/FrustumCuller.h"
+
+#include "Engine/FrameInfo.h"
+#include "Engine/GpuScene.h"
+
+#include "DepthPyramid.h"
+
+#include <memory>
+#include <vector>
+
+namespace Divide {
+    // Culls every GpuScene object in a compute shader (cull.comp) and writes the indirect draw commands and per-batch
+    // draw counts SimpleRenderSystem's INDIRECT mode consumes, so the CPU never looks at per-object visibility. With
+    // drawIndirectCount the survivors are compacted to the start of their batch; without it every slot gets a
+    // command and culled objects draw zero instances.
+    //
+    // Frustum culling alone fills draw phase 0. Occlusion culling splits the frame in two:
+    //  1. cull() writes phase 0 with what was visible last frame, which is drawn in a SwapChain::RenderPassType::FIRST pass
+    //  2. the depth pyramid is built from that pass' depth buffer
+    //  3. cullOccluded() tests every object against the pyramid, remembers the result for next frame, and writes
+    //     phase 1 with what step 1 missed, which is drawn in a LAST pass
+    //
+    // The visible counts are read back once the frame's fence has signalled, so the reported stats lag by the number
+    // of frames in flight.
+    class GpuCullingSystem {
+    public:
+        struct Stats {
+            // Last frame read back
+            uint32_t visible = 0u;
+            uint32_t frustumCulled = 0u;
+            uint32_t occluded = 0u;
+            // Frames compared against the CPU reference (FrustumCuller) and how many of them disagreed
+            uint32_t validatedFrames = 0u;
+            uint32_t mismatches = 0u;
+        };
+
+        GpuCullingSystem(Device& device, GpuScene& gpuScene, DepthPyramid& depthPyramid, FrameAllocator& frameAllocator, uint32_t frameCount);
+        ~GpuCullingSystem();
+
+        GpuCullingSystem(const GpuCullingSystem&) = delete;
+        GpuCullingSystem& operator=(const GpuCullingSystem&) = delete;
+        GpuCullingSystem(GpuCullingSystem&&) = delete;
+        GpuCullingSystem& operator=(GpuCullingSystem&&) = delete;
+
+        // Records the frustum (or, with occlusion culling, early) pass for the frame. Call after GpuScene::update() and
+        // outside of any render pass. Also folds the results of the last time this frame index was used into frameInfo.stats.
+        void cull(FrameInfo& frameInfo);
+        // Records the late occlusion pass. Call after cull() and after the depth pyramid was built from what it drew.
+        void cullOccluded(FrameInfo& frameInfo);
+
+        // Only valid with a perspective camera; other projections skip the occlusion test but still split the frame
+        inline void setOcclusionCulling(const bool state) { _occlusionCulling = state; }
+        [[nodiscard]] inline bool isOcclusionCullingEnabled() const { return _occlusionCulling; }
+        // Also run the frustum test on the CPU and compare visible counts once the GPU results are back
+        inline void setValidation(const bool state) { _validate = state; }
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+
+    private:
+        // What was recorded for a frame index, to make sense of its results later
+        struct Submission {
+            bool recorded = false;
+            uint32_t generation = 0u;
+            uint32_t rebuilds = 0u;
+            uint32_t objectCount = 0u;
+            uint32_t batchCount = 0u;
+            uint32_t phaseCount = 0u;
+            // CPU reference result (objects in the frustum), if validating
+            bool validated = false;
+            uint32_t expectedVisible = 0u;
+        };
+
+        void createDescriptors(FrameAllocator& frameAllocator);
+        void writeDescriptor();
+        void createPipelineLayout();
+        void readBack(FrameInfo& frameInfo, uint32_t frameIndex);
+        // Binds and dispatches cull.comp over every object, then makes its output visible to the draws and the host
+        void dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t pass, uint32_t drawPhase);
+
+        Device& _device;
+        GpuScene& _gpuScene;
+        DepthPyramid& _depthPyramid;
+        // Compact into a draw count buffer, or leave every slot in place (see cull.comp)
+        const bool _compact;
+        bool _occlusionCulling = false;
+        bool _validate = false;
+
+        // Set 0: scene buffers with per-frame dynamic offsets, the visibility buffer, the frame's CullData, the depth
+        // pyramid and the frame's stats
+        std::unique_ptr<DescriptorSetLayout> _setLayoutPtr{};
+        std::unique_ptr<DescriptorPool> _poolPtr{};
+        VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+        // GpuScene::getGeneration() / DepthPyramid::getGeneration() _descriptorSet was written for
+        uint32_t _sceneGeneration = 0u;
+        uint32_t _pyramidGeneration = 0u;
+        // This frame's CullData in the frame allocator, shared by both passes
+        uint32_t _cullDataOffset = 0u;
+
+        std::unique_ptr<ComputePipeline> _pipelinePtr{};
+        VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+
+        // Per slot visibility at the end of the last late pass. Device local, reset whenever the slot layout changes.
+        std::unique_ptr<Buffer> _visibilityBuffer{};
+        // GpuScene::Stats::rebuilds the visibility was last reset for
+        uint32_t _visibilityRebuilds = ~0u;
+        // Per frame in flight, host visible
+        std::unique_ptr<Buffer> _statsBuffer{};
+
+        std::vector<Submission> _submissions{};
+        // CPU reference, reused every frame
+        FrustumCuller _culler{};
+        std::vector<uint32_t> _visibleObjects{};
+
+        Stats _stats{};
+    };
+}; //namespace Divide
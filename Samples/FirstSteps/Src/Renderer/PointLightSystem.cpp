@@ -6,21 +6,22 @@
 #include <glm/gtc/constants.hpp>
 
 #include <stdexcept>
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstring>
 
 namespace Divide {
 
-    struct PointLightPushConstants {
-        glm::vec4 position{};
-        glm::vec4 colour{};
-        float radius = 0.1f;
-    };
+    // A light stops where its brightest channel falls below this (1 / distance² falloff). Lower reaches further, into more clusters.
+    constexpr float LIGHT_ATTENUATION_CUTOFF = 0.01f;
 
-    PointLightSystem::PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    PointLightSystem::PointLightSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, FrameAllocator& frameAllocator, const uint32_t subpass)
         : _device{device}
     {
+        createInstanceDescriptors(frameAllocator);
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipeline(renderPass, subpass);
     }
 
     PointLightSystem::~PointLightSystem()
@@ -28,27 +29,39 @@ namespace Divide {
         vkDestroyPipelineLayout(_device.device(), _pipelineLayout, nullptr);
     }
 
-    void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+    void PointLightSystem::createInstanceDescriptors(FrameAllocator& frameAllocator) {
+        _instanceSetLayoutPtr = DescriptorSetLayout::Builder(_device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+        _instancePoolPtr = DescriptorPool::Builder(_device)
+            .setMaxSets(1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1)
+            .build();
+
+        // The array is runtime sized, so the descriptor covers as much as a frame could ever allocate
+        auto bufferInfo = frameAllocator.descriptorInfo(frameAllocator.getStats().frameCapacity);
+        DescriptorWriter(*_instanceSetLayoutPtr, *_instancePoolPtr)
+            .writeBuffer(0, &bufferInfo)
+            .build(_instanceDescriptorSet);
+    }
 
-        VkPushConstantRange pushContantRange{};
-        pushContantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushContantRange.offset = 0;
-        pushContantRange.size = sizeof(PointLightPushConstants);
+    void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
 
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, _instanceSetLayoutPtr->getDescriptorSetLayout() };
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushContantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(_device.device(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create pipeline layout!");
         }
     }
 
-    void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+    void PointLightSystem::createPipeline(VkRenderPass renderPass, const uint32_t subpass) {
         assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
         PipelineConfigInfo pipelineConfig{};
@@ -56,13 +69,22 @@ namespace Divide {
         Pipeline::defaultPipelineConfigInfo(pipelineConfig);
         pipelineConfig.attributeDescriptions.clear();
         pipelineConfig.bindingDescriptions.clear();
+        // Soft edged billboards, drawn back to front
+        pipelineConfig.colorBlendAttachment.blendEnable = VK_TRUE;
+        pipelineConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        pipelineConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        // Transparent, so they shouldn't hide each other (and the deferred lighting subpass can't write depth anyway)
+        pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
         pipelineConfig.renderPass = renderPass;
+        pipelineConfig.subpass = subpass;
         pipelineConfig.pipelineLayout = _pipelineLayout;
         _pipelinePtr = std::make_unique<Pipeline>(_device, "Shaders/point_light.vert.spv", "Shaders/point_light.frag.spv", pipelineConfig);
     }
 
     void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
-        int lightIndex = 0;
+        _lights.clear();
+        _shadingLights.clear();
+        _lightSpheres.clear();
 
         auto rotateLight = glm::rotate(glm::mat4(1.f), frameInfo.frameTime, { 0.f, -1.f, 0.f });
         for (auto& kv : frameInfo.gameObjects) {
@@ -71,52 +93,95 @@ namespace Divide {
                 continue;
             }
 
-            assert(lightIndex < MAX_LIGHTS && "Point lights exceeed maximum supported!");
-
             obj._transform.translation = glm::vec3(rotateLight * glm::vec4(obj._transform.translation, 1.f));
 
-            ubo.pointLights[lightIndex].position = glm::vec4(obj._transform.translation, 1.f);
-            ubo.pointLights[lightIndex].colour = glm::vec4(obj._colour, obj._pointLightPtr->lightIntensity);
-            
-            lightIndex += 1;
+            const glm::vec4 colour{ obj._colour, obj._pointLightPtr->lightIntensity };
+            const float brightest = glm::max(colour.x, glm::max(colour.y, colour.z)) * colour.w;
+            const glm::vec4 sphere{ obj._transform.translation, glm::sqrt(glm::max(brightest, 0.f) / LIGHT_ATTENUATION_CUTOFF) };
+            _shadingLights.push_back({ sphere, colour });
+            _lightSpheres.push_back(sphere);
+            _lights.push_back({ glm::vec4(obj._transform.translation, obj._transform.scale.x), colour });
+        }
+
+        const uint32_t lightCount = static_cast<uint32_t>(_shadingLights.size());
+        if (_clustering) {
+            _clusters.build(frameInfo.camera.getView(), frameInfo.camera.getProjection(), _lightSpheres.data(), lightCount);
+
+            const LightClusters::DepthSlicing& slicing = _clusters.getDepthSlicing();
+            ubo.clusterGrid = { LightClusters::GRID_X, LightClusters::GRID_Y, LightClusters::GRID_Z, slicing.logarithmic ? 1u : 0u };
+            ubo.clusterScale = { static_cast<float>(LightClusters::GRID_X) / frameInfo.extent.width,
+                                 static_cast<float>(LightClusters::GRID_Y) / frameInfo.extent.height,
+                                 slicing.scale,
+                                 slicing.bias };
+        }
+
+        // The shaders only index lights through the clusters, but a binding always needs something behind it
+        const FrameAllocator::Slice lightSlice = frameInfo.frameAllocator.allocate(sizeof(PointLight) * std::max(lightCount, 1u), FrameAllocator::Usage::STORAGE);
+        if (lightCount > 0u) {
+            std::memcpy(lightSlice.mapped, _shadingLights.data(), sizeof(PointLight) * lightCount);
+        }
+        // Without clustering nothing reads the binding, but its dynamic offset still has to point somewhere
+        const std::vector<uint32_t>& clusterData = _clusters.getClusterData();
+        const size_t clusterDataSize = _clustering ? clusterData.size() : 0u;
+        const FrameAllocator::Slice clusterSlice = frameInfo.frameAllocator.allocate(sizeof(uint32_t) * std::max(clusterDataSize, size_t{ 1u }), FrameAllocator::Usage::STORAGE);
+        if (clusterDataSize > 0u) {
+            std::memcpy(clusterSlice.mapped, clusterData.data(), sizeof(uint32_t) * clusterDataSize);
+        }
+        frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHTS)] = lightSlice.offset;
+        frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHT_CLUSTERS)] = clusterSlice.offset;
+
+        _instanceCount = static_cast<uint32_t>(_lights.size());
+        if (_instanceCount == 0u) {
+            return;
         }
 
-        ubo.numLights = lightIndex;
+        // Squared distances are never negative, so their bit patterns sort like the values themselves. Inverted, so
+        // an ascending sort puts the farthest first.
+        const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+        _sortKeys.clear();
+        for (uint32_t i = 0u; i < _instanceCount; ++i) {
+            const glm::vec3 offset = glm::vec3(_lights[i].position) - cameraPosition;
+            const float distance2 = glm::dot(offset, offset);
+            uint32_t distanceBits = 0u;
+            std::memcpy(&distanceBits, &distance2, sizeof(float));
+            _sortKeys.push_back((uint64_t{ ~distanceBits } << 32) | i);
+        }
+        _radixSort.sort(_sortKeys.data(), nullptr, _instanceCount);
+
+        const FrameAllocator::Slice slice = frameInfo.frameAllocator.allocate(sizeof(LightInstance) * _instanceCount, FrameAllocator::Usage::STORAGE);
+        LightInstance* instances = static_cast<LightInstance*>(slice.mapped);
+        for (uint32_t i = 0u; i < _instanceCount; ++i) {
+            instances[i] = _lights[static_cast<uint32_t>(_sortKeys[i])];
+        }
+        _instanceOffset = slice.offset;
     }
 
     void PointLightSystem::render(FrameInfo& frameInfo) {
+        if (_instanceCount == 0u) {
+            return;
+        }
+
         _pipelinePtr->bind(frameInfo.commandBuffer);
 
+        const VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, _instanceDescriptorSet };
+        const uint32_t dynamicOffsets[] = {
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::UBO)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHTS)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHT_CLUSTERS)],
+            _instanceOffset
+        };
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 _pipelineLayout,
                                 0,
-                                1,
-                                &frameInfo.globalDescriptorSet,
-                                0,
-                                nullptr
+                                2,
+                                descriptorSets,
+                                GLOBAL_DYNAMIC_OFFSET_COUNT + 1u,
+                                dynamicOffsets
         );
 
-        for (auto& kv : frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj._pointLightPtr == nullptr) {
-                continue;
-            }
-            PointLightPushConstants push{};
-            push.position = glm::vec4(obj._transform.translation, 1.f);
-            push.colour = glm::vec4(obj._colour, obj._pointLightPtr->lightIntensity);
-            push.radius = obj._transform.scale.x;
-
-            vkCmdPushConstants(
-                frameInfo.commandBuffer,
-                _pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PointLightPushConstants),
-                &push
-            );
-
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-        }
+        vkCmdDraw(frameInfo.commandBuffer, 6, _instanceCount, 0, 0);
+        frameInfo.stats.drawCalls += 1u;
+        frameInfo.stats.triangles += 2u * _instanceCount;
     }
-}; //namespace Divide
\ No newline at end of file
+}; //namespace Divide
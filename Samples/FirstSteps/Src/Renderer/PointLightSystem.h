@@ -4,16 +4,26 @@
 #include "Utilities/Device.h"
 #include "Utilities/Model.h"
 #include "Utilities/Camera.h"
+#include "Utilities/Descriptors.h"
+#include "Utilities/FrameAllocator.h"
+#include "Utilities/LightClusters.h"
+#include "Utilities/RadixSort.h"
 
 #include "Engine/FrameInfo.h"
 #include "Engine/GameObject.h"
 
 #include <memory>
+#include <vector>
 
 namespace Divide {
+    // Owns the frame's point lights. update() bins them into view space clusters (LightClusters) for shading and writes
+    // both to the global set's storage bindings; it also writes the billboards, sorted back to front, which render()
+    // draws with one instanced draw (point_light.vert reads its light by gl_InstanceIndex).
     class PointLightSystem {
     public:
-        PointLightSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        // 'subpass' is where render() draws the billboards: SwapChain::LIGHTING_SUBPASS of the deferred render pass, whose
+        // depth is read only
+        PointLightSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, FrameAllocator& frameAllocator, uint32_t subpass = 0u);
         ~PointLightSystem();
 
         PointLightSystem(const PointLightSystem&) = delete;
@@ -21,16 +31,52 @@ namespace Divide {
         PointLightSystem(PointLightSystem&&) = delete;
         PointLightSystem& operator=(PointLightSystem&&) = delete;
 
+        // Animates the lights, writes them and their clusters to the frame allocator (setting frameInfo's LIGHTS and
+        // LIGHT_CLUSTERS offsets and 'ubo''s cluster parameters) and writes every light's billboard
         void update(FrameInfo& frameInfo, GlobalUbo& ubo);
+        // Draws what the last update() wrote for this frame
         void render(FrameInfo& frameInfo);
 
+        // Off skips the clustering and its upload in update(), for shading paths that don't read the clusters (deferred
+        // light volumes). LIGHT_CLUSTERS is then bound to a placeholder slice.
+        inline void setClustering(const bool enabled) { _clustering = enabled; }
+        [[nodiscard]] inline bool isClusteringEnabled() const { return _clustering; }
+        // Cluster occupancy of the last update() that clustered
+        [[nodiscard]] inline const LightClusters::Stats& getClusterStats() const { return _clusters.getStats(); }
+        // The last update()'s lights, in the global set's LIGHTS binding
+        [[nodiscard]] inline uint32_t getLightCount() const { return static_cast<uint32_t>(_shadingLights.size()); }
+
     private:
+        // Matches LightInstance in point_light.vert (std430)
+        struct LightInstance {
+            glm::vec4 position{}; // w is the billboard radius
+            glm::vec4 colour{};   // w is intensity
+        };
+
+        void createInstanceDescriptors(FrameAllocator& frameAllocator);
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void createPipeline(VkRenderPass renderPass);
+        void createPipeline(VkRenderPass renderPass, uint32_t subpass);
 
         Device& _device;
 
+        // Set 1: the frame's LightInstance array in the frame allocator, addressed with a dynamic offset
+        std::unique_ptr<DescriptorSetLayout> _instanceSetLayoutPtr{};
+        std::unique_ptr<DescriptorPool> _instancePoolPtr{};
+        VkDescriptorSet _instanceDescriptorSet = VK_NULL_HANDLE;
+        // Written by update(), drawn by render()
+        uint32_t _instanceOffset = 0u;
+        uint32_t _instanceCount = 0u;
+        // Reused every frame: the lights in map order, and their sort keys (inverted distance bits << 32 | index)
+        std::vector<LightInstance> _lights{};
+        std::vector<uint64_t> _sortKeys{};
+        RadixSort _radixSort{};
+        // The shading side of the same lights: what the shaders read, and their spheres of influence for clustering
+        std::vector<PointLight> _shadingLights{};
+        std::vector<glm::vec4> _lightSpheres{};
+        LightClusters _clusters{};
+        bool _clustering = true;
+
         std::unique_ptr<Pipeline> _pipelinePtr;
         VkPipelineLayout _pipelineLayout;
     };
-}; //namespace Divide
\ No newline at end of file
+}; //namespace Divide
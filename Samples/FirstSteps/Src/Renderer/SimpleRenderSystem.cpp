@@ -6,20 +6,88 @@
 #include <glm/gtc/constants.hpp>
 
 #include <stdexcept>
+#include <iostream>
+#include <algorithm>
 #include <array>
 
 namespace Divide {
 
-    struct SimplePushConstantData {
+    // Coarser LODs are used as long as their simplification error projects to less than this many pixels
+    constexpr float MAX_LOD_PIXEL_ERROR = 1.f;
+
+    namespace {
+        bool isSphereVisible(const FrustumPlanes& planes, const glm::vec4& sphere) {
+            for (const glm::vec4& plane : planes) {
+                if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool isSphereInside(const FrustumPlanes& planes, const glm::vec4& sphere) {
+            for (const glm::vec4& plane : planes) {
+                if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < sphere.w) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    // Matches InstanceData in simple.vert / simple_compact.vert (std430)
+    struct InstanceData {
         glm::mat4 modelMatrix{ 1.f };
         glm::mat4 normalMatrix{ 1.f };
     };
 
-    SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    SimpleRenderSystem::SimpleRenderSystem(Device& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, FrameAllocator& frameAllocator, GpuScene& gpuScene, const bool gBufferOutput)
         : _device{device}
+        , _gpuScene{gpuScene}
     {
+        createInstanceDescriptors(frameAllocator);
         createPipelineLayout(globalSetLayout);
-        createPipeline(renderPass);
+        createPipelines(renderPass, gBufferOutput);
+    }
+
+    void SimpleRenderSystem::createInstanceDescriptors(FrameAllocator& frameAllocator) {
+        _instanceSetLayoutPtr = DescriptorSetLayout::Builder(_device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+        _instancePoolPtr = DescriptorPool::Builder(_device)
+            .setMaxSets(2)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 2)
+            .build();
+
+        // The array is runtime sized, so the descriptor covers as much as a frame could ever allocate
+        auto bufferInfo = frameAllocator.descriptorInfo(frameAllocator.getStats().frameCapacity);
+        DescriptorWriter(*_instanceSetLayoutPtr, *_instancePoolPtr)
+            .writeBuffer(0, &bufferInfo)
+            .build(_instanceDescriptorSet);
+
+        writeSceneDescriptor();
+    }
+
+    void SimpleRenderSystem::writeSceneDescriptor() {
+        auto bufferInfo = _gpuScene.getDescriptorInfo(GpuScene::BufferType::TRANSFORMS);
+        DescriptorWriter writer(*_instanceSetLayoutPtr, *_instancePoolPtr);
+        writer.writeBuffer(0, &bufferInfo);
+        if (_sceneDescriptorSet == VK_NULL_HANDLE) {
+            writer.build(_sceneDescriptorSet);
+        } else {
+            writer.overwrite(_sceneDescriptorSet);
+        }
+        _sceneGeneration = _gpuScene.getGeneration();
+    }
+
+    SimpleRenderSystem::RenderMode SimpleRenderSystem::setRenderMode(const RenderMode mode) {
+        _renderMode = mode;
+        if (mode == RenderMode::INDIRECT && !_device.supportsIndirectFirstInstance()) {
+            std::cerr << "Indirect rendering needs drawIndirectFirstInstance; falling back to direct draws" << std::endl;
+            _renderMode = RenderMode::DIRECT;
+        }
+        return _renderMode;
     }
 
     SimpleRenderSystem::~SimpleRenderSystem()
@@ -29,68 +97,343 @@ namespace Divide {
 
     void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
 
-        VkPushConstantRange pushContantRange{};
-        pushContantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushContantRange.offset = 0;
-        pushContantRange.size = sizeof(SimplePushConstantData);
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, _instanceSetLayoutPtr->getDescriptorSetLayout() };
 
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushContantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(_device.device(), &pipelineLayoutInfo, nullptr, &_pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create pipeline layout!");
         }
     }
 
-    void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+    void SimpleRenderSystem::createPipelines(VkRenderPass renderPass, const bool gBufferOutput) {
         assert(_pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
 
-        PipelineConfigInfo pipelineConfig{};
+        const char* fragFile = gBufferOutput ? "Shaders/gbuffer.frag.spv" : "Shaders/simple.frag.spv";
+        const auto setOutput = [&](PipelineConfigInfo& pipelineConfig) {
+            pipelineConfig.renderPass = renderPass;
+            pipelineConfig.pipelineLayout = _pipelineLayout;
+            if (gBufferOutput) {
+                pipelineConfig.subpass = SwapChain::GBUFFER_SUBPASS;
+                pipelineConfig.colorAttachmentCount = SwapChain::GBUFFER_ATTACHMENT_COUNT;
+            }
+        };
+
+        for (const Model::VertexFormat format : { Model::VertexFormat::FULL, Model::VertexFormat::COMPACT }) {
+            const size_t index = static_cast<size_t>(format);
+            const char* vertFile = format == Model::VertexFormat::COMPACT ? "Shaders/simple_compact.vert.spv" : "Shaders/simple.vert.spv";
+
+            PipelineConfigInfo pipelineConfig{};
+            Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+            if (format == Model::VertexFormat::COMPACT) {
+                pipelineConfig.bindingDescriptions = Model::CompactVertex::getBindingDescriptions();
+                pipelineConfig.attributeDescriptions = Model::CompactVertex::getAttributeDescriptions();
+            }
+            setOutput(pipelineConfig);
+            _backFaceCulling = (pipelineConfig.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0u;
+            _pipelines[index] = std::make_unique<Pipeline>(_device, vertFile, fragFile, pipelineConfig);
+
+            // Depth has already been written by the pre-pass: only the closest fragment passes, and nothing changes it
+            pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+            pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+            _depthEqualPipelines[index] = std::make_unique<Pipeline>(_device, vertFile, fragFile, pipelineConfig);
 
-        Pipeline::defaultPipelineConfigInfo(pipelineConfig);
-        pipelineConfig.renderPass = renderPass;
-        pipelineConfig.pipelineLayout = _pipelineLayout;
-        _pipelinePtr = std::make_unique<Pipeline>(_device, "Shaders/simple.vert.spv", "Shaders/simple.frag.spv", pipelineConfig);
+            PipelineConfigInfo depthConfig{};
+            Pipeline::defaultPipelineConfigInfo(depthConfig);
+            depthConfig.bindingDescriptions = Model::getPositionBindingDescriptions(format);
+            depthConfig.attributeDescriptions = Model::getPositionAttributeDescriptions(format);
+            // The subpass's colour attachments stay untouched; there's no fragment stage to write them anyway
+            depthConfig.colorBlendAttachment.colorWriteMask = 0u;
+            setOutput(depthConfig);
+            _depthPipelines[index] = std::make_unique<Pipeline>(_device, "Shaders/depth_only.vert.spv", "", depthConfig);
+        }
+    }
+
+    uint32_t SimpleRenderSystem::selectLod(const FrameInfo& frameInfo, const GameObject& gameObject, const glm::vec4& sphere) const {
+        const Model& model = *gameObject._model;
+        if (model.getLodCount() <= 1u) {
+            return 0u;
+        }
+
+        const glm::vec3& scale = gameObject._transform.scale;
+        const float maxScale = glm::max(glm::abs(scale.x), glm::max(glm::abs(scale.y), glm::abs(scale.z)));
+
+        // Pixels covered by one model space unit at the closest point of the object's bounding sphere
+        float pixelsPerUnit = maxScale * glm::abs(frameInfo.camera.getProjection()[1][1]) * 0.5f * frameInfo.extent.height;
+        if (frameInfo.camera.isPerspective()) {
+            const float distance = glm::length(glm::vec3(sphere) - frameInfo.camera.getPosition()) - sphere.w;
+            if (distance <= 0.f) {
+                return 0u;
+            }
+            pixelsPerUnit /= distance;
+        }
+
+        return model.selectLod(pixelsPerUnit, MAX_LOD_PIXEL_ERROR);
+    }
+
+    void SimpleRenderSystem::drawMeshlets(FrameInfo& frameInfo, const GameObject& gameObject, const uint32_t lod, const uint32_t instanceIndex, const Model::Stream stream) const {
+        Model& model = *gameObject._model;
+        const auto& meshlets = model.getMeshlets();
+        const auto [firstMeshlet, meshletCount] = model.getMeshletRange(lod);
+
+        // Meshlet data lives in (unquantised) model space, so test there rather than transforming every sphere
+        const glm::mat4 modelMatrix = gameObject._transform.mat4();
+        const FrustumPlanes frustumPlanes = Camera::extractFrustumPlanes(frameInfo.camera.getProjection() * frameInfo.camera.getView() * modelMatrix);
+        const glm::vec3 eye = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(frameInfo.camera.getPosition(), 1.f));
+
+        uint32_t runOffset = 0u;
+        uint32_t runCount = 0u;
+        const auto flushRun = [&]() {
+            if (runCount > 0u) {
+                model.drawIndexed(frameInfo.commandBuffer, runOffset, runCount, 1u, instanceIndex, stream);
+                frameInfo.stats.drawCalls += 1u;
+                frameInfo.stats.triangles += runCount / 3u;
+                runCount = 0u;
+            }
+        };
+
+        for (uint32_t i = firstMeshlet; i < firstMeshlet + meshletCount; ++i) {
+            const Model::Meshlet& meshlet = meshlets[i];
+            if (!isSphereVisible(frustumPlanes, meshlet.boundingSphere) || (_backFaceCulling && Model::isMeshletBackFacing(meshlet, eye))) {
+                // Both passes cull the same meshlets; count them once
+                if (stream == Model::Stream::VERTEX) {
+                    frameInfo.stats.meshletsCulled += 1u;
+                }
+                flushRun();
+                continue;
+            }
+
+            if (runCount == 0u) {
+                runOffset = meshlet.indexOffset;
+            }
+            runCount += meshlet.indexCount;
+        }
+        flushRun();
+    }
+
+    void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo, const uint32_t drawPhase) {
+        if (_renderMode == RenderMode::INDIRECT) {
+            renderIndirect(frameInfo, drawPhase);
+        } else {
+            assert(drawPhase == 0u && "Direct rendering draws everything in one phase");
+            renderDirect(frameInfo);
+        }
     }
 
-    void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-        _pipelinePtr->bind(frameInfo.commandBuffer);
+    void SimpleRenderSystem::renderIndirect(FrameInfo& frameInfo, const uint32_t drawPhase) {
+        // The scene's buffers were reallocated. update() waited for the device to idle, so the old set is unused.
+        if (_sceneGeneration != _gpuScene.getGeneration()) {
+            writeSceneDescriptor();
+        }
+
+        const auto& batches = _gpuScene.getBatches();
+        if (batches.empty()) {
+            return;
+        }
 
+        const uint32_t frameIndex = static_cast<uint32_t>(frameInfo.frameIndex);
+        const VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, _sceneDescriptorSet };
+        const uint32_t dynamicOffsets[] = {
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::UBO)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHTS)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHT_CLUSTERS)],
+            _gpuScene.getFrameOffset(GpuScene::BufferType::TRANSFORMS, frameIndex)
+        };
         vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 _pipelineLayout,
                                 0,
-                                1,
-                                &frameInfo.globalDescriptorSet,
-                                0,
-                                nullptr
+                                2,
+                                descriptorSets,
+                                GLOBAL_DYNAMIC_OFFSET_COUNT + 1u,
+                                dynamicOffsets
         );
 
+        constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        const VkBuffer commandBuffer = _gpuScene.getBuffer(GpuScene::BufferType::DRAW_COMMANDS);
+
+        Pipeline* boundPipeline = nullptr;
+        for (uint32_t i = 0u; i < batches.size(); ++i) {
+            const GpuScene::Batch& batch = batches[i];
+
+            Pipeline* pipeline = _pipelines[static_cast<size_t>(batch.model->getVertexFormat())].get();
+            if (pipeline != boundPipeline) {
+                pipeline->bind(frameInfo.commandBuffer);
+                boundPipeline = pipeline;
+                frameInfo.stats.pipelineBinds += 1u;
+            }
+
+            // Every batch is a different arena page (or vertex format), so each one binds
+            batch.model->bind(frameInfo.commandBuffer);
+            frameInfo.stats.bufferBinds += 1u;
+
+            const VkDeviceSize commandOffset = _gpuScene.getCommandOffset(frameIndex, i, drawPhase);
+            if (_device.supportsDrawIndirectCount()) {
+                // GpuCullingSystem compacted the batch's visible objects to its start and counted them
+                _device.cmdDrawIndexedIndirectCount(frameInfo.commandBuffer, commandBuffer, commandOffset,
+                                                    _gpuScene.getBuffer(GpuScene::BufferType::DRAW_COUNTS), _gpuScene.getCountOffset(frameIndex, i, drawPhase),
+                                                    batch.commandCount, stride);
+                frameInfo.stats.drawCalls += 1u;
+            } else if (_device.supportsMultiDrawIndirect()) {
+                // Culled objects kept their command, with zero instances
+                vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, commandBuffer, commandOffset, batch.commandCount, stride);
+                frameInfo.stats.drawCalls += 1u;
+            } else {
+                // Without multiDrawIndirect drawCount can't exceed 1, so the batch costs one call per command
+                for (uint32_t command = 0u; command < batch.commandCount; ++command) {
+                    vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, commandBuffer, commandOffset + VkDeviceSize{ stride } * command, 1u, stride);
+                }
+                frameInfo.stats.drawCalls += batch.commandCount;
+            }
+        }
+    }
+
+    void SimpleRenderSystem::renderDirect(FrameInfo& frameInfo) {
+        _cullCandidates.clear();
+        _culler.clear();
         for (auto& kv : frameInfo.gameObjects) {
             auto& obj = kv.second;
 
-            if (obj._model == nullptr) {
+            // Still streaming in (see ModelLoader)
+            if (obj._model == nullptr || !obj._model->isResident()) {
                 continue;
             }
 
-            SimplePushConstantData push{};
-            push.modelMatrix = obj._transform.mat4();
-            push.normalMatrix = obj._transform.normalMatrix();
+            _cullCandidates.push_back(&obj);
+            _culler.addSphere(obj.getBoundingSphere());
+        }
 
-            vkCmdPushConstants(frameInfo.commandBuffer,
-                               _pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0,
-                               sizeof(SimplePushConstantData),
-                               &push);
+        const FrustumPlanes frustumPlanes = frameInfo.camera.getFrustumPlanes();
+        const uint32_t visibleCount = _culler.cull(frustumPlanes, _visibleObjects);
+        frameInfo.stats.objectsCulled += _culler.getSphereCount() - visibleCount;
+
+        _renderQueue.begin(frameInfo.camera.getView(), frameInfo.camera.getProjection());
+        for (const uint32_t index : _visibleObjects) {
+            GameObject& obj = *_cullCandidates[index];
+            const glm::vec4 sphere = _culler.getSphere(index);
+
+            if (_occlusionRasterizer != nullptr && _occlusionRasterizer->isOccluded(obj._model->getBoundsMin(), obj._model->getBoundsMax(), obj._transform.mat4())) {
+                frameInfo.stats.objectsOccluded += 1u;
+                continue;
+            }
+
+            // Per-meshlet culling needs the object's own transform, so such objects can't share an instanced draw.
+            // It only pays off for objects crossing the frustum (or with cone culling enabled): nothing of a fully
+            // visible object fails the frustum test.
+            const bool perObject = !obj._model->getMeshlets().empty() && (_backFaceCulling || !isSphereInside(frustumPlanes, sphere));
+            _renderQueue.add(RenderQueue::Pass::OPAQUE, { &obj, obj._model.get(), selectLod(frameInfo, obj, sphere), perObject }, glm::vec3(sphere));
+        }
+        const uint32_t packetCount = _renderQueue.size();
+        frameInfo.stats.objects += packetCount;
+        if (packetCount == 0u) {
+            return;
+        }
+
+        // Objects that can share a draw end up adjacent, and the pipeline/geometry binds between them are minimal
+        _renderQueue.sort(frameInfo.stats.countUnsortedBinds);
+        if (frameInfo.stats.countUnsortedBinds) {
+            const RenderQueue::Stats& queueStats = _renderQueue.getStats();
+            frameInfo.stats.unsortedPipelineBinds += queueStats.unsortedPipelineBinds;
+            frameInfo.stats.unsortedBufferBinds += queueStats.unsortedGeometryBinds;
+        }
+
+        const FrameAllocator::Slice instanceSlice = frameInfo.frameAllocator.allocate(sizeof(InstanceData) * packetCount, FrameAllocator::Usage::STORAGE);
+        InstanceData* instances = static_cast<InstanceData*>(instanceSlice.mapped);
+        // Written up front, as both passes draw from them
+        const Model* dequantisedModel = nullptr;
+        glm::mat4 dequantisation{ 1.f };
+        for (uint32_t i = 0u; i < packetCount; ++i) {
+            const RenderQueue::Packet& packet = _renderQueue.getPacket(i);
+            if (packet.model != dequantisedModel) {
+                dequantisation = packet.model->getDequantisationMatrix();
+                dequantisedModel = packet.model;
+            }
+            const TransformComponent& transform = packet.object->_transform;
+            instances[i].modelMatrix = transform.mat4() * dequantisation;
+            instances[i].normalMatrix = transform.normalMatrix();
+        }
 
-            obj._model->bind(frameInfo.commandBuffer);
-            obj._model->draw(frameInfo.commandBuffer);
+        // All pipelines share the same layout, so the sets stay bound across pipeline switches and both passes
+        const VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, _instanceDescriptorSet };
+        const uint32_t dynamicOffsets[] = {
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::UBO)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHTS)],
+            frameInfo.globalOffsets[static_cast<size_t>(GlobalBinding::LIGHT_CLUSTERS)],
+            instanceSlice.offset
+        };
+        vkCmdBindDescriptorSets(frameInfo.commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                _pipelineLayout,
+                                0,
+                                2,
+                                descriptorSets,
+                                GLOBAL_DYNAMIC_OFFSET_COUNT + 1u,
+                                dynamicOffsets
+        );
+
+        if (_depthPrePass) {
+            recordRenderQueue(frameInfo, true);
+        }
+        recordRenderQueue(frameInfo, false);
+    }
+
+    void SimpleRenderSystem::recordRenderQueue(FrameInfo& frameInfo, const bool depthOnly) {
+        const Model::Stream stream = depthOnly ? Model::Stream::POSITION : Model::Stream::VERTEX;
+        const uint32_t packetCount = _renderQueue.size();
+
+        Pipeline* boundPipeline = nullptr;
+        uint64_t boundGeometry = ~uint64_t{ 0u };
+        for (uint32_t first = 0u; first < packetCount;) {
+            const RenderQueue::Packet& packet = _renderQueue.getPacket(first);
+            Model& model = *packet.model;
+
+            // Whatever has no position stream wasn't in the pre-pass, so it can't test EQUAL either
+            const bool prePassed = _depthPrePass && model.hasPositionStream();
+            if (depthOnly && !prePassed) {
+                ++first;
+                continue;
+            }
+
+            const auto& pipelines = depthOnly ? _depthPipelines : (prePassed ? _depthEqualPipelines : _pipelines);
+            Pipeline* pipeline = pipelines[static_cast<size_t>(model.getVertexFormat())].get();
+            if (pipeline != boundPipeline) {
+                pipeline->bind(frameInfo.commandBuffer);
+                boundPipeline = pipeline;
+                frameInfo.stats.pipelineBinds += 1u;
+            }
+
+            // Models share the geometry arena's buffers, so a bind is only needed when the draw moves to another page
+            const uint64_t geometry = model.getGeometry(stream).getBindKey();
+            if (geometry != boundGeometry) {
+                model.bind(frameInfo.commandBuffer, stream);
+                boundGeometry = geometry;
+                frameInfo.stats.bufferBinds += 1u;
+            }
+
+            const bool perObject = packet.perObject;
+
+            uint32_t last = first + 1u;
+            while (!perObject && last < packetCount && _renderQueue.getPacket(last).model == packet.model && _renderQueue.getPacket(last).lod == packet.lod && !_renderQueue.getPacket(last).perObject) {
+                ++last;
+            }
+
+            const uint32_t instanceCount = last - first;
+            if (perObject) {
+                drawMeshlets(frameInfo, *packet.object, packet.lod, first, stream);
+            } else {
+                model.draw(frameInfo.commandBuffer, packet.lod, instanceCount, first, stream);
+
+                frameInfo.stats.drawCalls += 1u;
+                frameInfo.stats.triangles += model.getLodCount() > 0u ? uint64_t{ model.getLod(packet.lod).indexCount / 3u } * instanceCount : 0u;
+            }
+            if (!depthOnly) {
+                frameInfo.stats.lodHistogram[packet.lod] += instanceCount;
+            }
+            first = last;
         }
     }
 }; //namespace Divide
\ No newline at end of file
@@ -4,16 +4,37 @@
 #include "Utilities/Device.h"
 #include "Utilities/Model.h"
 #include "Utilities/Camera.h"
+#include "Utilities/Descriptors.h"
+#include "Utilities/FrameAllocator.h"
+#include "Utilities/FrustumCuller.h"
+#include "Utilities/OcclusionRasterizer.h"
+#include "Utilities/SwapChain.h"
 
 #include "Engine/FrameInfo.h"
 #include "Engine/GameObject.h"
+#include "Engine/GpuScene.h"
+#include "Engine/RenderQueue.h"
 
+#include <array>
 #include <memory>
+#include <vector>
 
 namespace Divide {
     class SimpleRenderSystem {
     public:
-        SimpleRenderSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+        enum class RenderMode : uint8_t {
+            // The CPU walks the scene every frame: culling, LOD selection and one instanced draw per model and LOD
+            DIRECT = 0,
+            // The scene is drawn from 'gpuScene''s indirect commands with one draw per batch, regardless of object
+            // count. GpuCullingSystem must have written this frame's commands first. Needs drawIndirectFirstInstance.
+            // LOD 0 only for now; visibility stats come from the culling system.
+            INDIRECT
+        };
+
+        // Per-object transforms are written to 'frameAllocator' every frame (DIRECT) or come from 'gpuScene' (INDIRECT,
+        // which the caller keeps up to date), and are read by the shaders through gl_InstanceIndex. With 'gBufferOutput'
+        // the pipelines write the G-buffer in 'renderPass''s SwapChain::GBUFFER_SUBPASS instead of shading.
+        SimpleRenderSystem(Device &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, FrameAllocator& frameAllocator, GpuScene& gpuScene, bool gBufferOutput = false);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
@@ -21,15 +42,70 @@ namespace Divide {
         SimpleRenderSystem(SimpleRenderSystem&&) = delete;
         SimpleRenderSystem& operator=(SimpleRenderSystem&&) = delete;
 
-        void renderGameObjects(FrameInfo& frameInf);
+        // INDIRECT draws 'drawPhase''s list of the GPU scene (see GpuCullingSystem); DIRECT only has one phase
+        void renderGameObjects(FrameInfo& frameInfo, uint32_t drawPhase = 0u);
+
+        // Falls back to DIRECT if the device can't draw INDIRECT. Returns the mode actually set.
+        RenderMode setRenderMode(RenderMode mode);
+        [[nodiscard]] inline RenderMode getRenderMode() const { return _renderMode; }
+        // DIRECT skips objects whose bounds are hidden in 'rasterizer', which the caller fills every frame before
+        // rendering. Null disables the test.
+        inline void setOcclusionRasterizer(const OcclusionRasterizer* rasterizer) { _occlusionRasterizer = rasterizer; }
+        // DIRECT first lays down depth from the models' position streams with a vertex only pipeline, then shades
+        // with depth writes off and an EQUAL test, so every pixel is shaded once. Pays off when overdraw is high and
+        // fragments are expensive; costs a second geometry pass. INDIRECT ignores it. Models without a position stream
+        // (see Model::ImportOptions::positionStream) skip the pre-pass and shade with a regular depth test.
+        inline void setDepthPrePass(const bool enabled) { _depthPrePass = enabled; }
+        [[nodiscard]] inline bool isDepthPrePassEnabled() const { return _depthPrePass; }
 
     private:
+        // Objects outside the view frustum (or software occluded) are skipped. The rest go through the render queue,
+        // sorted by state and depth, and runs sharing a model and LOD are drawn as one instanced draw.
+        void renderDirect(FrameInfo& frameInfo);
+        // Records the sorted render queue: depth only from the position streams, or shaded from the full vertices
+        void recordRenderQueue(FrameInfo& frameInfo, bool depthOnly);
+        // CPU cost is one indirect draw per GpuScene batch, whatever the GPU decided is visible
+        void renderIndirect(FrameInfo& frameInfo, uint32_t drawPhase);
+        void createInstanceDescriptors(FrameAllocator& frameAllocator);
+        void writeSceneDescriptor();
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void createPipeline(VkRenderPass renderPass);
+        void createPipelines(VkRenderPass renderPass, bool gBufferOutput);
+        // 'sphere' is the object's world space bounding sphere
+        [[nodiscard]] uint32_t selectLod(const FrameInfo& frameInfo, const GameObject& gameObject, const glm::vec4& sphere) const;
+        // Draws the meshlets of 'lod' that survive frustum (and, if rasterisation culls back faces, normal cone) tests.
+        // Adjacent survivors share a single draw call.
+        void drawMeshlets(FrameInfo& frameInfo, const GameObject& gameObject, uint32_t lod, uint32_t instanceIndex, Model::Stream stream) const;
 
         Device& _device;
+        GpuScene& _gpuScene;
+        RenderMode _renderMode = RenderMode::DIRECT;
+
+        // Set 1: the frame's instance array, addressed with a dynamic offset. DIRECT points it at the frame
+        // allocator, INDIRECT at the GPU scene's transforms.
+        std::unique_ptr<DescriptorSetLayout> _instanceSetLayoutPtr{};
+        std::unique_ptr<DescriptorPool> _instancePoolPtr{};
+        VkDescriptorSet _instanceDescriptorSet = VK_NULL_HANDLE;
+        VkDescriptorSet _sceneDescriptorSet = VK_NULL_HANDLE;
+        // GpuScene::getGeneration() _sceneDescriptorSet was written for
+        uint32_t _sceneGeneration = 0u;
+        // Reused every frame so steady state rendering doesn't allocate. Packets that are perObject are drawn
+        // through the meshlet path.
+        RenderQueue _renderQueue{};
+        // Resident objects, their bounds in the culler under the same index, and the indices that passed
+        std::vector<GameObject*> _cullCandidates{};
+        FrustumCuller _culler{};
+        std::vector<uint32_t> _visibleObjects{};
+        const OcclusionRasterizer* _occlusionRasterizer = nullptr;
 
-        std::unique_ptr<Pipeline> _pipelinePtr;
+        // One pipeline per vertex layout, indexed by Model::VertexFormat
+        std::array<std::unique_ptr<Pipeline>, static_cast<size_t>(Model::VertexFormat::COUNT)> _pipelines;
+        // The depth pre-pass: position stream only, no fragment stage. Then the same shading as _pipelines, tested
+        // EQUAL against that depth without writing it.
+        std::array<std::unique_ptr<Pipeline>, static_cast<size_t>(Model::VertexFormat::COUNT)> _depthPipelines;
+        std::array<std::unique_ptr<Pipeline>, static_cast<size_t>(Model::VertexFormat::COUNT)> _depthEqualPipelines;
         VkPipelineLayout _pipelineLayout;
+        // Cone culling is only valid when the pipelines discard back faces anyway
+        bool _backFaceCulling = false;
+        bool _depthPrePass = false;
     };
 }; //namespace Divide
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Divide {
+
+    namespace {
+        bool isPowerOfTwo(const uint64_t value) {
+            return value != 0u && (value & (value - 1u)) == 0u;
+        }
+
+        uint64_t nextPowerOfTwo(uint64_t value) {
+            --value;
+            for (uint32_t shift = 1u; shift < 64u; shift <<= 1u) {
+                value |= value >> shift;
+            }
+            return value + 1u;
+        }
+    };
+
+    BuddyAllocator::BuddyAllocator(const uint64_t capacity)
+        : _capacity(capacity)
+    {
+        assert(isPowerOfTwo(capacity) && capacity >= MIN_BLOCK_SIZE && "Buddy allocator capacity must be a power of two");
+
+        _freeLists.resize(getLevel(MIN_BLOCK_SIZE) + 1u);
+        _freeLists[0].insert(0u);
+    }
+
+    uint64_t BuddyAllocator::getBlockSize(const uint64_t size, const uint64_t alignment) {
+        assert((alignment == 0u || isPowerOfTwo(alignment)) && "Alignment must be a power of two");
+        return nextPowerOfTwo(std::max({ size, alignment, MIN_BLOCK_SIZE }));
+    }
+
+    uint32_t BuddyAllocator::getLevel(const uint64_t blockSize) const {
+        uint32_t level = 0u;
+        while (getLevelSize(level) > blockSize) {
+            ++level;
+        }
+        return level;
+    }
+
+    uint64_t BuddyAllocator::allocate(const uint64_t size, const uint64_t alignment) {
+        const uint64_t blockSize = getBlockSize(size, alignment);
+        if (size == 0u || blockSize > _capacity) {
+            return INVALID_OFFSET;
+        }
+
+        const uint32_t targetLevel = getLevel(blockSize);
+
+        // Smallest free block that fits, then split it down, keeping the lower half each time
+        uint32_t level = targetLevel;
+        while (_freeLists[level].empty()) {
+            if (level == 0u) {
+                return INVALID_OFFSET;
+            }
+            --level;
+        }
+
+        const uint64_t offset = *_freeLists[level].begin();
+        _freeLists[level].erase(_freeLists[level].begin());
+        while (level < targetLevel) {
+            ++level;
+            _freeLists[level].insert(offset + getLevelSize(level));
+        }
+
+        _usedSize += blockSize;
+        ++_allocationCount;
+        return offset;
+    }
+
+    void BuddyAllocator::free(uint64_t offset, const uint64_t size) {
+        const uint64_t blockSize = getBlockSize(size, 0u);
+        assert(_allocationCount > 0u && offset % blockSize == 0u && offset + blockSize <= _capacity && "Invalid buddy allocator free");
+
+        _usedSize -= blockSize;
+        --_allocationCount;
+
+        // Merge with the buddy for as long as it is free too
+        uint32_t level = getLevel(blockSize);
+        while (level > 0u) {
+            const uint64_t buddy = offset ^ getLevelSize(level);
+            if (_freeLists[level].erase(buddy) == 0u) {
+                break;
+            }
+            offset = std::min(offset, buddy);
+            --level;
+        }
+        _freeLists[level].insert(offset);
+    }
+
+    uint64_t BuddyAllocator::getLargestFreeBlock() const {
+        for (uint32_t level = 0u; level < _freeLists.size(); ++level) {
+            if (!_freeLists[level].empty()) {
+                return getLevelSize(level);
+            }
+        }
+        return 0u;
+    }
+}; //namespace Divide
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+namespace Divide {
+    // Binary buddy sub-allocator over an abstract [0, capacity) range. It knows nothing about Vulkan, so it can be
+    // exercised on the CPU alone. Every allocation is rounded up to a power of two (at least MIN_BLOCK_SIZE) and its
+    // offset is a multiple of that size, which satisfies any power of two alignment up to the rounded size for free.
+    class BuddyAllocator {
+    public:
+        static constexpr uint64_t MIN_BLOCK_SIZE = 256u;
+        static constexpr uint64_t INVALID_OFFSET = ~uint64_t{ 0u };
+
+        // 'capacity' must be a power of two no smaller than MIN_BLOCK_SIZE
+        explicit BuddyAllocator(uint64_t capacity);
+
+        // Returns INVALID_OFFSET if no free block is large enough
+        [[nodiscard]] uint64_t allocate(uint64_t size, uint64_t alignment);
+        // 'size' is the value passed to allocate() (or getBlockSize() of it)
+        void free(uint64_t offset, uint64_t size);
+
+        // Size of the block allocate() would hand out for this request
+        [[nodiscard]] static uint64_t getBlockSize(uint64_t size, uint64_t alignment);
+
+        [[nodiscard]] inline uint64_t getCapacity() const { return _capacity; }
+        [[nodiscard]] inline uint64_t getUsedSize() const { return _usedSize; }
+        [[nodiscard]] inline uint32_t getAllocationCount() const { return _allocationCount; }
+        [[nodiscard]] inline bool empty() const { return _allocationCount == 0u; }
+        [[nodiscard]] uint64_t getLargestFreeBlock() const;
+
+    private:
+        [[nodiscard]] inline uint64_t getLevelSize(const uint32_t level) const { return _capacity >> level; }
+        [[nodiscard]] uint32_t getLevel(uint64_t blockSize) const;
+
+        uint64_t _capacity = 0u;
+        uint64_t _usedSize = 0u;
+        uint32_t _allocationCount = 0u;
+        // Free block offsets per level; level 0 is the whole range. Sorted so allocations pack towards the start.
+        std::vector<std::set<uint64_t>> _freeLists{};
+    };
+}; //namespace Divide
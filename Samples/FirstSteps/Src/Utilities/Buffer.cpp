@@ -44,14 +44,14 @@ namespace Divide {
     {
         alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
         bufferSize = alignmentSize * instanceCount;
-        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+        device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
     }
 
     Buffer::~Buffer()
     {
         unmap();
         vkDestroyBuffer(_device.device(), buffer, nullptr);
-        vkFreeMemory(_device.device(), memory, nullptr);
+        _device.freeMemory(allocation);
     }
 
     /**
@@ -64,20 +64,25 @@ namespace Divide {
      * @return VkResult of the buffer mapping call
      */
     VkResult Buffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(_device.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && allocation.isValid() && "Called map on buffer before create");
+        // Host visible memory is persistently mapped by the allocator, so this only hands out the pointer. The range is
+        // still checked, as a real vkMapMemory would have.
+        assert(offset <= bufferSize && (size == VK_WHOLE_SIZE || size <= bufferSize - offset) && "Mapped range exceeds the buffer");
+        (void)size;
+        if (allocation.mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(allocation.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The underlying memory stays mapped for as long as its allocation lives
      */
     void Buffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(_device.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     /**
@@ -115,9 +120,9 @@ namespace Divide {
     VkResult Buffer::flush(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange{};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = allocation.memory;
+        mappedRange.offset = allocation.offset + offset;
+        mappedRange.size = size == VK_WHOLE_SIZE ? allocation.reservedSize - offset : size;
         return vkFlushMappedMemoryRanges(_device.device(), 1, &mappedRange);
     }
 
@@ -135,9 +140,9 @@ namespace Divide {
     VkResult Buffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange{};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = allocation.memory;
+        mappedRange.offset = allocation.offset + offset;
+        mappedRange.size = size == VK_WHOLE_SIZE ? allocation.reservedSize - offset : size;
         return vkInvalidateMappedMemoryRanges(_device.device(), 1, &mappedRange);
     }
 
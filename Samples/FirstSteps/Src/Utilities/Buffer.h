@@ -18,6 +18,9 @@ namespace Divide {
         Buffer(const Buffer&) = delete;
         Buffer& operator=(const Buffer&) = delete;
 
+        // Host visible allocations are persistently mapped by the MemoryAllocator for as long as they live: map() only
+        // points getMappedMemory() at 'offset' (and fails for memory that isn't host visible), and unmap() only clears
+        // that pointer. Neither calls vkMapMemory/vkUnmapMemory, so both are cheap enough to use freely.
         VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         void unmap();
 
@@ -46,7 +49,7 @@ namespace Divide {
         Device& _device;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocation allocation{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -1,6 +1,25 @@
 #include "Camera.h"
 
+#include <cassert>
+
 namespace Divide {
+    FrustumPlanes Camera::extractFrustumPlanes(const glm::mat4& matrix) {
+        const glm::vec4 row0{ matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0] };
+        const glm::vec4 row1{ matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1] };
+        const glm::vec4 row2{ matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2] };
+        const glm::vec4 row3{ matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3] };
+
+        FrustumPlanes planes{
+            row3 + row0, row3 - row0, // left, right
+            row3 + row1, row3 - row1, // bottom, top
+            row2,        row3 - row2  // near (depth is zero to one), far
+        };
+        for (glm::vec4& plane : planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return planes;
+    }
+
     void Camera::setOrthographicProjection(float left, float right, float top, float bottom, float near, float far) {
         _projectionMatrix = glm::mat4{ 1.0f };
         _projectionMatrix[0][0] = 2.f / (right - left);
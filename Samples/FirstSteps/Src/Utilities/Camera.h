@@ -4,9 +4,18 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
+
 namespace Divide {
+    // Left, right, bottom, top, near, far. xyz: normal pointing inwards, w: distance, so a point p is on the inside
+    // when dot(xyz, p) + w >= 0. Normalised: distances are in the source space's units.
+    using FrustumPlanes = std::array<glm::vec4, 6>;
+
     class Camera {
     public:
+        // Clip space planes of 'matrix' (Gribb/Hartmann): world space for projection * view, model space with the model matrix appended
+        [[nodiscard]] static FrustumPlanes extractFrustumPlanes(const glm::mat4& matrix);
+
         void setOrthographicProjection(float left, float right, float top, float botton, float near, float far);
         void setPerspectiveProjection(float fovy, float aspect, float near, float far);
 
@@ -17,6 +26,10 @@ namespace Divide {
         [[nodiscard]] inline const glm::mat4& getProjection() const { return _projectionMatrix; }
         [[nodiscard]] inline const glm::mat4& getView() const { return _viewMatrix; }
         [[nodiscard]] inline const glm::mat4& getInverseView() const { return _inverseViewMatrix; }
+        [[nodiscard]] inline glm::vec3 getPosition() const { return glm::vec3(_inverseViewMatrix[3]); }
+        [[nodiscard]] inline bool isPerspective() const { return _projectionMatrix[2][3] != 0.f; }
+        // World space
+        [[nodiscard]] inline FrustumPlanes getFrustumPlanes() const { return extractFrustumPlanes(_projectionMatrix * _viewMatrix); }
 
     private:
         glm::mat4 _projectionMatrix{ 1.f };
@@ -0,0 +1,153 @@
+#include "CookedModel.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace Divide {
+
+    namespace {
+        uint64_t alignOffset(const uint64_t offset) {
+            return (offset + CookedModelFile::DATA_ALIGNMENT - 1) & ~(CookedModelFile::DATA_ALIGNMENT - 1);
+        }
+
+        void writePadding(std::ofstream& stream, const uint64_t targetOffset) {
+            static constexpr char zeroes[CookedModelFile::DATA_ALIGNMENT]{};
+            const uint64_t currentOffset = static_cast<uint64_t>(stream.tellp());
+            stream.write(zeroes, static_cast<std::streamsize>(targetOffset - currentOffset));
+        }
+    };
+
+    std::string CookedModelFile::getCookedPath(const std::string& sourcePath) {
+        return std::filesystem::path(sourcePath).replace_extension(FILE_EXTENSION).string();
+    }
+
+    bool CookedModelFile::write(const std::string& filePath, const Model::Builder& builder) {
+        std::ofstream stream{ filePath, std::ios::binary | std::ios::trunc };
+        if (!stream.is_open()) {
+            return false;
+        }
+
+        const VkIndexType indexType = Model::getIndexType(builder._vertices.size());
+        const std::vector<Model::Lod> lods = builder._lods.empty()
+                                               ? std::vector<Model::Lod>{ { 0u, static_cast<uint32_t>(builder._indices.size()), 0.f } }
+                                               : builder._lods;
+
+        Header header{};
+        header.vertexFormat = static_cast<uint32_t>(builder._vertexFormat);
+        header.vertexStride = static_cast<uint32_t>(Model::getVertexStride(builder._vertexFormat));
+        header.indexStride = static_cast<uint32_t>(Model::getIndexStride(indexType));
+        header.vertexCount = static_cast<uint32_t>(builder._vertices.size());
+        header.indexCount = static_cast<uint32_t>(builder._indices.size());
+        header.lodCount = static_cast<uint32_t>(lods.size());
+        header.meshletCount = static_cast<uint32_t>(builder._meshlets.size());
+        header.lodDataOffset = sizeof(Header);
+        header.meshletDataOffset = alignOffset(header.lodDataOffset + sizeof(Model::Lod) * lods.size());
+        header.vertexDataOffset = alignOffset(header.meshletDataOffset + sizeof(Model::Meshlet) * header.meshletCount);
+        header.indexDataOffset = alignOffset(header.vertexDataOffset + uint64_t{ header.vertexStride } * header.vertexCount);
+        for (int i = 0; i < 3; ++i) {
+            header.boundsMin[i] = builder._boundsMin[i];
+            header.boundsMax[i] = builder._boundsMax[i];
+        }
+        for (int i = 0; i < 4; ++i) {
+            header.boundingSphere[i] = builder._boundingSphere[i];
+        }
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        stream.write(reinterpret_cast<const char*>(lods.data()), static_cast<std::streamsize>(lods.size() * sizeof(Model::Lod)));
+        writePadding(stream, header.meshletDataOffset);
+        stream.write(reinterpret_cast<const char*>(builder._meshlets.data()), static_cast<std::streamsize>(builder._meshlets.size() * sizeof(Model::Meshlet)));
+        writePadding(stream, header.vertexDataOffset);
+        if (builder._vertexFormat == Model::VertexFormat::COMPACT) {
+            const auto vertices = builder.getCompactVertices();
+            stream.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size() * sizeof(Model::CompactVertex)));
+        } else {
+            stream.write(reinterpret_cast<const char*>(builder._vertices.data()), static_cast<std::streamsize>(builder._vertices.size() * sizeof(Model::Vertex)));
+        }
+
+        writePadding(stream, header.indexDataOffset);
+        if (indexType == VK_INDEX_TYPE_UINT16) {
+            const std::vector<uint16_t> indices(builder._indices.begin(), builder._indices.end());
+            stream.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size() * sizeof(uint16_t)));
+        } else {
+            stream.write(reinterpret_cast<const char*>(builder._indices.data()), static_cast<std::streamsize>(builder._indices.size() * sizeof(uint32_t)));
+        }
+
+        return stream.good();
+    }
+
+    bool CookedModelFile::open(const std::string& filePath) {
+        close();
+
+        if (!_file.open(filePath)) {
+            return false;
+        }
+
+        if (_file.size() < sizeof(Header)) {
+            std::cerr << "Cooked mesh [ " << filePath << " ] is truncated" << std::endl;
+            close();
+            return false;
+        }
+
+        const Header* header = reinterpret_cast<const Header*>(_file.data());
+        if (header->magic != FILE_MAGIC ||
+            header->version != FILE_VERSION ||
+            header->vertexFormat >= static_cast<uint32_t>(Model::VertexFormat::COUNT) ||
+            header->vertexStride != Model::getVertexStride(static_cast<Model::VertexFormat>(header->vertexFormat)) ||
+            (header->indexStride != sizeof(uint16_t) && header->indexStride != sizeof(uint32_t)))
+        {
+            std::cerr << "Cooked mesh [ " << filePath << " ] is out of date (version " << header->version << ", expected " << FILE_VERSION << "). Re-run the cook step." << std::endl;
+            close();
+            return false;
+        }
+
+        const uint64_t vertexDataEnd = header->vertexDataOffset + uint64_t{ header->vertexStride } * header->vertexCount;
+        const uint64_t indexDataEnd = header->indexDataOffset + uint64_t{ header->indexStride } * header->indexCount;
+        const uint64_t lodDataEnd = header->lodDataOffset + sizeof(Model::Lod) * header->lodCount;
+        const uint64_t meshletDataEnd = header->meshletDataOffset + sizeof(Model::Meshlet) * header->meshletCount;
+        if (header->lodCount == 0u ||
+            header->lodCount > Model::MAX_LODS ||
+            lodDataEnd > header->meshletDataOffset ||
+            meshletDataEnd > header->vertexDataOffset ||
+            header->meshletDataOffset % DATA_ALIGNMENT != 0u ||
+            header->vertexDataOffset % DATA_ALIGNMENT != 0u ||
+            header->indexDataOffset % DATA_ALIGNMENT != 0u ||
+            vertexDataEnd > _file.size() ||
+            indexDataEnd > _file.size())
+        {
+            std::cerr << "Cooked mesh [ " << filePath << " ] is corrupt" << std::endl;
+            close();
+            return false;
+        }
+
+        _header = header;
+        return true;
+    }
+
+    void CookedModelFile::close() {
+        _header = nullptr;
+        _file.close();
+    }
+
+    const Model::Lod* CookedModelFile::lods() const {
+        assert(isOpen() && "Cannot access LOD data of a closed cooked mesh");
+        return reinterpret_cast<const Model::Lod*>(_file.data() + _header->lodDataOffset);
+    }
+
+    const Model::Meshlet* CookedModelFile::meshlets() const {
+        assert(isOpen() && "Cannot access meshlet data of a closed cooked mesh");
+        return reinterpret_cast<const Model::Meshlet*>(_file.data() + _header->meshletDataOffset);
+    }
+
+    const std::byte* CookedModelFile::vertexData() const {
+        assert(isOpen() && "Cannot access vertex data of a closed cooked mesh");
+        return _file.data() + _header->vertexDataOffset;
+    }
+
+    const std::byte* CookedModelFile::indexData() const {
+        assert(isOpen() && "Cannot access index data of a closed cooked mesh");
+        return _file.data() + _header->indexDataOffset;
+    }
+}; //namespace Divide
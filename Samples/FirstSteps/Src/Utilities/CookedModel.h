@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Model.h"
+#include "Platform.h"
+
+#include <string>
+
+namespace Divide {
+    // Binary, pre-welded mesh produced offline by AssetTool. The vertex and index arrays are stored
+    // exactly as Model expects them so that loading is a memory map plus a copy into the staging buffers.
+    // Vertices use the builder's VertexFormat and indices are 16 bit whenever Model::getIndexType allows it.
+    // A table of Model::Lod ranges into the index data follows the header, then the (optional) Model::Meshlet table.
+    class CookedModelFile {
+    public:
+        static constexpr uint32_t FILE_MAGIC = 0x48534D44u; // "DMSH"
+        static constexpr uint32_t FILE_VERSION = 5u;
+        static constexpr uint64_t DATA_ALIGNMENT = 64u;
+        static constexpr const char* FILE_EXTENSION = ".mesh";
+
+        struct Header {
+            uint32_t magic = FILE_MAGIC;
+            uint32_t version = FILE_VERSION;
+            uint32_t vertexFormat = 0u;
+            uint32_t vertexStride = 0u;
+            uint32_t indexStride = 0u;
+            uint32_t vertexCount = 0u;
+            uint32_t indexCount = 0u;
+            uint32_t lodCount = 0u;
+            uint32_t meshletCount = 0u;
+            uint32_t reserved = 0u;
+            uint64_t vertexDataOffset = 0u;
+            uint64_t indexDataOffset = 0u;
+            uint64_t lodDataOffset = 0u;
+            uint64_t meshletDataOffset = 0u;
+            float boundsMin[3]{};
+            float boundsMax[3]{};
+            float boundingSphere[4]{};
+        };
+
+        CookedModelFile() = default;
+        ~CookedModelFile() = default;
+
+        CookedModelFile(const CookedModelFile&) = delete;
+        CookedModelFile& operator=(const CookedModelFile&) = delete;
+        CookedModelFile(CookedModelFile&&) = delete;
+        CookedModelFile& operator=(CookedModelFile&&) = delete;
+
+        // Where the cooked version of the given source asset lives (same folder, FILE_EXTENSION)
+        [[nodiscard]] static std::string getCookedPath(const std::string& sourcePath);
+        [[nodiscard]] static bool write(const std::string& filePath, const Model::Builder& builder);
+
+        // Maps the file and validates its header. Returns false for missing, truncated or out of date files.
+        [[nodiscard]] bool open(const std::string& filePath);
+        void close();
+
+        [[nodiscard]] inline bool isOpen() const { return _header != nullptr; }
+        [[nodiscard]] inline const Header& header() const { return *_header; }
+        [[nodiscard]] inline uint32_t vertexCount() const { return _header->vertexCount; }
+        [[nodiscard]] inline uint32_t indexCount() const { return _header->indexCount; }
+        [[nodiscard]] inline size_t fileSize() const { return _file.size(); }
+
+        [[nodiscard]] inline Model::VertexFormat vertexFormat() const { return static_cast<Model::VertexFormat>(_header->vertexFormat); }
+        [[nodiscard]] inline VkDeviceSize vertexDataSize() const { return VkDeviceSize{ _header->vertexStride } * _header->vertexCount; }
+        [[nodiscard]] inline VkDeviceSize indexDataSize() const { return VkDeviceSize{ _header->indexStride } * _header->indexCount; }
+
+        [[nodiscard]] const Model::Lod* lods() const;
+        [[nodiscard]] const Model::Meshlet* meshlets() const;
+        [[nodiscard]] const std::byte* vertexData() const;
+        [[nodiscard]] const std::byte* indexData() const;
+
+    private:
+        MappedFile _file{};
+        const Header* _header = nullptr;
+    };
+}; //namespace Divide
@@ -1,4 +1,6 @@
 #include "Device.h"
+#include "GeometryArena.h"
+#include "UploadManager.h"
 
 #include <cstring>
 #include <iostream>
@@ -45,6 +47,40 @@ namespace Divide {
         }
     }
 
+    // vkAllocateMemory straight from the device; MemoryAllocator carves these up
+    class VulkanMemoryBackend final : public DeviceMemoryBackend {
+    public:
+        explicit VulkanMemoryBackend(VkDevice device) : _device(device) {}
+
+        VkDeviceMemory allocate(const uint32_t memoryTypeIndex, const VkDeviceSize size) override {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = size;
+            allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+                return VK_NULL_HANDLE;
+            }
+            return memory;
+        }
+
+        void free(VkDeviceMemory memory) override {
+            vkFreeMemory(_device, memory, nullptr);
+        }
+
+        void* map(VkDeviceMemory memory) override {
+            void* ret = nullptr;
+            if (vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &ret) != VK_SUCCESS) {
+                throw std::runtime_error("failed to map device memory!");
+            }
+            return ret;
+        }
+
+    private:
+        VkDevice _device;
+    };
+
     // class member functions
     Device::Device(Window& window) : window{ window }
     {
@@ -54,9 +90,20 @@ namespace Divide {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createMemoryAllocator();
+        createUploadManager();
+        createGeometryArena();
     }
 
     Device::~Device() {
+        // In-flight uploads may still target arena pages, so they are drained first
+        _uploadManagerPtr.reset();
+        _geometryArenaPtr.reset();
+        _memoryAllocatorPtr.reset();
+        _memoryBackendPtr.reset();
+        if (transferCommandPool != commandPool) {
+            vkDestroyCommandPool(_device, transferCommandPool, nullptr);
+        }
         vkDestroyCommandPool(_device, commandPool, nullptr);
         vkDestroyDevice(_device, nullptr);
 
@@ -138,6 +185,12 @@ namespace Divide {
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        if (indices.transferFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.transferFamily);
+        }
+        if (indices.computeFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.computeFamily);
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -149,8 +202,20 @@ namespace Divide {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // Optional, for GPU driven rendering (see GpuScene)
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        const bool drawIndirectCount = isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCount) {
+            enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -159,8 +224,8 @@ namespace Divide {
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -177,6 +242,44 @@ namespace Divide {
 
         vkGetDeviceQueue(_device, indices.graphicsFamily, 0, &_graphicsQueue);
         vkGetDeviceQueue(_device, indices.presentFamily, 0, &_presentQueue);
+
+        // Without the extra families everything shares the graphics queue and the upload path skips ownership transfers
+        _transferQueue = _graphicsQueue;
+        _computeQueue = _graphicsQueue;
+        if (indices.transferFamilyHasValue) {
+            vkGetDeviceQueue(_device, indices.transferFamily, 0, &_transferQueue);
+        }
+        if (indices.computeFamilyHasValue) {
+            vkGetDeviceQueue(_device, indices.computeFamily, 0, &_computeQueue);
+        }
+        _queueFamilies = indices;
+
+        _supportsMultiDrawIndirect = deviceFeatures.multiDrawIndirect == VK_TRUE;
+        _supportsIndirectFirstInstance = deviceFeatures.drawIndirectFirstInstance == VK_TRUE;
+        {
+            VkPhysicalDeviceMemoryProperties memProperties;
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+            for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+                _supportsLazilyAllocatedMemory = _supportsLazilyAllocatedMemory || (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0u;
+            }
+
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+            _timestampValidBits = queueFamilies[indices.graphicsFamily].timestampValidBits;
+        }
+        if (drawIndirectCount) {
+            _cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(_device, "vkCmdDrawIndexedIndirectCountKHR"));
+        }
+
+        std::cout << "Transfer queue: " << (indices.transferFamilyHasValue ? "dedicated family " + std::to_string(indices.transferFamily) : std::string("shared with graphics"))
+                  << ", compute queue: " << (indices.computeFamilyHasValue ? "async family " + std::to_string(indices.computeFamily) : std::string("shared with graphics")) << std::endl;
+        std::cout << "Indirect draws: multi draw " << (_supportsMultiDrawIndirect ? "yes" : "no")
+                  << ", first instance " << (_supportsIndirectFirstInstance ? "yes" : "no")
+                  << ", draw count " << (supportsDrawIndirectCount() ? "yes" : "no") << std::endl;
+        std::cout << "Lazily allocated memory: " << (_supportsLazilyAllocatedMemory ? "yes" : "no")
+                  << ", timestamps: " << (supportsTimestamps() ? "yes" : "no") << std::endl;
     }
 
     void Device::createCommandPool() {
@@ -190,6 +293,14 @@ namespace Divide {
         if (vkCreateCommandPool(_device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
+
+        transferCommandPool = commandPool;
+        if (_queueFamilies.transferFamilyHasValue) {
+            poolInfo.queueFamilyIndex = _queueFamilies.transferFamily;
+            if (vkCreateCommandPool(_device, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create transfer command pool!");
+            }
+        }
     }
 
     void Device::createSurface() {
@@ -295,6 +406,21 @@ namespace Divide {
         }
     }
 
+    bool Device::isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (std::strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     bool Device::checkDeviceExtensionSupport(VkPhysicalDevice device) {
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -324,20 +450,37 @@ namespace Divide {
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-        int i = 0;
+        uint32_t i = 0;
         for (const auto& queueFamily : queueFamilies) {
-            if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                indices.graphicsFamily = i;
-                indices.graphicsFamilyHasValue = true;
+            if (queueFamily.queueCount == 0) {
+                i++;
+                continue;
             }
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
-            if (queueFamily.queueCount > 0 && presentSupport) {
-                indices.presentFamily = i;
-                indices.presentFamilyHasValue = true;
+
+            if (!indices.isComplete()) {
+                if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                    indices.graphicsFamily = i;
+                    indices.graphicsFamilyHasValue = true;
+                }
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, _surface, &presentSupport);
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                    indices.presentFamilyHasValue = true;
+                }
             }
-            if (indices.isComplete()) {
-                break;
+
+            if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) == 0) {
+                // Prefer a transfer-only family (the copy engines) over a compute family that can also copy
+                const bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) == 0;
+                if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && (!indices.transferFamilyHasValue || transferOnly)) {
+                    indices.transferFamily = i;
+                    indices.transferFamilyHasValue = true;
+                }
+                if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !indices.computeFamilyHasValue) {
+                    indices.computeFamily = i;
+                    indices.computeFamilyHasValue = true;
+                }
             }
 
             i++;
@@ -402,12 +545,33 @@ namespace Divide {
         throw std::runtime_error("failed to find suitable memory type!");
     }
 
+    void Device::createMemoryAllocator() {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        std::vector<VkMemoryPropertyFlags> memoryTypeFlags(memProperties.memoryTypeCount);
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            memoryTypeFlags[i] = memProperties.memoryTypes[i].propertyFlags;
+        }
+
+        _memoryBackendPtr = std::make_unique<VulkanMemoryBackend>(_device);
+        _memoryAllocatorPtr = std::make_unique<MemoryAllocator>(*_memoryBackendPtr, std::move(memoryTypeFlags), properties.limits.nonCoherentAtomSize);
+    }
+
+    void Device::createUploadManager() {
+        _uploadManagerPtr = std::make_unique<UploadManager>(*this);
+    }
+
+    void Device::createGeometryArena() {
+        _geometryArenaPtr = std::make_unique<GeometryArena>(*this);
+    }
+
     void Device::createBuffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        MemoryAllocation& allocation) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -421,16 +585,15 @@ namespace Divide {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        allocation = _memoryAllocatorPtr->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), ResourceTiling::LINEAR);
 
-        if (vkAllocateMemory(_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        if (vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind buffer memory!");
         }
+    }
 
-        vkBindBufferMemory(_device, buffer, bufferMemory, 0);
+    void Device::freeMemory(MemoryAllocation& allocation) {
+        _memoryAllocatorPtr->free(allocation);
     }
 
     VkCommandBuffer Device::beginSingleTimeCommands() {
@@ -508,7 +671,7 @@ namespace Divide {
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) {
+        MemoryAllocation& allocation) {
         if (vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -516,16 +679,10 @@ namespace Divide {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(_device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
+        const ResourceTiling tiling = imageInfo.tiling == VK_IMAGE_TILING_LINEAR ? ResourceTiling::LINEAR : ResourceTiling::OPTIMAL;
+        allocation = _memoryAllocatorPtr->allocate(memRequirements, findMemoryType(memRequirements.memoryTypeBits, properties), tiling);
 
-        if (vkBindImageMemory(_device, image, imageMemory, 0) != VK_SUCCESS) {
+        if (vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
             throw std::runtime_error("failed to bind image memory!");
         }
     }
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace Divide {
 
+class GeometryArena;
+class UploadManager;
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
@@ -16,8 +21,13 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
     uint32_t graphicsFamily;
     uint32_t presentFamily;
+    // Optional families without graphics support, so work on them runs alongside rendering
+    uint32_t transferFamily;
+    uint32_t computeFamily;
     bool graphicsFamilyHasValue = false;
     bool presentFamilyHasValue = false;
+    bool transferFamilyHasValue = false;
+    bool computeFamilyHasValue = false;
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -44,6 +54,35 @@ class Device {
     VkSurfaceKHR surface() { return _surface; }
     VkQueue graphicsQueue() { return _graphicsQueue; }
     VkQueue presentQueue() { return _presentQueue; }
+    // The graphics queue/pool when the device has no dedicated transfer (or async compute) family
+    VkQueue transferQueue() { return _transferQueue; }
+    VkQueue computeQueue() { return _computeQueue; }
+    VkCommandPool getTransferCommandPool() { return transferCommandPool; }
+    bool hasDedicatedTransferQueue() const { return _queueFamilies.transferFamilyHasValue; }
+    bool hasAsyncComputeQueue() const { return _queueFamilies.computeFamilyHasValue; }
+    uint32_t getGraphicsQueueFamily() const { return _queueFamilies.graphicsFamily; }
+    uint32_t getTransferQueueFamily() const { return hasDedicatedTransferQueue() ? _queueFamilies.transferFamily : _queueFamilies.graphicsFamily; }
+    uint32_t getComputeQueueFamily() const { return hasAsyncComputeQueue() ? _queueFamilies.computeFamily : _queueFamilies.graphicsFamily; }
+
+    // Indirect draw capabilities. Without drawIndirectFirstInstance, indirect draws can't address per-object data.
+    bool supportsMultiDrawIndirect() const { return _supportsMultiDrawIndirect; }
+    bool supportsIndirectFirstInstance() const { return _supportsIndirectFirstInstance; }
+    bool supportsDrawIndirectCount() const { return _cmdDrawIndexedIndirectCount != nullptr; }
+    // Tilers back transient attachments (e.g. a G-buffer that never leaves tile memory) with lazily allocated memory
+    bool supportsLazilyAllocatedMemory() const { return _supportsLazilyAllocatedMemory; }
+    // Timestamp queries on the graphics queue. properties.limits.timestampPeriod converts ticks to nanoseconds.
+    bool supportsTimestamps() const { return _timestampValidBits > 0u && properties.limits.timestampPeriod > 0.f; }
+    uint32_t getTimestampValidBits() const { return _timestampValidBits; }
+    // VK_KHR_draw_indirect_count. Only valid if supportsDrawIndirectCount().
+    void cmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer,
+                                     VkBuffer buffer,
+                                     VkDeviceSize offset,
+                                     VkBuffer countBuffer,
+                                     VkDeviceSize countBufferOffset,
+                                     uint32_t maxDrawCount,
+                                     uint32_t stride) {
+        _cmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countBufferOffset, maxDrawCount, stride);
+    }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -52,11 +91,12 @@ class Device {
         const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
     // Buffer Helper Functions
+    // Memory comes from the pooled MemoryAllocator; release it with freeMemory after destroying the resource
     void createBuffer(VkDeviceSize size,
                       VkBufferUsageFlags usage,
                       VkMemoryPropertyFlags properties,
                       VkBuffer &buffer,
-                      VkDeviceMemory &bufferMemory);
+                      MemoryAllocation &allocation);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -65,7 +105,12 @@ class Device {
     void createImageWithInfo(const VkImageCreateInfo &imageInfo,
                              VkMemoryPropertyFlags properties,
                              VkImage &image,
-                             VkDeviceMemory &imageMemory);
+                             MemoryAllocation &allocation);
+    void freeMemory(MemoryAllocation &allocation);
+
+    MemoryAllocator &getMemoryAllocator() { return *_memoryAllocatorPtr; }
+    UploadManager &getUploadManager() { return *_uploadManagerPtr; }
+    GeometryArena &getGeometryArena() { return *_geometryArenaPtr; }
 
     VkPhysicalDeviceProperties properties;
 
@@ -76,6 +121,9 @@ private:
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void createMemoryAllocator();
+    void createUploadManager();
+    void createGeometryArena();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -85,6 +133,7 @@ private:
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
@@ -92,11 +141,26 @@ private:
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     Window &window;
     VkCommandPool commandPool;
+    VkCommandPool transferCommandPool = VK_NULL_HANDLE;
 
     VkDevice _device;
     VkSurfaceKHR _surface;
     VkQueue _graphicsQueue;
     VkQueue _presentQueue;
+    VkQueue _transferQueue;
+    VkQueue _computeQueue;
+    QueueFamilyIndices _queueFamilies{};
+
+    bool _supportsMultiDrawIndirect = false;
+    bool _supportsIndirectFirstInstance = false;
+    bool _supportsLazilyAllocatedMemory = false;
+    uint32_t _timestampValidBits = 0u;
+    PFN_vkCmdDrawIndexedIndirectCountKHR _cmdDrawIndexedIndirectCount = nullptr;
+
+    std::unique_ptr<DeviceMemoryBackend> _memoryBackendPtr;
+    std::unique_ptr<MemoryAllocator> _memoryAllocatorPtr;
+    std::unique_ptr<UploadManager> _uploadManagerPtr;
+    std::unique_ptr<GeometryArena> _geometryArenaPtr;
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -0,0 +1,61 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Divide {
+
+    FrameAllocator::FrameAllocator(Device& device, const uint32_t frameCount, const VkDeviceSize frameCapacity)
+        : _buffer(device,
+                  frameCapacity,
+                  frameCount + 1u,
+                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                  std::max(device.properties.limits.minUniformBufferOffsetAlignment, device.properties.limits.minStorageBufferOffsetAlignment))
+        , _frameCapacity(_buffer.getAlignmentSize())
+        , _frameCount(frameCount)
+    {
+        _alignments[static_cast<size_t>(Usage::UNIFORM)] = std::max(device.properties.limits.minUniformBufferOffsetAlignment, VkDeviceSize{ 1u });
+        _alignments[static_cast<size_t>(Usage::STORAGE)] = std::max(device.properties.limits.minStorageBufferOffsetAlignment, VkDeviceSize{ 1u });
+
+        if (_buffer.map() != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map the frame allocator!");
+        }
+        _mappedMemory = static_cast<std::byte*>(_buffer.getMappedMemory());
+        _stats.frameCapacity = _frameCapacity;
+    }
+
+    void FrameAllocator::beginFrame(const uint32_t frameIndex) {
+        assert(frameIndex < _frameCount && "Invalid frame index");
+
+        _frameBase = _frameCapacity * frameIndex;
+        _frameOffset = 0u;
+        _stats.usedBytes = 0u;
+        _stats.allocationCount = 0u;
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocate(const VkDeviceSize size, const Usage usage) {
+        const VkDeviceSize alignment = _alignments[static_cast<size_t>(usage)];
+        const VkDeviceSize offset = (_frameOffset + alignment - 1u) / alignment * alignment;
+        if (offset + size > _frameCapacity) {
+            throw std::runtime_error("Frame allocator exhausted!");
+        }
+
+        _frameOffset = offset + size;
+        _stats.usedBytes = _frameOffset;
+        _stats.peakUsedBytes = std::max(_stats.peakUsedBytes, _frameOffset);
+        _stats.allocationCount += 1u;
+
+        Slice slice{};
+        slice.mapped = _mappedMemory + _frameBase + offset;
+        slice.offset = static_cast<uint32_t>(_frameBase + offset);
+        slice.size = size;
+        return slice;
+    }
+
+    VkDescriptorBufferInfo FrameAllocator::descriptorInfo(const VkDeviceSize range) const {
+        assert(range <= _frameCapacity && "Dynamic descriptor range larger than the spare region");
+        return VkDescriptorBufferInfo{ _buffer.getBuffer(), 0u, range };
+    }
+}; //namespace Divide
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace Divide {
+    // Bump allocator for transient per-frame GPU data (uniforms, per-draw structs, instance arrays). One persistently
+    // mapped buffer is split into a region per frame in flight; allocations just advance an offset and the whole
+    // region is recycled in beginFrame(). Slices are addressed through *_DYNAMIC descriptors that all point at the
+    // start of the buffer, so pushing data never touches descriptor sets: the returned offset is the dynamic offset.
+    // A spare region at the end lets such a descriptor span up to a whole frame's capacity from any slice.
+    class FrameAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = VkDeviceSize{ 4u } << 20;
+
+        enum class Usage : uint8_t {
+            UNIFORM = 0, // minUniformBufferOffsetAlignment
+            STORAGE,     // minStorageBufferOffsetAlignment
+            COUNT
+        };
+
+        struct Slice {
+            void* mapped = nullptr;
+            // Dynamic offset to bind the slice with
+            uint32_t offset = 0u;
+            VkDeviceSize size = 0u;
+        };
+
+        struct Stats {
+            VkDeviceSize frameCapacity = 0u;
+            // Bytes (alignment padding included) used by the current frame so far, and the most any frame used
+            VkDeviceSize usedBytes = 0u;
+            VkDeviceSize peakUsedBytes = 0u;
+            uint32_t allocationCount = 0u;
+        };
+
+        FrameAllocator(Device& device, uint32_t frameCount, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY);
+
+        FrameAllocator(const FrameAllocator&) = delete;
+        FrameAllocator& operator=(const FrameAllocator&) = delete;
+        FrameAllocator(FrameAllocator&&) = delete;
+        FrameAllocator& operator=(FrameAllocator&&) = delete;
+
+        // Recycles 'frameIndex''s region. Only call once that frame's fence has signalled (i.e. after Renderer::beginFrame).
+        void beginFrame(uint32_t frameIndex);
+
+        // Throws std::runtime_error if the frame's region is exhausted
+        [[nodiscard]] Slice allocate(VkDeviceSize size, Usage usage);
+
+        template<typename T>
+        [[nodiscard]] uint32_t push(const T& data, const Usage usage = Usage::UNIFORM) {
+            static_assert(std::is_trivially_copyable_v<T>, "Frame data is copied straight into GPU memory");
+            const Slice slice = allocate(sizeof(T), usage);
+            std::memcpy(slice.mapped, &data, sizeof(T));
+            return slice.offset;
+        }
+
+        // For a *_DYNAMIC descriptor whose shader block is 'range' bytes (at most one frame's capacity, e.g. for
+        // runtime sized storage arrays)
+        [[nodiscard]] VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const;
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+
+    private:
+        Buffer _buffer;
+        std::byte* _mappedMemory = nullptr;
+        const VkDeviceSize _frameCapacity;
+        const uint32_t _frameCount;
+        VkDeviceSize _alignments[static_cast<size_t>(Usage::COUNT)]{};
+
+        VkDeviceSize _frameBase = 0u;
+        VkDeviceSize _frameOffset = 0u;
+        Stats _stats{};
+    };
+}; //namespace Divide
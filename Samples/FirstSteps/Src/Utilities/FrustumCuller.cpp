@@ -0,0 +1,205 @@
+#include "FrustumCuller.h"
+
+#include <cassert>
+
+#if defined(__AVX__)
+#define FRUSTUM_CULL_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Divide {
+
+    namespace {
+        // Shared by every path so they all round identically: d = ((nx * x + ny * y) + nz * z) + w, visible while d >= -r.
+        // Written as !(d >= -r) so NaNs count as visible, like the SIMD comparisons.
+        uint32_t cullScalar(const FrustumPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+                            const uint32_t begin, const uint32_t end, uint32_t* out) {
+            uint32_t count = 0u;
+            for (uint32_t i = begin; i < end; ++i) {
+                bool visible = true;
+                for (const glm::vec4& plane : planes) {
+                    const float distance = plane.x * x[i] + plane.y * y[i] + plane.z * z[i] + plane.w;
+                    if (!(distance >= -radius[i])) {
+                        visible = false;
+                        break;
+                    }
+                }
+                out[count] = i;
+                count += visible ? 1u : 0u;
+            }
+            return count;
+        }
+
+#if defined(FRUSTUM_CULL_SSE)
+        uint32_t cullSSE(const FrustumPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+                         const uint32_t sphereCount, uint32_t* out) {
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (size_t p = 0u; p < planes.size(); ++p) {
+                planeX[p] = _mm_set1_ps(planes[p].x);
+                planeY[p] = _mm_set1_ps(planes[p].y);
+                planeZ[p] = _mm_set1_ps(planes[p].z);
+                planeW[p] = _mm_set1_ps(planes[p].w);
+            }
+
+            const __m128 zero = _mm_setzero_ps();
+            uint32_t count = 0u;
+            uint32_t i = 0u;
+            for (; i + 4u <= sphereCount; i += 4u) {
+                const __m128 sphereX = _mm_loadu_ps(x + i);
+                const __m128 sphereY = _mm_loadu_ps(y + i);
+                const __m128 sphereZ = _mm_loadu_ps(z + i);
+                const __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(radius + i));
+
+                __m128 visible = _mm_cmpeq_ps(zero, zero);
+                for (size_t p = 0u; p < planes.size(); ++p) {
+                    const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], sphereX), _mm_mul_ps(planeY[p], sphereY)),
+                                                                  _mm_mul_ps(planeZ[p], sphereZ)),
+                                                       planeW[p]);
+                    visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+                }
+
+                // Branchless compaction: every lane writes its index, only visible ones advance the output
+                const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(visible));
+                for (uint32_t lane = 0u; lane < 4u; ++lane) {
+                    out[count] = i + lane;
+                    count += (mask >> lane) & 1u;
+                }
+            }
+
+            return count + cullScalar(planes, x, y, z, radius, i, sphereCount, out + count);
+        }
+#endif
+
+#if defined(FRUSTUM_CULL_AVX)
+        uint32_t cullAVX(const FrustumPlanes& planes, const float* x, const float* y, const float* z, const float* radius,
+                         const uint32_t sphereCount, uint32_t* out) {
+            __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (size_t p = 0u; p < planes.size(); ++p) {
+                planeX[p] = _mm256_set1_ps(planes[p].x);
+                planeY[p] = _mm256_set1_ps(planes[p].y);
+                planeZ[p] = _mm256_set1_ps(planes[p].z);
+                planeW[p] = _mm256_set1_ps(planes[p].w);
+            }
+
+            const __m256 zero = _mm256_setzero_ps();
+            uint32_t count = 0u;
+            uint32_t i = 0u;
+            for (; i + 8u <= sphereCount; i += 8u) {
+                const __m256 sphereX = _mm256_loadu_ps(x + i);
+                const __m256 sphereY = _mm256_loadu_ps(y + i);
+                const __m256 sphereZ = _mm256_loadu_ps(z + i);
+                const __m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(radius + i));
+
+                __m256 visible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+                for (size_t p = 0u; p < planes.size(); ++p) {
+                    // No FMA: it would round differently from the other paths
+                    const __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], sphereX), _mm256_mul_ps(planeY[p], sphereY)),
+                                                                        _mm256_mul_ps(planeZ[p], sphereZ)),
+                                                          planeW[p]);
+                    visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+                }
+
+                const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(visible));
+                for (uint32_t lane = 0u; lane < 8u; ++lane) {
+                    out[count] = i + lane;
+                    count += (mask >> lane) & 1u;
+                }
+            }
+
+            return count + cullScalar(planes, x, y, z, radius, i, sphereCount, out + count);
+        }
+#endif
+    };
+
+    FrustumCuller::Path FrustumCuller::getBestPath() {
+#if defined(FRUSTUM_CULL_AVX)
+        return Path::AVX;
+#elif defined(FRUSTUM_CULL_SSE)
+        return Path::SSE;
+#else
+        return Path::SCALAR;
+#endif
+    }
+
+    bool FrustumCuller::isSupported(const Path path) {
+        switch (path) {
+            case Path::SCALAR: return true;
+#if defined(FRUSTUM_CULL_SSE)
+            case Path::SSE: return true;
+#endif
+#if defined(FRUSTUM_CULL_AVX)
+            case Path::AVX: return true;
+#endif
+            default: break;
+        }
+        return false;
+    }
+
+    const char* FrustumCuller::getPathName(const Path path) {
+        switch (path) {
+            case Path::SCALAR: return "scalar";
+            case Path::SSE: return "SSE";
+            case Path::AVX: return "AVX";
+            default: break;
+        }
+        return "unknown";
+    }
+
+    void FrustumCuller::clear() {
+        _x.clear();
+        _y.clear();
+        _z.clear();
+        _radius.clear();
+    }
+
+    void FrustumCuller::reserve(const size_t sphereCount) {
+        _x.reserve(sphereCount);
+        _y.reserve(sphereCount);
+        _z.reserve(sphereCount);
+        _radius.reserve(sphereCount);
+    }
+
+    uint32_t FrustumCuller::addSphere(const glm::vec4& sphere) {
+        _x.push_back(sphere.x);
+        _y.push_back(sphere.y);
+        _z.push_back(sphere.z);
+        _radius.push_back(sphere.w);
+        return static_cast<uint32_t>(_radius.size() - 1u);
+    }
+
+    uint32_t FrustumCuller::cull(const FrustumPlanes& planes, std::vector<uint32_t>& visible, const Path path) const {
+        assert(isSupported(path) && "Culling path not available in this build");
+
+        const uint32_t sphereCount = getSphereCount();
+        // The compaction writes one slot past the last visible index at most, which is always < sphereCount
+        visible.resize(sphereCount);
+        if (sphereCount == 0u) {
+            return 0u;
+        }
+
+        uint32_t count = 0u;
+        switch (path) {
+#if defined(FRUSTUM_CULL_AVX)
+            case Path::AVX:
+                count = cullAVX(planes, _x.data(), _y.data(), _z.data(), _radius.data(), sphereCount, visible.data());
+                break;
+#endif
+#if defined(FRUSTUM_CULL_SSE)
+            case Path::SSE:
+                count = cullSSE(planes, _x.data(), _y.data(), _z.data(), _radius.data(), sphereCount, visible.data());
+                break;
+#endif
+            default:
+                count = cullScalar(planes, _x.data(), _y.data(), _z.data(), _radius.data(), 0u, sphereCount, visible.data());
+                break;
+        }
+
+        visible.resize(count);
+        return count;
+    }
+}; //namespace Divide
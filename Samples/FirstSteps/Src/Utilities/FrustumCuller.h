@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <vector>
+
+namespace Divide {
+    // Tests world space bounding spheres against a frustum in bulk. Spheres are stored as a structure of arrays so the
+    // plane tests run on 8 (AVX) or 4 (SSE) spheres at a time, with a scalar loop for the remainder and for builds
+    // without either. Every path produces exactly the same result.
+    class FrustumCuller {
+    public:
+        enum class Path : uint8_t {
+            SCALAR = 0,
+            SSE,
+            AVX,
+            COUNT
+        };
+
+        // Widest path this build was compiled for
+        [[nodiscard]] static Path getBestPath();
+        [[nodiscard]] static bool isSupported(Path path);
+        [[nodiscard]] static const char* getPathName(Path path);
+
+        void clear();
+        void reserve(size_t sphereCount);
+        // xyz: centre, w: radius. Returns the index cull() reports the sphere under.
+        uint32_t addSphere(const glm::vec4& sphere);
+
+        [[nodiscard]] inline uint32_t getSphereCount() const { return static_cast<uint32_t>(_radius.size()); }
+        [[nodiscard]] inline glm::vec4 getSphere(const uint32_t index) const { return { _x[index], _y[index], _z[index], _radius[index] }; }
+
+        // Fills 'visible' with the indices of the spheres that intersect or lie inside 'planes', in increasing order,
+        // and returns how many there are
+        uint32_t cull(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const { return cull(planes, visible, getBestPath()); }
+        uint32_t cull(const FrustumPlanes& planes, std::vector<uint32_t>& visible, Path path) const;
+
+    private:
+        std::vector<float> _x{};
+        std::vector<float> _y{};
+        std::vector<float> _z{};
+        std::vector<float> _radius{};
+    };
+}; //namespace Divide
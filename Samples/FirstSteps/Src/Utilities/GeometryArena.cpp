@@ -0,0 +1,205 @@
+#include "GeometryArena.h"
+#include "UploadBatch.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Divide {
+
+    namespace {
+        VkDeviceSize getIndexStride(const VkIndexType indexType) {
+            return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+    };
+
+    GeometryArena::Page::Page(Device& device, const VkDeviceSize vertexStride, const uint32_t vertexCapacity, const VkDeviceSize indexStride, const uint32_t indexCapacity)
+        : _vertexBuffer(device,
+                        vertexStride,
+                        vertexCapacity,
+                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        , _indexBuffer(device,
+                       indexStride,
+                       indexCapacity,
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+        , _vertices(vertexCapacity)
+        , _indices(indexCapacity)
+    {
+    }
+
+    GeometryArena::GeometryArena(Device& device)
+        : _device(device)
+    {
+    }
+
+    GeometryArena::~GeometryArena()
+    {
+        // The device is idle by now
+        for (const std::vector<Range>& retired : _retiredRanges) {
+            for (const Range& range : retired) {
+                release(range);
+            }
+        }
+
+        for (const Pool& pool : _pools) {
+            for (const auto& page : pool._pages) {
+                assert((page == nullptr || page->_rangeCount == 0u) && "Geometry arena range leaked");
+                (void)page;
+            }
+        }
+    }
+
+    uint32_t GeometryArena::getPoolIndex(const VkDeviceSize vertexStride, const VkIndexType indexType) {
+        for (uint32_t i = 0u; i < _pools.size(); ++i) {
+            if (_pools[i]._vertexStride == vertexStride && _pools[i]._indexType == indexType) {
+                return i;
+            }
+        }
+
+        Pool& pool = _pools.emplace_back();
+        pool._vertexStride = vertexStride;
+        pool._indexType = indexType;
+        return static_cast<uint32_t>(_pools.size() - 1u);
+    }
+
+    GeometryArena::Range GeometryArena::allocate(const VkDeviceSize vertexStride, const VkIndexType indexType,
+                                                 const void* vertices, const uint32_t vertexCount,
+                                                 const void* indices, const uint32_t indexCount,
+                                                 UploadBatch& batch)
+    {
+        assert(vertexCount > 0u && "Cannot allocate empty geometry");
+
+        Range range{};
+        range.poolIndex = getPoolIndex(vertexStride, indexType);
+        range.vertexCount = vertexCount;
+        range.indexCount = indexCount;
+
+        Pool& pool = _pools[range.poolIndex];
+        const VkDeviceSize indexStride = getIndexStride(indexType);
+
+        const auto tryPage = [&](const uint32_t pageIndex) {
+            Page& page = *pool._pages[pageIndex];
+            const uint64_t vertexOffset = page._vertices.allocate(vertexCount);
+            if (vertexOffset == RangeAllocator::INVALID_OFFSET) {
+                return false;
+            }
+
+            uint64_t firstIndex = 0u;
+            if (indexCount > 0u) {
+                firstIndex = page._indices.allocate(indexCount);
+                if (firstIndex == RangeAllocator::INVALID_OFFSET) {
+                    page._vertices.free(vertexOffset, vertexCount);
+                    return false;
+                }
+            }
+
+            range.pageIndex = pageIndex;
+            range.vertexOffset = static_cast<uint32_t>(vertexOffset);
+            range.firstIndex = static_cast<uint32_t>(firstIndex);
+            page._rangeCount += 1u;
+            return true;
+        };
+
+        bool allocated = false;
+        uint32_t freeSlot = INVALID_INDEX;
+        for (uint32_t i = 0u; i < pool._pages.size() && !allocated; ++i) {
+            if (pool._pages[i] == nullptr) {
+                freeSlot = std::min(freeSlot, i);
+            } else {
+                allocated = tryPage(i);
+            }
+        }
+
+        if (!allocated) {
+            // Geometry larger than a default page gets a page of its own size
+            const uint32_t vertexCapacity = std::max(static_cast<uint32_t>(VERTEX_PAGE_SIZE / vertexStride), vertexCount);
+            const uint32_t indexCapacity = std::max(static_cast<uint32_t>(INDEX_PAGE_SIZE / indexStride), indexCount);
+
+            if (freeSlot == INVALID_INDEX) {
+                freeSlot = static_cast<uint32_t>(pool._pages.size());
+                pool._pages.emplace_back();
+            }
+            pool._pages[freeSlot] = std::make_unique<Page>(_device, vertexStride, vertexCapacity, indexStride, indexCapacity);
+
+            allocated = tryPage(freeSlot);
+            assert(allocated && "A fresh page must fit the geometry it was sized for");
+        }
+
+        Page& page = *pool._pages[range.pageIndex];
+        batch.copyToBuffer(vertices, vertexStride * vertexCount, page._vertexBuffer.getBuffer(), vertexStride * range.vertexOffset);
+        if (indexCount > 0u) {
+            batch.copyToBuffer(indices, indexStride * indexCount, page._indexBuffer.getBuffer(), indexStride * range.firstIndex);
+        }
+
+        return range;
+    }
+
+    void GeometryArena::free(Range& range) {
+        if (!range.isValid()) {
+            return;
+        }
+
+        _retiredRanges[_frameIndex].push_back(range);
+        range = {};
+    }
+
+    void GeometryArena::beginFrame(const uint32_t frameIndex) {
+        if (frameIndex >= _retiredRanges.size()) {
+            _retiredRanges.resize(frameIndex + 1u);
+        }
+        _frameIndex = frameIndex;
+
+        for (const Range& range : _retiredRanges[frameIndex]) {
+            release(range);
+        }
+        _retiredRanges[frameIndex].clear();
+    }
+
+    void GeometryArena::release(const Range& range) {
+        Pool& pool = _pools[range.poolIndex];
+        auto& page = pool._pages[range.pageIndex];
+        assert(page != nullptr && "Range does not belong to this arena");
+
+        page->_vertices.free(range.vertexOffset, range.vertexCount);
+        if (range.indexCount > 0u) {
+            page->_indices.free(range.firstIndex, range.indexCount);
+        }
+        page->_rangeCount -= 1u;
+
+        // Keep the first page of every pool around; it is the one a steady set of models keeps landing in
+        if (page->_rangeCount == 0u && range.pageIndex > 0u) {
+            page.reset();
+        }
+    }
+
+    void GeometryArena::bind(VkCommandBuffer commandBuffer, const Range& range) const {
+        assert(range.isValid() && "Cannot bind an invalid geometry range");
+
+        const Pool& pool = _pools[range.poolIndex];
+        const Page& page = *pool._pages[range.pageIndex];
+
+        VkBuffer buffers[] = { page._vertexBuffer.getBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, page._indexBuffer.getBuffer(), 0, pool._indexType);
+    }
+
+    GeometryArena::Stats GeometryArena::getStats() const {
+        Stats stats{};
+        for (const Pool& pool : _pools) {
+            const VkDeviceSize indexStride = getIndexStride(pool._indexType);
+            for (const auto& page : pool._pages) {
+                if (page == nullptr) {
+                    continue;
+                }
+
+                stats.pageCount += 1u;
+                stats.rangeCount += page->_rangeCount;
+                stats.reservedBytes += page->_vertices.getCapacity() * pool._vertexStride + page->_indices.getCapacity() * indexStride;
+                stats.usedBytes += page->_vertices.getUsedSize() * pool._vertexStride + page->_indices.getUsedSize() * indexStride;
+            }
+        }
+        return stats;
+    }
+}; //namespace Divide
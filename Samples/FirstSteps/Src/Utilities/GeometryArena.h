@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Buffer.h"
+#include "RangeAllocator.h"
+
+#include <memory>
+#include <vector>
+
+namespace Divide {
+    class UploadBatch;
+
+    // Every model's vertices and indices live in a few large shared buffers instead of a pair of buffers per model.
+    // There is one pool per vertex stride and index type (what a pipeline + vkCmdBindIndexBuffer pair can consume),
+    // each made of pages that are only added when the current ones are full. A model is then just a range: draw
+    // it with firstIndex/vertexOffset from its Range, and consecutive models from the same page share one bind.
+    class GeometryArena {
+    public:
+        static constexpr VkDeviceSize VERTEX_PAGE_SIZE = VkDeviceSize{ 32u } << 20;
+        static constexpr VkDeviceSize INDEX_PAGE_SIZE = VkDeviceSize{ 16u } << 20;
+        static constexpr uint32_t INVALID_INDEX = ~0u;
+
+        struct Range {
+            uint32_t poolIndex = INVALID_INDEX;
+            uint32_t pageIndex = INVALID_INDEX;
+            // In elements of the page's buffers
+            uint32_t vertexOffset = 0u;
+            uint32_t vertexCount = 0u;
+            uint32_t firstIndex = 0u;
+            uint32_t indexCount = 0u;
+
+            [[nodiscard]] inline bool isValid() const { return poolIndex != INVALID_INDEX; }
+            // Ranges with the same key draw from the same buffers
+            [[nodiscard]] inline uint64_t getBindKey() const { return (uint64_t{ poolIndex } << 32u) | pageIndex; }
+        };
+
+        struct Stats {
+            uint32_t pageCount = 0u;
+            uint32_t rangeCount = 0u;
+            // Size of every page's buffers, and how much of that holds geometry
+            VkDeviceSize reservedBytes = 0u;
+            VkDeviceSize usedBytes = 0u;
+        };
+
+        explicit GeometryArena(Device& device);
+        ~GeometryArena();
+
+        GeometryArena(const GeometryArena&) = delete;
+        GeometryArena& operator=(const GeometryArena&) = delete;
+        GeometryArena(GeometryArena&&) = delete;
+        GeometryArena& operator=(GeometryArena&&) = delete;
+
+        // Reserves space for the geometry and queues its upload on 'batch'. 'indices' may be null when 'indexCount' is 0.
+        [[nodiscard]] Range allocate(VkDeviceSize vertexStride, VkIndexType indexType,
+                                     const void* vertices, uint32_t vertexCount,
+                                     const void* indices, uint32_t indexCount,
+                                     UploadBatch& batch);
+        // Resets 'range'. Command buffers still in flight may be drawing from it, so the space (and an emptied page's
+        // buffers) only goes back at the next beginFrame() for the current frame index. Freeing an invalid range is a no-op.
+        void free(Range& range);
+        // Releases what was freed while 'frameIndex' was last current. Only call once that frame's fence has signalled
+        // (i.e. after Renderer::beginFrame): frames complete in submission order, so nothing can use those ranges anymore.
+        void beginFrame(uint32_t frameIndex);
+
+        // Binds the vertex (binding 0) and index buffers 'range' draws from
+        void bind(VkCommandBuffer commandBuffer, const Range& range) const;
+
+        [[nodiscard]] Stats getStats() const;
+
+    private:
+        struct Page {
+            Page(Device& device, VkDeviceSize vertexStride, uint32_t vertexCapacity, VkDeviceSize indexStride, uint32_t indexCapacity);
+
+            Buffer _vertexBuffer;
+            Buffer _indexBuffer;
+            RangeAllocator _vertices;
+            RangeAllocator _indices;
+            uint32_t _rangeCount = 0u;
+        };
+
+        struct Pool {
+            VkDeviceSize _vertexStride = 0u;
+            VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+            // Freed pages leave a null hole so the indices stored in live ranges stay valid
+            std::vector<std::unique_ptr<Page>> _pages{};
+        };
+
+        [[nodiscard]] uint32_t getPoolIndex(VkDeviceSize vertexStride, VkIndexType indexType);
+        // Hands the range's space back to its page, and the page's buffers back to the device if it emptied
+        void release(const Range& range);
+
+        Device& _device;
+        std::vector<Pool> _pools{};
+        // Ranges freed while each frame index was current, waiting for that frame's fence
+        std::vector<std::vector<Range>> _retiredRanges{ 1u };
+        uint32_t _frameIndex = 0u;
+    };
+}; //namespace Divide
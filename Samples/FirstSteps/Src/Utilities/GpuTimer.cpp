@@ -0,0 +1,110 @@
+#include "GpuTimer.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace Divide {
+
+    GpuTimer::GpuTimer(Device& device, const uint32_t frameCount)
+        : _device{ device }
+    {
+        if (!_device.supportsTimestamps()) {
+            return;
+        }
+
+        _timestampPeriod = _device.properties.limits.timestampPeriod;
+        const uint32_t validBits = _device.getTimestampValidBits();
+        _timestampMask = validBits >= 64u ? ~uint64_t{ 0u } : (uint64_t{ 1u } << validBits) - 1u;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2u * MAX_SCOPES;
+
+        _queryPools.resize(frameCount, VK_NULL_HANDLE);
+        for (VkQueryPool& pool : _queryPools) {
+            if (vkCreateQueryPool(_device.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create timestamp query pool!");
+            }
+        }
+        _pendingScopes.resize(frameCount);
+        _timestamps.resize(2u * MAX_SCOPES);
+    }
+
+    GpuTimer::~GpuTimer()
+    {
+        for (VkQueryPool pool : _queryPools) {
+            vkDestroyQueryPool(_device.device(), pool, nullptr);
+        }
+    }
+
+    void GpuTimer::collect(const uint32_t frameIndex) {
+        const std::vector<PendingScope>& scopes = _pendingScopes[frameIndex];
+        if (scopes.empty()) {
+            return;
+        }
+
+        // The frame's fence signalled, so the results are available and waiting would be a bug
+        const uint32_t queryCount = 2u * static_cast<uint32_t>(scopes.size());
+        const VkResult result = vkGetQueryPoolResults(_device.device(),
+                                                      _queryPools[frameIndex],
+                                                      0u,
+                                                      queryCount,
+                                                      sizeof(uint64_t) * queryCount,
+                                                      _timestamps.data(),
+                                                      sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            return;
+        }
+
+        _results.clear();
+        for (uint32_t i = 0u; i < scopes.size(); ++i) {
+            if (!scopes[i].closed) {
+                continue;
+            }
+            const uint64_t ticks = (_timestamps[2u * i + 1u] - _timestamps[2u * i]) & _timestampMask;
+            _results.push_back({ scopes[i].name, static_cast<float>(static_cast<double>(ticks) * _timestampPeriod * 1e-6) });
+        }
+    }
+
+    void GpuTimer::beginFrame(VkCommandBuffer commandBuffer, const uint32_t frameIndex) {
+        if (!isEnabled()) {
+            return;
+        }
+
+        assert(frameIndex < _queryPools.size() && "Invalid frame index");
+        assert(_openScopes.empty() && "Scopes left open in the previous frame!");
+
+        collect(frameIndex);
+        _pendingScopes[frameIndex].clear();
+        _frameIndex = frameIndex;
+        vkCmdResetQueryPool(commandBuffer, _queryPools[frameIndex], 0u, 2u * MAX_SCOPES);
+    }
+
+    void GpuTimer::beginScope(VkCommandBuffer commandBuffer, const char* name) {
+        if (!isEnabled()) {
+            return;
+        }
+
+        std::vector<PendingScope>& scopes = _pendingScopes[_frameIndex];
+        assert(scopes.size() < MAX_SCOPES && "Too many GPU timer scopes in one frame!");
+
+        const uint32_t index = static_cast<uint32_t>(scopes.size());
+        scopes.push_back({ name, false });
+        _openScopes.push_back(index);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPools[_frameIndex], 2u * index);
+    }
+
+    void GpuTimer::endScope(VkCommandBuffer commandBuffer) {
+        if (!isEnabled()) {
+            return;
+        }
+
+        assert(!_openScopes.empty() && "No GPU timer scope to end!");
+        const uint32_t index = _openScopes.back();
+        _openScopes.pop_back();
+        _pendingScopes[_frameIndex][index].closed = true;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPools[_frameIndex], 2u * index + 1u);
+    }
+}; //namespace Divide
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Device.h"
+
+#include <string>
+#include <vector>
+
+namespace Divide {
+    // GPU time of named scopes of a frame's command buffer, from timestamp queries. Every frame in flight has its own
+    // query pool, read back without waiting once its fence has signalled, so results are MAX_FRAMES_IN_FLIGHT frames late.
+    // Does nothing if the device can't do timestamps.
+    //
+    // Scopes may sit inside a render pass (e.g. around a subpass), but on tilers the work of a render pass isn't
+    // ordered the way it's recorded, so treat per-subpass times there as rough.
+    class GpuTimer {
+    public:
+        static constexpr uint32_t MAX_SCOPES = 16u;
+
+        struct Scope {
+            std::string name{};
+            float milliseconds = 0.f;
+        };
+
+        GpuTimer(Device& device, uint32_t frameCount);
+        ~GpuTimer();
+
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer& operator=(const GpuTimer&) = delete;
+        GpuTimer(GpuTimer&&) = delete;
+        GpuTimer& operator=(GpuTimer&&) = delete;
+
+        // Call once 'frameIndex''s fence has signalled, before any scope and outside of a render pass: collects what
+        // the frame index recorded last time (see getResults()) and resets its queries
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void beginScope(VkCommandBuffer commandBuffer, const char* name);
+        // Closes the innermost open scope
+        void endScope(VkCommandBuffer commandBuffer);
+
+        [[nodiscard]] inline bool isEnabled() const { return !_queryPools.empty(); }
+        // The scopes of the most recently completed frame, in the order they were begun
+        [[nodiscard]] inline const std::vector<Scope>& getResults() const { return _results; }
+
+    private:
+        // Scope i of a frame writes queries 2 * i (begin) and 2 * i + 1 (end)
+        struct PendingScope {
+            const char* name = nullptr;
+            bool closed = false;
+        };
+
+        void collect(uint32_t frameIndex);
+
+        Device& _device;
+        // Nanoseconds per tick
+        float _timestampPeriod = 0.f;
+        uint64_t _timestampMask = 0u;
+
+        std::vector<VkQueryPool> _queryPools{};
+        // Per frame in flight: the scopes recorded into its pool
+        std::vector<std::vector<PendingScope>> _pendingScopes{};
+        std::vector<uint32_t> _openScopes{};
+        uint32_t _frameIndex = 0u;
+
+        std::vector<uint64_t> _timestamps{};
+        std::vector<Scope> _results{};
+    };
+}; //namespace Divide
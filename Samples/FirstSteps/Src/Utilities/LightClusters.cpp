@@ -0,0 +1,182 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Divide {
+
+    namespace {
+        // Distance from 'value' to the [bounds.x, bounds.y] interval, 0 inside it
+        float distanceToRange(const float value, const glm::vec2& bounds) {
+            return std::max(std::max(bounds.x - value, value - bounds.y), 0.f);
+        }
+
+        uint32_t findTile(const float ndc, const uint32_t tileCount) {
+            const float tile = std::floor((ndc * 0.5f + 0.5f) * tileCount);
+            return static_cast<uint32_t>(std::clamp(tile, 0.f, static_cast<float>(tileCount - 1u)));
+        }
+    };
+
+    void LightClusters::buildClusterBounds(const glm::mat4& projection) {
+        // View space depths that map to 0 and 1: (P22 * z + P32) / (P23 * z + P33)
+        const float near = -projection[3][2] / projection[2][2];
+        const float far = (projection[3][3] - projection[3][2]) / (projection[2][2] - projection[2][3]);
+        assert(far > near && "Invalid projection");
+
+        _sliceDepths.resize(GRID_Z + 1u);
+        _slicing.logarithmic = projection[2][3] != 0.f;
+        if (_slicing.logarithmic) {
+            const float sliceNear = std::min(std::max(NEAR_SLICE_DEPTH, near), far);
+            _slicing.scale = (GRID_Z - 1u) / std::log(far / sliceNear);
+            _slicing.bias = 1.f - std::log(sliceNear) * _slicing.scale;
+            _sliceDepths[0] = near;
+            for (uint32_t z = 1u; z <= GRID_Z; ++z) {
+                _sliceDepths[z] = sliceNear * std::pow(far / sliceNear, static_cast<float>(z - 1u) / (GRID_Z - 1u));
+            }
+        } else {
+            _slicing.scale = GRID_Z / (far - near);
+            _slicing.bias = -near * _slicing.scale;
+            for (uint32_t z = 0u; z <= GRID_Z; ++z) {
+                _sliceDepths[z] = near + (far - near) * z / GRID_Z;
+            }
+        }
+        _sliceDepths[GRID_Z] = far;
+
+        // A tile's edge at depth d: ndc * w(d) = P[0][0] * x + P[2][0] * d + P[3][0], with w(d) = P23 * d + P33
+        const auto viewBounds = [&](const uint32_t tile, const uint32_t tileCount, const uint32_t slice, const uint32_t axis) {
+            glm::vec2 bounds{ std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+            for (const uint32_t edge : { tile, tile + 1u }) {
+                const float ndc = -1.f + 2.f * edge / tileCount;
+                for (const float depth : { _sliceDepths[slice], _sliceDepths[slice + 1u] }) {
+                    const float w = projection[2][3] * depth + projection[3][3];
+                    const float position = (ndc * w - projection[2][axis] * depth - projection[3][axis]) / projection[axis][axis];
+                    bounds.x = std::min(bounds.x, position);
+                    bounds.y = std::max(bounds.y, position);
+                }
+            }
+            return bounds;
+        };
+
+        _boundsX.resize(GRID_Z * GRID_X);
+        _boundsY.resize(GRID_Z * GRID_Y);
+        for (uint32_t z = 0u; z < GRID_Z; ++z) {
+            for (uint32_t x = 0u; x < GRID_X; ++x) {
+                _boundsX[z * GRID_X + x] = viewBounds(x, GRID_X, z, 0u);
+            }
+            for (uint32_t y = 0u; y < GRID_Y; ++y) {
+                _boundsY[z * GRID_Y + y] = viewBounds(y, GRID_Y, z, 1u);
+            }
+        }
+    }
+
+    uint32_t LightClusters::findSlice(const float depth) const {
+        const float slice = std::floor((_slicing.logarithmic ? std::log(std::max(depth, 1e-6f)) : depth) * _slicing.scale + _slicing.bias);
+        return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(GRID_Z - 1u)));
+    }
+
+    uint32_t LightClusters::findCluster(const glm::vec3& viewPosition) const {
+        const glm::vec4 clip = _projection * glm::vec4(viewPosition, 1.f);
+        const uint32_t x = findTile(clip.x / clip.w, GRID_X);
+        const uint32_t y = findTile(clip.y / clip.w, GRID_Y);
+        return (findSlice(viewPosition.z) * GRID_Y + y) * GRID_X + x;
+    }
+
+    void LightClusters::build(const glm::mat4& view, const glm::mat4& projection, const glm::vec4* lights, const uint32_t lightCount) {
+        if (projection != _projection || _sliceDepths.empty()) {
+            buildClusterBounds(projection);
+            _projection = projection;
+        }
+
+        _stats = {};
+        _stats.lights = lightCount;
+        _assignments.clear();
+        _counts.assign(CLUSTER_COUNT, 0u);
+
+        const float near = _sliceDepths.front();
+        const float far = _sliceDepths.back();
+        for (uint32_t i = 0u; i < lightCount; ++i) {
+            const glm::vec3 centre = glm::vec3(view * glm::vec4(glm::vec3(lights[i]), 1.f));
+            const float range = lights[i].w;
+            if (range <= 0.f || centre.z + range < near || centre.z - range > far) {
+                continue;
+            }
+
+            // Tiles covered by the projection of the sphere's box. Spheres reaching behind the eye may cover anything.
+            uint32_t minX = 0u;
+            uint32_t maxX = GRID_X - 1u;
+            uint32_t minY = 0u;
+            uint32_t maxY = GRID_Y - 1u;
+            if (projection[2][3] * (centre.z - range) + projection[3][3] > 0.f) {
+                glm::vec2 ndcMin{ std::numeric_limits<float>::max() };
+                glm::vec2 ndcMax{ std::numeric_limits<float>::lowest() };
+                for (uint32_t corner = 0u; corner < 8u; ++corner) {
+                    const glm::vec3 offset{ (corner & 1u) ? range : -range, (corner & 2u) ? range : -range, (corner & 4u) ? range : -range };
+                    const glm::vec4 clip = projection * glm::vec4(centre + offset, 1.f);
+                    const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                    ndcMin = glm::min(ndcMin, ndc);
+                    ndcMax = glm::max(ndcMax, ndc);
+                }
+                if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f) {
+                    continue;
+                }
+                minX = findTile(ndcMin.x, GRID_X);
+                maxX = findTile(ndcMax.x, GRID_X);
+                minY = findTile(ndcMin.y, GRID_Y);
+                maxY = findTile(ndcMax.y, GRID_Y);
+            }
+
+            // Then the sphere against each candidate cluster's box
+            const float range2 = range * range;
+            const uint32_t firstAssignment = static_cast<uint32_t>(_assignments.size());
+            const uint32_t minZ = findSlice(std::max(centre.z - range, near));
+            const uint32_t maxZ = findSlice(std::min(centre.z + range, far));
+            for (uint32_t z = minZ; z <= maxZ; ++z) {
+                const float dz = distanceToRange(centre.z, { _sliceDepths[z], _sliceDepths[z + 1u] });
+                if (dz * dz > range2) {
+                    continue;
+                }
+                for (uint32_t y = minY; y <= maxY; ++y) {
+                    const float dy = distanceToRange(centre.y, _boundsY[z * GRID_Y + y]);
+                    const float dzy2 = dz * dz + dy * dy;
+                    if (dzy2 > range2) {
+                        continue;
+                    }
+                    for (uint32_t x = minX; x <= maxX; ++x) {
+                        const float dx = distanceToRange(centre.x, _boundsX[z * GRID_X + x]);
+                        if (dzy2 + dx * dx <= range2) {
+                            const uint32_t cluster = (z * GRID_Y + y) * GRID_X + x;
+                            _assignments.push_back((uint64_t{ cluster } << 32) | i);
+                            _counts[cluster] += 1u;
+                        }
+                    }
+                }
+            }
+            if (_assignments.size() > firstAssignment) {
+                _stats.visibleLights += 1u;
+            }
+        }
+
+        // Counting sort by cluster. Lights were visited in order, so every cluster's list ends up sorted.
+        const uint32_t headerSize = 2u * CLUSTER_COUNT;
+        _clusterData.resize(headerSize + _assignments.size());
+        uint32_t offset = headerSize;
+        for (uint32_t cluster = 0u; cluster < CLUSTER_COUNT; ++cluster) {
+            const uint32_t count = _counts[cluster];
+            _clusterData[2u * cluster] = offset;
+            _clusterData[2u * cluster + 1u] = count;
+            _counts[cluster] = offset;
+            offset += count;
+
+            if (count > 0u) {
+                _stats.occupiedClusters += 1u;
+                _stats.maxLightsPerCluster = std::max(_stats.maxLightsPerCluster, count);
+            }
+        }
+        for (const uint64_t assignment : _assignments) {
+            _clusterData[_counts[assignment >> 32]++] = static_cast<uint32_t>(assignment);
+        }
+        _stats.lightIndices = static_cast<uint32_t>(_assignments.size());
+    }
+}; //namespace Divide
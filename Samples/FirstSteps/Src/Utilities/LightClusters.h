@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <vector>
+
+namespace Divide {
+    // Clustered light assignment. The view frustum is split into GRID_X * GRID_Y screen tiles and GRID_Z depth slices,
+    // and every light's sphere of influence is binned into the clusters it touches, so a fragment only has to walk the
+    // lights of its own cluster instead of all of them.
+    //
+    // Slices are exponential in view depth with a perspective projection (slice 0 covers everything closer than
+    // NEAR_SLICE_DEPTH, so the near plane doesn't eat half the slices) and linear with an orthographic one. The output
+    // is one array: an [offset, count] pair per cluster, followed by the light indices the pairs point into.
+    class LightClusters {
+    public:
+        static constexpr uint32_t GRID_X = 16u;
+        static constexpr uint32_t GRID_Y = 9u;
+        static constexpr uint32_t GRID_Z = 24u;
+        static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+        static constexpr float NEAR_SLICE_DEPTH = 0.1f;
+
+        // Depth slice of a view space depth: (log(depth) when logarithmic, else depth) * scale + bias, clamped to the grid
+        struct DepthSlicing {
+            float scale = 1.f;
+            float bias = 0.f;
+            bool logarithmic = false;
+        };
+
+        struct Stats {
+            // Passed to the last build()
+            uint32_t lights = 0u;
+            // Lights that reached at least one cluster
+            uint32_t visibleLights = 0u;
+            uint32_t occupiedClusters = 0u;
+            uint32_t maxLightsPerCluster = 0u;
+            // Sum of every cluster's light count
+            uint32_t lightIndices = 0u;
+        };
+
+        // 'lights' are world space spheres of influence (xyz: centre, w: range). Cluster bounds are only rebuilt when the
+        // projection changes.
+        void build(const glm::mat4& view, const glm::mat4& projection, const glm::vec4* lights, uint32_t lightCount);
+
+        // CLUSTER_COUNT [offset, count] pairs, then the light indices. Offsets index this same array.
+        [[nodiscard]] inline const std::vector<uint32_t>& getClusterData() const { return _clusterData; }
+        [[nodiscard]] inline const DepthSlicing& getDepthSlicing() const { return _slicing; }
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+        // The cluster a view space position falls in, the way the fragment shader finds it. Must be inside the frustum.
+        [[nodiscard]] uint32_t findCluster(const glm::vec3& viewPosition) const;
+
+    private:
+        void buildClusterBounds(const glm::mat4& projection);
+        [[nodiscard]] uint32_t findSlice(float depth) const;
+
+        glm::mat4 _projection{ 0.f };
+        DepthSlicing _slicing{};
+        // View space bounds: GRID_Z + 1 slice depths, and per slice the x (y) extent of every column (row) of tiles
+        std::vector<float> _sliceDepths{};
+        std::vector<glm::vec2> _boundsX{};
+        std::vector<glm::vec2> _boundsY{};
+
+        // Reused every frame: (cluster << 32 | light) for every overlap, and the per cluster counts
+        std::vector<uint64_t> _assignments{};
+        std::vector<uint32_t> _counts{};
+        std::vector<uint32_t> _clusterData{};
+        Stats _stats{};
+    };
+}; //namespace Divide
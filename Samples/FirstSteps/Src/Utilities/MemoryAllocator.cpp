@@ -0,0 +1,199 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Divide {
+
+    MemoryAllocator::MemoryAllocator(DeviceMemoryBackend& backend,
+                                     std::vector<VkMemoryPropertyFlags> memoryTypeFlags,
+                                     const VkDeviceSize nonCoherentAtomSize,
+                                     const VkDeviceSize blockSize)
+        : _backend(backend)
+        , _memoryTypeFlags(std::move(memoryTypeFlags))
+        , _nonCoherentAtomSize(std::max(nonCoherentAtomSize, VkDeviceSize{ 1u }))
+        , _blockSize(BuddyAllocator::getBlockSize(blockSize, 0u))
+    {
+        _pools.resize(_memoryTypeFlags.size() * static_cast<size_t>(ResourceTiling::COUNT));
+    }
+
+    MemoryAllocator::~MemoryAllocator()
+    {
+        assert(_dedicatedAllocationCount == 0u && "Dedicated device memory leaked");
+        for (Pool& pool : _pools) {
+            for (auto& block : pool._blocks) {
+                if (block != nullptr) {
+                    assert(block->_allocator.empty() && "Device memory sub-allocation leaked");
+                    _backend.free(block->_memory);
+                }
+            }
+        }
+    }
+
+    bool MemoryAllocator::isHostVisible(const uint32_t memoryTypeIndex) const {
+        return (_memoryTypeFlags[memoryTypeIndex] & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0u;
+    }
+
+    MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, const uint32_t memoryTypeIndex, const ResourceTiling tiling) {
+        assert(memoryTypeIndex < _memoryTypeFlags.size() && "Invalid memory type index");
+
+        std::lock_guard<std::mutex> lock(_lock);
+
+        if (requirements.size > _blockSize / 2u) {
+            return allocateDedicated(requirements.size, memoryTypeIndex);
+        }
+
+        // Flushes and invalidates of non-coherent memory work on whole atoms, so no two allocations may share one
+        VkDeviceSize alignment = std::max(requirements.alignment, VkDeviceSize{ 1u });
+        const VkMemoryPropertyFlags flags = _memoryTypeFlags[memoryTypeIndex];
+        if ((flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0u && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) == 0u) {
+            alignment = std::max(alignment, _nonCoherentAtomSize);
+        }
+
+        const uint32_t poolIndex = memoryTypeIndex * static_cast<uint32_t>(ResourceTiling::COUNT) + static_cast<uint32_t>(tiling);
+        Pool& pool = _pools[poolIndex];
+
+        MemoryAllocation allocation{};
+        allocation.size = requirements.size;
+        allocation.reservedSize = BuddyAllocator::getBlockSize(requirements.size, alignment);
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.poolIndex = poolIndex;
+
+        const auto tryBlock = [&](const uint32_t blockIndex) {
+            Block& block = *pool._blocks[blockIndex];
+            const uint64_t offset = block._allocator.allocate(requirements.size, alignment);
+            if (offset == BuddyAllocator::INVALID_OFFSET) {
+                return false;
+            }
+
+            block._usedBytes += requirements.size;
+            allocation.memory = block._memory;
+            allocation.offset = offset;
+            allocation.mapped = block._mapped != nullptr ? block._mapped + offset : nullptr;
+            allocation.blockIndex = blockIndex;
+            return true;
+        };
+
+        uint32_t freeSlot = MemoryAllocation::DEDICATED_BLOCK;
+        for (uint32_t i = 0u; i < pool._blocks.size(); ++i) {
+            if (pool._blocks[i] == nullptr) {
+                freeSlot = std::min(freeSlot, i);
+            } else if (tryBlock(i)) {
+                return allocation;
+            }
+        }
+
+        auto block = std::make_unique<Block>(_blockSize);
+        block->_memory = _backend.allocate(memoryTypeIndex, _blockSize);
+        if (block->_memory == VK_NULL_HANDLE) {
+            // The heap may still have room for just this resource
+            return allocateDedicated(requirements.size, memoryTypeIndex);
+        }
+        if (isHostVisible(memoryTypeIndex)) {
+            block->_mapped = static_cast<std::byte*>(_backend.map(block->_memory));
+        }
+
+        if (freeSlot == MemoryAllocation::DEDICATED_BLOCK) {
+            freeSlot = static_cast<uint32_t>(pool._blocks.size());
+            pool._blocks.emplace_back();
+        }
+        pool._blocks[freeSlot] = std::move(block);
+
+        const bool allocated = tryBlock(freeSlot);
+        assert(allocated && "A fresh block must fit any non-dedicated allocation");
+        (void)allocated;
+        return allocation;
+    }
+
+    MemoryAllocation MemoryAllocator::allocateDedicated(const VkDeviceSize size, const uint32_t memoryTypeIndex) {
+        MemoryAllocation allocation{};
+        allocation.memory = _backend.allocate(memoryTypeIndex, size);
+        if (allocation.memory == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to allocate device memory!");
+        }
+
+        allocation.size = size;
+        allocation.reservedSize = size;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.blockIndex = MemoryAllocation::DEDICATED_BLOCK;
+        if (isHostVisible(memoryTypeIndex)) {
+            allocation.mapped = _backend.map(allocation.memory);
+        }
+
+        ++_dedicatedAllocationCount;
+        _dedicatedBytes += size;
+        return allocation;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation) {
+        if (!allocation.isValid()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_lock);
+
+        if (allocation.isDedicated()) {
+            _backend.free(allocation.memory);
+            --_dedicatedAllocationCount;
+            _dedicatedBytes -= allocation.size;
+        } else {
+            Pool& pool = _pools[allocation.poolIndex];
+            auto& block = pool._blocks[allocation.blockIndex];
+            assert(block != nullptr && block->_memory == allocation.memory && "Allocation does not belong to this allocator");
+
+            block->_allocator.free(allocation.offset, allocation.reservedSize);
+            block->_usedBytes -= allocation.size;
+
+            // Keep one empty block per pool around so a steady stream of transient (staging) allocations doesn't
+            // bounce between vkAllocateMemory and vkFreeMemory
+            if (block->_allocator.empty()) {
+                const bool hasOtherBlocks = std::any_of(pool._blocks.begin(), pool._blocks.end(), [&block](const auto& other) {
+                    return other != nullptr && other != block;
+                });
+                if (hasOtherBlocks) {
+                    _backend.free(block->_memory);
+                    block.reset();
+                }
+            }
+        }
+
+        allocation = {};
+    }
+
+    MemoryAllocator::Stats MemoryAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock(_lock);
+
+        Stats stats{};
+        stats.dedicatedAllocationCount = _dedicatedAllocationCount;
+        stats.allocationCount = _dedicatedAllocationCount;
+        stats.reservedBytes = _dedicatedBytes;
+        stats.usedBytes = _dedicatedBytes;
+
+        VkDeviceSize totalFreeBytes = 0u;
+        float weightedFragmentation = 0.f;
+        for (const Pool& pool : _pools) {
+            for (const auto& block : pool._blocks) {
+                if (block == nullptr) {
+                    continue;
+                }
+
+                const BuddyAllocator& allocator = block->_allocator;
+                const VkDeviceSize freeBytes = allocator.getCapacity() - allocator.getUsedSize();
+
+                stats.blockCount += 1u;
+                stats.allocationCount += allocator.getAllocationCount();
+                stats.reservedBytes += allocator.getCapacity();
+                stats.usedBytes += block->_usedBytes;
+                stats.roundingBytes += allocator.getUsedSize() - block->_usedBytes;
+                if (freeBytes > 0u) {
+                    weightedFragmentation += static_cast<float>(freeBytes - allocator.getLargestFreeBlock());
+                    totalFreeBytes += freeBytes;
+                }
+            }
+        }
+
+        stats.fragmentation = totalFreeBytes > 0u ? weightedFragmentation / totalFreeBytes : 0.f;
+        return stats;
+    }
+}; //namespace Divide
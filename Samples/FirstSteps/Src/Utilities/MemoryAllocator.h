@@ -0,0 +1,120 @@
+#pragma once
+
+#include "BuddyAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Divide {
+    // The only place MemoryAllocator talks to the driver. Device implements it with vkAllocateMemory/vkMapMemory;
+    // anything else (e.g. a plain heap) can stand in to exercise the allocator without a GPU.
+    class DeviceMemoryBackend {
+    public:
+        virtual ~DeviceMemoryBackend() = default;
+
+        // VK_NULL_HANDLE if the heap is exhausted
+        [[nodiscard]] virtual VkDeviceMemory allocate(uint32_t memoryTypeIndex, VkDeviceSize size) = 0;
+        virtual void free(VkDeviceMemory memory) = 0;
+        // Maps the whole allocation for its entire lifetime
+        [[nodiscard]] virtual void* map(VkDeviceMemory memory) = 0;
+    };
+
+    // Resources that may not share a page (bufferImageGranularity) are kept in separate blocks
+    enum class ResourceTiling : uint8_t {
+        LINEAR = 0, // buffers, linear images
+        OPTIMAL,    // optimally tiled images
+        COUNT
+    };
+
+    struct MemoryAllocation {
+        static constexpr uint32_t DEDICATED_BLOCK = ~0u;
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0u;
+        // Requested size and what was actually reserved for it
+        VkDeviceSize size = 0u;
+        VkDeviceSize reservedSize = 0u;
+        // Host pointer to 'offset' for host visible memory, null otherwise
+        void* mapped = nullptr;
+        uint32_t memoryTypeIndex = 0u;
+        uint32_t poolIndex = 0u;
+        uint32_t blockIndex = DEDICATED_BLOCK;
+
+        [[nodiscard]] inline bool isValid() const { return memory != VK_NULL_HANDLE; }
+        [[nodiscard]] inline bool isDedicated() const { return blockIndex == DEDICATED_BLOCK; }
+    };
+
+    // Sub-allocates resources out of large VkDeviceMemory blocks (one pool per memory type and tiling) using a buddy
+    // allocator per block, instead of one vkAllocateMemory per resource. Resources larger than half a block get
+    // their own allocation. Host visible blocks stay persistently mapped. Thread safe.
+    class MemoryAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = VkDeviceSize{ 64u } << 20;
+
+        struct Stats {
+            uint32_t blockCount = 0u;
+            uint32_t dedicatedAllocationCount = 0u;
+            uint32_t allocationCount = 0u;
+            // Memory obtained from the driver (blocks + dedicated)
+            VkDeviceSize reservedBytes = 0u;
+            // Sizes requested by resources
+            VkDeviceSize usedBytes = 0u;
+            // Lost to power of two rounding inside blocks
+            VkDeviceSize roundingBytes = 0u;
+            // 1 - largest free block / free bytes, averaged over blocks weighted by free space. 0 means no fragmentation.
+            float fragmentation = 0.f;
+        };
+
+        // 'memoryTypeFlags' holds the property flags of every memory type, indexed by memory type index
+        MemoryAllocator(DeviceMemoryBackend& backend,
+                        std::vector<VkMemoryPropertyFlags> memoryTypeFlags,
+                        VkDeviceSize nonCoherentAtomSize,
+                        VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+        // Releases every block. Anything still allocated at this point is a leak and asserts in debug builds.
+        ~MemoryAllocator();
+
+        MemoryAllocator(const MemoryAllocator&) = delete;
+        MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+        MemoryAllocator(MemoryAllocator&&) = delete;
+        MemoryAllocator& operator=(MemoryAllocator&&) = delete;
+
+        // Throws std::runtime_error when the heap is exhausted
+        [[nodiscard]] MemoryAllocation allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, ResourceTiling tiling);
+        // Resets 'allocation'. Freeing an invalid allocation is a no-op.
+        void free(MemoryAllocation& allocation);
+
+        [[nodiscard]] Stats getStats() const;
+
+    private:
+        struct Block {
+            explicit Block(const VkDeviceSize capacity) : _allocator(capacity) {}
+
+            VkDeviceMemory _memory = VK_NULL_HANDLE;
+            std::byte* _mapped = nullptr;
+            BuddyAllocator _allocator;
+            VkDeviceSize _usedBytes = 0u;
+        };
+
+        struct Pool {
+            // Freed blocks leave a null hole so the indices stored in live allocations stay valid
+            std::vector<std::unique_ptr<Block>> _blocks{};
+        };
+
+        [[nodiscard]] MemoryAllocation allocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+        [[nodiscard]] bool isHostVisible(uint32_t memoryTypeIndex) const;
+
+        DeviceMemoryBackend& _backend;
+        const std::vector<VkMemoryPropertyFlags> _memoryTypeFlags;
+        const VkDeviceSize _nonCoherentAtomSize;
+        const VkDeviceSize _blockSize;
+
+        mutable std::mutex _lock{};
+        // Indexed by memoryTypeIndex * ResourceTiling::COUNT + tiling
+        std::vector<Pool> _pools{};
+        uint32_t _dedicatedAllocationCount = 0u;
+        VkDeviceSize _dedicatedBytes = 0u;
+    };
+}; //namespace Divide
@@ -0,0 +1,326 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace Divide {
+namespace MeshOptimizer {
+
+    namespace {
+        constexpr uint32_t INVALID_INDEX = ~0u;
+
+        // Forsyth scoring parameters, as published
+        constexpr uint32_t FORSYTH_CACHE_SIZE = 32u;
+        constexpr uint32_t FORSYTH_MAX_VALENCE = 32u;
+        constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+        constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.f;
+        constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+        struct ForsythScores {
+            ForsythScores() {
+                for (uint32_t i = 0u; i < FORSYTH_CACHE_SIZE; ++i) {
+                    // The last triangle's vertices get a fixed score so we don't just reuse the most recent edge forever
+                    _cache[i] = i < 3u
+                                  ? FORSYTH_LAST_TRIANGLE_SCORE
+                                  : std::pow(1.f - static_cast<float>(i - 3u) / (FORSYTH_CACHE_SIZE - 3u), FORSYTH_CACHE_DECAY_POWER);
+                }
+                _valence[0] = 0.f;
+                for (uint32_t i = 1u; i < FORSYTH_MAX_VALENCE; ++i) {
+                    _valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+                }
+            }
+
+            [[nodiscard]] float get(const int32_t cachePosition, const uint32_t remainingTriangles) const {
+                if (remainingTriangles == 0u) {
+                    return -1.f;
+                }
+
+                const float cacheScore = cachePosition >= 0 ? _cache[cachePosition] : 0.f;
+                return cacheScore + _valence[std::min(remainingTriangles, FORSYTH_MAX_VALENCE - 1u)];
+            }
+
+            std::array<float, FORSYTH_CACHE_SIZE> _cache{};
+            std::array<float, FORSYTH_MAX_VALENCE> _valence{};
+        };
+
+        // FIFO cache simulation: a vertex is resident if it was transformed less than 'cacheSize' misses ago
+        struct FIFOCache {
+            FIFOCache(const size_t vertexCount, const uint32_t cacheSize)
+                : _timestamps(vertexCount, 0u)
+                , _cacheSize(cacheSize)
+                , _timestamp(cacheSize + 1u)
+            {
+            }
+
+            [[nodiscard]] uint32_t access(const uint32_t vertex) {
+                if (_timestamp - _timestamps[vertex] > _cacheSize) {
+                    _timestamps[vertex] = _timestamp++;
+                    return 1u;
+                }
+                return 0u;
+            }
+
+            void flush() {
+                _timestamp += _cacheSize + 1u;
+            }
+
+            std::vector<uint32_t> _timestamps{};
+            uint32_t _cacheSize = 0u;
+            uint32_t _timestamp = 0u;
+        };
+    };
+
+    VertexCacheStats analyzeVertexCache(const uint32_t* indices, const size_t indexCount, const size_t vertexCount, const uint32_t cacheSize) {
+        VertexCacheStats ret{};
+        if (indexCount < 3u || vertexCount == 0u) {
+            return ret;
+        }
+
+        FIFOCache cache{ vertexCount, cacheSize };
+        std::vector<bool> referenced(vertexCount, false);
+        size_t referencedCount = 0u, misses = 0u;
+        for (size_t i = 0u; i < indexCount; ++i) {
+            const uint32_t vertex = indices[i];
+            assert(vertex < vertexCount && "Index out of range");
+
+            misses += cache.access(vertex);
+            if (!referenced[vertex]) {
+                referenced[vertex] = true;
+                ++referencedCount;
+            }
+        }
+
+        ret.acmr = static_cast<float>(misses) / (indexCount / 3u);
+        ret.atvr = static_cast<float>(misses) / referencedCount;
+        return ret;
+    }
+
+    void optimizeVertexCache(uint32_t* indices, const size_t indexCount, const size_t vertexCount) {
+        assert(indexCount % 3u == 0u && "Expected a triangle list");
+
+        const size_t triangleCount = indexCount / 3u;
+        if (triangleCount == 0u) {
+            return;
+        }
+
+        static const ForsythScores scores{};
+
+        // Vertex -> triangle adjacency. The live triangles of a vertex are kept at the front of its list.
+        std::vector<uint32_t> remainingTriangles(vertexCount, 0u);
+        for (size_t i = 0u; i < indexCount; ++i) {
+            ++remainingTriangles[indices[i]];
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1u, 0u);
+        for (size_t i = 0u; i < vertexCount; ++i) {
+            adjacencyOffsets[i + 1u] = adjacencyOffsets[i] + remainingTriangles[i];
+        }
+
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0u; i < indexCount; ++i) {
+                adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+            }
+        }
+
+        std::vector<int32_t> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t i = 0u; i < vertexCount; ++i) {
+            vertexScores[i] = scores.get(-1, remainingTriangles[i]);
+        }
+
+        std::vector<float> triangleScores(triangleCount);
+        for (size_t i = 0u; i < triangleCount; ++i) {
+            triangleScores[i] = vertexScores[indices[i * 3 + 0]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> output{};
+        output.reserve(indexCount);
+
+        std::array<uint32_t, FORSYTH_CACHE_SIZE + 3u> cache{};
+        std::array<uint32_t, FORSYTH_CACHE_SIZE + 3u> newCache{};
+        size_t cacheCount = 0u;
+
+        size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+        size_t inputCursor = 0u;
+
+        for (size_t emittedCount = 0u; emittedCount < triangleCount; ++emittedCount) {
+            // Nothing left in the cache touches a live triangle: restart from the next one in input order
+            if (bestTriangle == INVALID_INDEX) {
+                while (emitted[inputCursor]) {
+                    ++inputCursor;
+                }
+                bestTriangle = inputCursor;
+            }
+
+            const uint32_t* triangle = &indices[bestTriangle * 3u];
+            emitted[bestTriangle] = true;
+            output.insert(output.end(), triangle, triangle + 3);
+
+            // Most recently used first, then the previous cache contents minus the triangle's own vertices
+            size_t newCacheCount = 0u;
+            for (size_t i = 0u; i < 3u; ++i) {
+                newCache[newCacheCount++] = triangle[i];
+            }
+            for (size_t i = 0u; i < cacheCount; ++i) {
+                const uint32_t vertex = cache[i];
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                    newCache[newCacheCount++] = vertex;
+                }
+            }
+
+            for (size_t i = 0u; i < 3u; ++i) {
+                const uint32_t vertex = triangle[i];
+                uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+                const uint32_t liveCount = remainingTriangles[vertex];
+                for (uint32_t j = 0u; j < liveCount; ++j) {
+                    if (triangles[j] == bestTriangle) {
+                        std::swap(triangles[j], triangles[liveCount - 1u]);
+                        --remainingTriangles[vertex];
+                        break;
+                    }
+                }
+            }
+
+            // Vertices pushed past the end of the cache get evicted but still need their scores refreshed
+            for (size_t i = 0u; i < newCacheCount; ++i) {
+                const uint32_t vertex = newCache[i];
+                cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+                vertexScores[vertex] = scores.get(cachePositions[vertex], remainingTriangles[vertex]);
+            }
+
+            bestTriangle = INVALID_INDEX;
+            float bestScore = -1.f;
+            for (size_t i = 0u; i < newCacheCount; ++i) {
+                const uint32_t vertex = newCache[i];
+                const uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+                for (uint32_t j = 0u; j < remainingTriangles[vertex]; ++j) {
+                    const uint32_t candidate = triangles[j];
+                    const uint32_t* candidateIndices = &indices[candidate * 3u];
+                    const float score = vertexScores[candidateIndices[0]] + vertexScores[candidateIndices[1]] + vertexScores[candidateIndices[2]];
+                    triangleScores[candidate] = score;
+
+                    if (i < FORSYTH_CACHE_SIZE && score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = candidate;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCacheCount, size_t{ FORSYTH_CACHE_SIZE });
+            std::copy_n(newCache.begin(), cacheCount, cache.begin());
+        }
+
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    void optimizeOverdraw(uint32_t* indices, const size_t indexCount, const Model::Vertex* vertices, const size_t vertexCount, const float threshold) {
+        assert(indexCount % 3u == 0u && "Expected a triangle list");
+
+        const size_t triangleCount = indexCount / 3u;
+        if (triangleCount == 0u) {
+            return;
+        }
+
+        // Each cluster starts with a cold cache, so once its running ACMR drops below the budget we can cut
+        // there and still be free to move it anywhere in the draw order.
+        const float targetACMR = analyzeVertexCache(indices, indexCount, vertexCount).acmr * threshold;
+
+        std::vector<uint32_t> clusterOffsets{ 0u };
+        {
+            FIFOCache cache{ vertexCount, ANALYZE_CACHE_SIZE };
+            size_t clusterMisses = 0u;
+            for (size_t i = 0u; i < triangleCount; ++i) {
+                for (size_t j = 0u; j < 3u; ++j) {
+                    clusterMisses += cache.access(indices[i * 3u + j]);
+                }
+
+                const size_t clusterTriangles = i + 1u - clusterOffsets.back();
+                if (i + 1u < triangleCount && clusterMisses <= targetACMR * clusterTriangles) {
+                    clusterOffsets.push_back(static_cast<uint32_t>(i + 1u));
+                    clusterMisses = 0u;
+                    cache.flush();
+                }
+            }
+        }
+        const size_t clusterCount = clusterOffsets.size();
+        clusterOffsets.push_back(static_cast<uint32_t>(triangleCount));
+
+        const auto getPosition = [&](const size_t index) -> const glm::vec3& {
+            return vertices[indices[index]].position;
+        };
+
+        // Area weighted centroids. The unnormalised cross product is twice the area times the face normal.
+        glm::vec3 meshCentroid{ 0.f };
+        float meshArea = 0.f;
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{ 0.f });
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{ 0.f });
+        for (size_t c = 0u; c < clusterCount; ++c) {
+            float clusterArea = 0.f;
+            for (size_t i = clusterOffsets[c]; i < clusterOffsets[c + 1]; ++i) {
+                const glm::vec3& p0 = getPosition(i * 3u + 0u);
+                const glm::vec3& p1 = getPosition(i * 3u + 1u);
+                const glm::vec3& p2 = getPosition(i * 3u + 2u);
+
+                const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                const float area = glm::length(normal);
+                const glm::vec3 centroid = (p0 + p1 + p2) * (area / 3.f);
+
+                clusterCentroids[c] += centroid;
+                clusterNormals[c] += normal;
+                clusterArea += area;
+                meshCentroid += centroid;
+            }
+            clusterCentroids[c] = clusterArea > 0.f ? clusterCentroids[c] / clusterArea : getPosition(clusterOffsets[c] * 3u);
+            meshArea += clusterArea;
+        }
+        meshCentroid = meshArea > 0.f ? meshCentroid / meshArea : glm::vec3{ 0.f };
+
+        // Clusters that face away from the mesh centre tend to occlude the ones that face towards it
+        std::vector<float> clusterSortKeys(clusterCount, 0.f);
+        for (size_t c = 0u; c < clusterCount; ++c) {
+            const float normalLength = glm::length(clusterNormals[c]);
+            if (normalLength > 0.f) {
+                clusterSortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength);
+            }
+        }
+
+        std::vector<uint32_t> clusterOrder(clusterCount);
+        for (size_t c = 0u; c < clusterCount; ++c) {
+            clusterOrder[c] = static_cast<uint32_t>(c);
+        }
+        std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](const uint32_t lhs, const uint32_t rhs) {
+            return clusterSortKeys[lhs] > clusterSortKeys[rhs];
+        });
+
+        std::vector<uint32_t> output{};
+        output.reserve(indexCount);
+        for (const uint32_t c : clusterOrder) {
+            output.insert(output.end(), indices + clusterOffsets[c] * 3u, indices + clusterOffsets[c + 1] * 3u);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    void optimizeVertexFetch(std::vector<Model::Vertex>& vertices, uint32_t* indices, const size_t indexCount) {
+        std::vector<uint32_t> remap(vertices.size(), INVALID_INDEX);
+        std::vector<Model::Vertex> output{};
+        output.reserve(vertices.size());
+
+        for (size_t i = 0u; i < indexCount; ++i) {
+            uint32_t& index = indices[i];
+            if (remap[index] == INVALID_INDEX) {
+                remap[index] = static_cast<uint32_t>(output.size());
+                output.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices = std::move(output);
+    }
+}; //namespace MeshOptimizer
+}; //namespace Divide
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Model.h"
+
+#include <vector>
+
+namespace Divide {
+    // CPU-only index/vertex reordering passes for triangle lists. None of them change the mesh topology:
+    // the same set of triangles (with the same winding) is referenced before and after.
+    namespace MeshOptimizer {
+        // Size of the FIFO cache used when measuring. Matches the smallest post-transform caches we care about.
+        constexpr uint32_t ANALYZE_CACHE_SIZE = 16u;
+        // Default overdraw pass budget: clusters may cost at most 5% extra cache misses
+        constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+        struct VertexCacheStats {
+            // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal, 3 is worst)
+            float acmr = 0.f;
+            // Average transform to vertex ratio: transformed vertices per referenced vertex (1 is ideal)
+            float atvr = 0.f;
+        };
+
+        [[nodiscard]] VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = ANALYZE_CACHE_SIZE);
+
+        // Forsyth's linear-speed vertex cache optimisation
+        void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+        // Splits a cache-optimised index list into clusters whose ACMR stays within 'threshold' of the whole mesh,
+        // then orders the clusters so that outward facing ones (likely occluders) are drawn first.
+        void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Model::Vertex* vertices, size_t vertexCount, float threshold = DEFAULT_OVERDRAW_THRESHOLD);
+
+        // Reorders vertices in order of first use by the index list and drops unreferenced ones. Indices are remapped in place.
+        void optimizeVertexFetch(std::vector<Model::Vertex>& vertices, uint32_t* indices, size_t indexCount);
+    }; //namespace MeshOptimizer
+}; //namespace Divide
@@ -0,0 +1,300 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace Divide {
+namespace MeshSimplifier {
+
+    namespace {
+        constexpr uint32_t INVALID_INDEX = ~0u;
+
+        // Symmetric 4x4 plane quadric, area weighted. error() is the weighted mean squared distance to the planes.
+        struct Quadric {
+            double _a2 = 0.0, _ab = 0.0, _ac = 0.0, _ad = 0.0;
+            double _b2 = 0.0, _bc = 0.0, _bd = 0.0;
+            double _c2 = 0.0, _cd = 0.0;
+            double _d2 = 0.0;
+            double _weight = 0.0;
+
+            [[nodiscard]] static Quadric fromPlane(const glm::vec3& normal, const double distance, const double weight) {
+                const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+                Quadric ret{};
+                ret._a2 = a * a * weight; ret._ab = a * b * weight; ret._ac = a * c * weight; ret._ad = a * d * weight;
+                ret._b2 = b * b * weight; ret._bc = b * c * weight; ret._bd = b * d * weight;
+                ret._c2 = c * c * weight; ret._cd = c * d * weight;
+                ret._d2 = d * d * weight;
+                ret._weight = weight;
+                return ret;
+            }
+
+            void add(const Quadric& other) {
+                _a2 += other._a2; _ab += other._ab; _ac += other._ac; _ad += other._ad;
+                _b2 += other._b2; _bc += other._bc; _bd += other._bd;
+                _c2 += other._c2; _cd += other._cd;
+                _d2 += other._d2;
+                _weight += other._weight;
+            }
+
+            [[nodiscard]] double error(const glm::vec3& position) const {
+                if (_weight <= 0.0) {
+                    return 0.0;
+                }
+
+                const double x = position.x, y = position.y, z = position.z;
+                const double ret = x * (_a2 * x + _ab * y + _ac * z + _ad) +
+                                   y * (_ab * x + _b2 * y + _bc * z + _bd) +
+                                   z * (_ac * x + _bc * y + _c2 * z + _cd) +
+                                   (_ad * x + _bd * y + _cd * z + _d2);
+                return std::abs(ret) / _weight;
+            }
+        };
+
+        struct Collapse {
+            uint32_t _source = INVALID_INDEX;
+            uint32_t _target = INVALID_INDEX;
+            double _cost = 0.0;
+        };
+
+        // Compressed vertex -> neighbour lists
+        struct Adjacency {
+            std::vector<uint32_t> _offsets{};
+            std::vector<uint32_t> _data{};
+
+            [[nodiscard]] inline const uint32_t* begin(const uint32_t vertex) const { return _data.data() + _offsets[vertex]; }
+            [[nodiscard]] inline const uint32_t* end(const uint32_t vertex) const { return _data.data() + _offsets[vertex + 1]; }
+        };
+
+        // Groups vertices that share a position (attribute seams) so that they collapse as one
+        uint32_t weldPositions(const Model::Vertex* vertices, const size_t vertexCount, std::vector<uint32_t>& positionIds, std::vector<glm::vec3>& positions) {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0u);
+
+            const auto less = [vertices](const uint32_t lhs, const uint32_t rhs) {
+                const glm::vec3& a = vertices[lhs].position;
+                const glm::vec3& b = vertices[rhs].position;
+                return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+            };
+            std::sort(order.begin(), order.end(), less);
+
+            positionIds.resize(vertexCount);
+            positions.clear();
+            for (size_t i = 0u; i < vertexCount; ++i) {
+                if (i == 0u || less(order[i - 1u], order[i])) {
+                    positions.push_back(vertices[order[i]].position);
+                }
+                positionIds[order[i]] = static_cast<uint32_t>(positions.size() - 1u);
+            }
+
+            return static_cast<uint32_t>(positions.size());
+        }
+
+        Adjacency buildAdjacency(const uint32_t* keys, const size_t keyCount, const size_t bucketCount, const uint32_t valueDivisor) {
+            Adjacency ret{};
+            ret._offsets.assign(bucketCount + 1u, 0u);
+            for (size_t i = 0u; i < keyCount; ++i) {
+                ++ret._offsets[keys[i] + 1u];
+            }
+            std::partial_sum(ret._offsets.begin(), ret._offsets.end(), ret._offsets.begin());
+
+            ret._data.resize(keyCount);
+            std::vector<uint32_t> cursor(ret._offsets.begin(), ret._offsets.end() - 1);
+            for (size_t i = 0u; i < keyCount; ++i) {
+                ret._data[cursor[keys[i]]++] = static_cast<uint32_t>(i / valueDivisor);
+            }
+            return ret;
+        }
+
+        glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2) {
+            return glm::cross(p1 - p0, p2 - p0);
+        }
+    };
+
+    float simplify(const Model::Vertex* vertices,
+                   const size_t vertexCount,
+                   const uint32_t* indices,
+                   const size_t indexCount,
+                   const size_t targetIndexCount,
+                   const float maxError,
+                   std::vector<uint32_t>& output)
+    {
+        assert(indexCount % 3u == 0u && "Expected a triangle list");
+
+        output.assign(indices, indices + indexCount);
+        if (indexCount <= targetIndexCount || vertexCount == 0u) {
+            return 0.f;
+        }
+
+        std::vector<uint32_t> positionIds{};
+        std::vector<glm::vec3> positions{};
+        const uint32_t positionCount = weldPositions(vertices, vertexCount, positionIds, positions);
+        const Adjacency positionVertices = buildAdjacency(positionIds.data(), vertexCount, positionCount, 1u);
+
+        std::vector<Quadric> quadrics(positionCount);
+        for (size_t i = 0u; i < indexCount; i += 3u) {
+            const uint32_t p0 = positionIds[indices[i + 0]], p1 = positionIds[indices[i + 1]], p2 = positionIds[indices[i + 2]];
+            glm::vec3 normal = triangleNormal(positions[p0], positions[p1], positions[p2]);
+            const float doubleArea = glm::length(normal);
+            if (doubleArea <= 0.f) {
+                continue;
+            }
+
+            normal /= doubleArea;
+            const Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, positions[p0]), doubleArea * 0.5);
+            quadrics[p0].add(quadric);
+            quadrics[p1].add(quadric);
+            quadrics[p2].add(quadric);
+        }
+
+        // Anything on an open or non-manifold edge stays put
+        std::vector<bool> locked(positionCount, false);
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUseCount{};
+            edgeUseCount.reserve(indexCount);
+            for (size_t i = 0u; i < indexCount; i += 3u) {
+                for (size_t j = 0u; j < 3u; ++j) {
+                    const uint32_t a = positionIds[indices[i + j]];
+                    const uint32_t b = positionIds[indices[i + (j + 1u) % 3u]];
+                    ++edgeUseCount[(uint64_t{ std::min(a, b) } << 32) | std::max(a, b)];
+                }
+            }
+            for (const auto& [edge, useCount] : edgeUseCount) {
+                if (useCount != 2u) {
+                    locked[edge >> 32] = true;
+                    locked[edge & 0xFFFFFFFFu] = true;
+                }
+            }
+        }
+
+        // When a position collapses, each vertex on it is replaced by the target vertex with the closest normal
+        const auto pickTargetVertex = [&](const uint32_t targetPosition, const uint32_t vertex) {
+            uint32_t ret = *positionVertices.begin(targetPosition);
+            float bestMatch = -2.f;
+            for (const uint32_t* it = positionVertices.begin(targetPosition); it != positionVertices.end(targetPosition); ++it) {
+                const float match = glm::dot(vertices[*it].normal, vertices[vertex].normal);
+                if (match > bestMatch) {
+                    bestMatch = match;
+                    ret = *it;
+                }
+            }
+            return ret;
+        };
+
+        const double maxCost = double{ maxError } * maxError;
+        const size_t targetTriangleCount = targetIndexCount / 3u;
+
+        std::vector<uint32_t> collapseTargets(positionCount, INVALID_INDEX);
+        std::vector<uint32_t> cornerPositions{};
+        std::vector<Collapse> candidates{};
+        double resultCost = 0.0;
+
+        // Each pass picks the cheapest independent collapses (no two touching the same triangles), applies them all
+        // and rebuilds adjacency. That keeps every cost and flip test exact without a priority queue with updates.
+        while (output.size() / 3u > targetTriangleCount) {
+            cornerPositions.resize(output.size());
+            for (size_t i = 0u; i < output.size(); ++i) {
+                cornerPositions[i] = positionIds[output[i]];
+            }
+            const Adjacency positionTriangles = buildAdjacency(cornerPositions.data(), cornerPositions.size(), positionCount, 3u);
+
+            candidates.clear();
+            for (size_t i = 0u; i < cornerPositions.size(); i += 3u) {
+                for (size_t j = 0u; j < 3u; ++j) {
+                    const uint32_t a = cornerPositions[i + j];
+                    const uint32_t b = cornerPositions[i + (j + 1u) % 3u];
+                    Quadric quadric = quadrics[a];
+                    quadric.add(quadrics[b]);
+                    if (!locked[a]) {
+                        candidates.push_back({ a, b, quadric.error(positions[b]) });
+                    }
+                    if (!locked[b]) {
+                        candidates.push_back({ b, a, quadric.error(positions[a]) });
+                    }
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs) {
+                return lhs._cost < rhs._cost;
+            });
+
+            std::vector<bool> touched(positionCount, false);
+            size_t triangleCount = output.size() / 3u;
+            size_t collapseCount = 0u;
+            for (const Collapse& collapse : candidates) {
+                if (collapse._cost > maxCost || triangleCount <= targetTriangleCount) {
+                    break;
+                }
+                if (touched[collapse._source] || touched[collapse._target]) {
+                    continue;
+                }
+
+                // Reject collapses that would flip a surviving triangle around the source
+                bool flips = false;
+                size_t removedTriangles = 0u;
+                for (const uint32_t* it = positionTriangles.begin(collapse._source); it != positionTriangles.end(collapse._source) && !flips; ++it) {
+                    const uint32_t* triangle = &cornerPositions[*it * 3u];
+                    if (triangle[0] == collapse._target || triangle[1] == collapse._target || triangle[2] == collapse._target) {
+                        ++removedTriangles;
+                        continue;
+                    }
+
+                    glm::vec3 before[3], after[3];
+                    for (size_t j = 0u; j < 3u; ++j) {
+                        before[j] = positions[triangle[j]];
+                        after[j] = triangle[j] == collapse._source ? positions[collapse._target] : before[j];
+                    }
+                    flips = glm::dot(triangleNormal(before[0], before[1], before[2]), triangleNormal(after[0], after[1], after[2])) <= 0.f;
+                }
+                if (flips) {
+                    continue;
+                }
+
+                collapseTargets[collapse._source] = collapse._target;
+                quadrics[collapse._target].add(quadrics[collapse._source]);
+                resultCost = std::max(resultCost, collapse._cost);
+                triangleCount -= removedTriangles;
+                ++collapseCount;
+
+                touched[collapse._target] = true;
+                for (const uint32_t* it = positionTriangles.begin(collapse._source); it != positionTriangles.end(collapse._source); ++it) {
+                    for (size_t j = 0u; j < 3u; ++j) {
+                        touched[cornerPositions[*it * 3u + j]] = true;
+                    }
+                }
+            }
+
+            if (collapseCount == 0u) {
+                break;
+            }
+
+            size_t writeIndex = 0u;
+            for (size_t i = 0u; i < output.size(); i += 3u) {
+                uint32_t triangle[3];
+                uint32_t trianglePositions[3];
+                for (size_t j = 0u; j < 3u; ++j) {
+                    triangle[j] = output[i + j];
+                    trianglePositions[j] = cornerPositions[i + j];
+                    if (collapseTargets[trianglePositions[j]] != INVALID_INDEX) {
+                        trianglePositions[j] = collapseTargets[trianglePositions[j]];
+                        triangle[j] = pickTargetVertex(trianglePositions[j], triangle[j]);
+                    }
+                }
+
+                if (trianglePositions[0] != trianglePositions[1] && trianglePositions[1] != trianglePositions[2] && trianglePositions[0] != trianglePositions[2]) {
+                    output[writeIndex++] = triangle[0];
+                    output[writeIndex++] = triangle[1];
+                    output[writeIndex++] = triangle[2];
+                }
+            }
+            output.resize(writeIndex);
+
+            std::fill(collapseTargets.begin(), collapseTargets.end(), INVALID_INDEX);
+        }
+
+        return static_cast<float>(std::sqrt(resultCost));
+    }
+}; //namespace MeshSimplifier
+}; //namespace Divide
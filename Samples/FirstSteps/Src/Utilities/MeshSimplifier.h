@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Model.h"
+
+#include <vector>
+
+namespace Divide {
+    namespace MeshSimplifier {
+        // Quadric error edge collapse (Garland & Heckbert) over a triangle list. Vertices are never moved or created:
+        // a collapse snaps one position onto a neighbouring one, so the result indexes the same vertex array.
+        // Vertices sharing a position are collapsed together and border vertices are locked to keep silhouettes.
+        // Stops once 'targetIndexCount' is reached or the next collapse would exceed 'maxError'.
+        // Returns the resulting error as a distance in model space units.
+        [[nodiscard]] float simplify(const Model::Vertex* vertices,
+                                     size_t vertexCount,
+                                     const uint32_t* indices,
+                                     size_t indexCount,
+                                     size_t targetIndexCount,
+                                     float maxError,
+                                     std::vector<uint32_t>& output);
+    }; //namespace MeshSimplifier
+}; //namespace Divide
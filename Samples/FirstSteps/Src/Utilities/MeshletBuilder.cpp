@@ -0,0 +1,261 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace Divide {
+namespace MeshletBuilder {
+
+    namespace {
+        constexpr uint32_t INVALID_INDEX = ~0u;
+        // How much a triangle facing away from the cluster's average normal costs compared to one extra vertex
+        constexpr float CONE_WEIGHT = 0.5f;
+        // Cones wider than this (cos of the widest normal deviation) can never cull anything useful
+        constexpr float MIN_CONE_DOT = 0.1f;
+
+        // Flat shaded meshes share no vertex indices between faces, so clusters are grown over shared positions
+        std::vector<uint32_t> getPositionIds(const Model::Vertex* vertices, const size_t vertexCount) {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0u);
+
+            const auto less = [vertices](const uint32_t lhs, const uint32_t rhs) {
+                const glm::vec3& a = vertices[lhs].position;
+                const glm::vec3& b = vertices[rhs].position;
+                return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+            };
+            std::sort(order.begin(), order.end(), less);
+
+            std::vector<uint32_t> ret(vertexCount);
+            uint32_t positionId = 0u;
+            for (size_t i = 0u; i < vertexCount; ++i) {
+                if (i > 0u && less(order[i - 1u], order[i])) {
+                    ++positionId;
+                }
+                ret[order[i]] = positionId;
+            }
+            return ret;
+        }
+
+        glm::vec3 getTriangleNormal(const Model::Vertex* vertices, const uint32_t* triangle) {
+            const glm::vec3& p0 = vertices[triangle[0]].position;
+            const glm::vec3 normal = glm::cross(vertices[triangle[1]].position - p0, vertices[triangle[2]].position - p0);
+            const float length = glm::length(normal);
+            return length > 0.f ? normal / length : glm::vec3{ 0.f };
+        }
+    };
+
+    void build(const Model::Vertex* vertices,
+               const size_t vertexCount,
+               uint32_t* indices,
+               const uint32_t indexOffset,
+               const uint32_t indexCount,
+               const uint32_t lod,
+               std::vector<Model::Meshlet>& meshlets)
+    {
+        assert(indexCount % 3u == 0u && "Expected a triangle list");
+
+        const uint32_t* source = indices + indexOffset;
+        const size_t triangleCount = indexCount / 3u;
+        if (triangleCount == 0u) {
+            return;
+        }
+
+        const std::vector<uint32_t> positionIds = getPositionIds(vertices, vertexCount);
+        const size_t positionCount = positionIds.empty() ? 0u : *std::max_element(positionIds.begin(), positionIds.end()) + 1u;
+
+        // Position -> triangle adjacency
+        std::vector<uint32_t> adjacencyOffsets(positionCount + 1u, 0u);
+        for (size_t i = 0u; i < indexCount; ++i) {
+            ++adjacencyOffsets[positionIds[source[i]] + 1u];
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+        std::vector<uint32_t> adjacency(indexCount);
+        {
+            std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0u; i < indexCount; ++i) {
+                adjacency[cursor[positionIds[source[i]]]++] = static_cast<uint32_t>(i / 3u);
+            }
+        }
+
+        std::vector<glm::vec3> triangleNormals(triangleCount);
+        for (size_t i = 0u; i < triangleCount; ++i) {
+            triangleNormals[i] = getTriangleNormal(vertices, &source[i * 3u]);
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> vertexMeshlet(vertexCount, INVALID_INDEX);
+        std::vector<uint32_t> candidateMeshlet(triangleCount, INVALID_INDEX);
+        std::vector<uint32_t> candidates{};
+        std::vector<uint32_t> output{};
+        output.reserve(indexCount);
+
+        const auto countNewVertices = [&](const uint32_t triangle, const uint32_t meshletId) {
+            uint32_t ret = 0u;
+            for (size_t j = 0u; j < 3u; ++j) {
+                const uint32_t vertex = source[triangle * 3u + j];
+                // A triangle can reference the same vertex twice; only count it once
+                if (vertexMeshlet[vertex] != meshletId && (j == 0u || source[triangle * 3u] != vertex) && (j < 2u || source[triangle * 3u + 1u] != vertex)) {
+                    ++ret;
+                }
+            }
+            return ret;
+        };
+
+        const size_t firstMeshlet = meshlets.size();
+        size_t emittedCount = 0u;
+        size_t seedCursor = 0u;
+        for (uint32_t meshletId = 0u; emittedCount < triangleCount; ++meshletId) {
+            Model::Meshlet meshlet{};
+            meshlet.indexOffset = indexOffset + static_cast<uint32_t>(output.size());
+            meshlet.lod = lod;
+
+            glm::vec3 normalSum{ 0.f };
+            uint32_t meshletVertexCount = 0u;
+            uint32_t meshletTriangleCount = 0u;
+            candidates.clear();
+
+            while (emitted[seedCursor]) {
+                ++seedCursor;
+            }
+
+            uint32_t next = static_cast<uint32_t>(seedCursor);
+            while (next != INVALID_INDEX) {
+                emitted[next] = true;
+                ++emittedCount;
+                ++meshletTriangleCount;
+                normalSum += triangleNormals[next];
+
+                for (size_t j = 0u; j < 3u; ++j) {
+                    const uint32_t vertex = source[next * 3u + j];
+                    output.push_back(vertex);
+                    if (vertexMeshlet[vertex] != meshletId) {
+                        vertexMeshlet[vertex] = meshletId;
+                        ++meshletVertexCount;
+                    }
+
+                    const uint32_t position = positionIds[vertex];
+                    for (uint32_t k = adjacencyOffsets[position]; k < adjacencyOffsets[position + 1u]; ++k) {
+                        const uint32_t neighbour = adjacency[k];
+                        if (!emitted[neighbour] && candidateMeshlet[neighbour] != meshletId) {
+                            candidateMeshlet[neighbour] = meshletId;
+                            candidates.push_back(neighbour);
+                        }
+                    }
+                }
+
+                if (meshletTriangleCount == Model::MAX_MESHLET_TRIANGLES) {
+                    break;
+                }
+
+                const float normalLength = glm::length(normalSum);
+                const glm::vec3 axis = normalLength > 0.f ? normalSum / normalLength : glm::vec3{ 0.f };
+
+                next = INVALID_INDEX;
+                float bestScore = std::numeric_limits<float>::max();
+                for (size_t i = 0u; i < candidates.size();) {
+                    const uint32_t candidate = candidates[i];
+                    if (emitted[candidate]) {
+                        candidates[i] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+
+                    const uint32_t newVertices = countNewVertices(candidate, meshletId);
+                    if (meshletVertexCount + newVertices <= Model::MAX_MESHLET_VERTICES) {
+                        const float score = newVertices + CONE_WEIGHT * (1.f - glm::dot(triangleNormals[candidate], axis));
+                        if (score < bestScore) {
+                            bestScore = score;
+                            next = candidate;
+                        }
+                    }
+                    ++i;
+                }
+
+                // Nothing connected fits: the next triangle in (cache optimised, so mostly local) order can still fill the cluster
+                if (next == INVALID_INDEX) {
+                    size_t fallback = seedCursor;
+                    while (fallback < triangleCount && emitted[fallback]) {
+                        ++fallback;
+                    }
+                    if (fallback < triangleCount && meshletVertexCount + countNewVertices(static_cast<uint32_t>(fallback), meshletId) <= Model::MAX_MESHLET_VERTICES) {
+                        next = static_cast<uint32_t>(fallback);
+                    }
+                }
+            }
+
+            meshlet.indexCount = meshletTriangleCount * 3u;
+            meshlet.vertexCount = meshletVertexCount;
+            meshlets.push_back(meshlet);
+        }
+
+        std::copy(output.begin(), output.end(), indices + indexOffset);
+
+        for (size_t i = firstMeshlet; i < meshlets.size(); ++i) {
+            computeBounds(vertices, indices, meshlets[i]);
+        }
+    }
+
+    void computeBounds(const Model::Vertex* vertices, const uint32_t* indices, Model::Meshlet& meshlet) {
+        const uint32_t* meshletIndices = indices + meshlet.indexOffset;
+
+        glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+        glm::vec3 boundsMax{ std::numeric_limits<float>::lowest() };
+        for (uint32_t i = 0u; i < meshlet.indexCount; ++i) {
+            boundsMin = glm::min(boundsMin, vertices[meshletIndices[i]].position);
+            boundsMax = glm::max(boundsMax, vertices[meshletIndices[i]].position);
+        }
+
+        const glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+        float radius = 0.f;
+        for (uint32_t i = 0u; i < meshlet.indexCount; ++i) {
+            radius = std::max(radius, glm::length(vertices[meshletIndices[i]].position - centre));
+        }
+        meshlet.boundingSphere = glm::vec4(centre, radius);
+
+        glm::vec3 normalSum{ 0.f };
+        for (uint32_t i = 0u; i < meshlet.indexCount; i += 3u) {
+            normalSum += getTriangleNormal(vertices, &meshletIndices[i]);
+        }
+
+        // Default to a cone that never culls
+        const float normalLength = glm::length(normalSum);
+        meshlet.coneApex = glm::vec4(centre, 0.f);
+        meshlet.coneAxisCutoff = glm::vec4(0.f, 0.f, 1.f, 2.f);
+        if (normalLength <= 0.f) {
+            return;
+        }
+
+        const glm::vec3 axis = normalSum / normalLength;
+        float minDot = 1.f;
+        for (uint32_t i = 0u; i < meshlet.indexCount; i += 3u) {
+            const glm::vec3 normal = getTriangleNormal(vertices, &meshletIndices[i]);
+            if (normal != glm::vec3{ 0.f }) {
+                minDot = std::min(minDot, glm::dot(normal, axis));
+            }
+        }
+        if (minDot <= MIN_CONE_DOT) {
+            return;
+        }
+
+        // Slide the apex back along the axis until it is behind every triangle plane, so that
+        // "the apex is seen from within the cone" implies every triangle is back facing.
+        float maxT = 0.f;
+        for (uint32_t i = 0u; i < meshlet.indexCount; i += 3u) {
+            const glm::vec3 normal = getTriangleNormal(vertices, &meshletIndices[i]);
+            if (normal == glm::vec3{ 0.f }) {
+                continue;
+            }
+
+            const glm::vec3& p0 = vertices[meshletIndices[i]].position;
+            maxT = std::max(maxT, glm::dot(centre - p0, normal) / glm::dot(axis, normal));
+        }
+
+        meshlet.coneApex = glm::vec4(centre - axis * maxT, 0.f);
+        meshlet.coneAxisCutoff = glm::vec4(axis, std::sqrt(1.f - minDot * minDot));
+    }
+}; //namespace MeshletBuilder
+}; //namespace Divide
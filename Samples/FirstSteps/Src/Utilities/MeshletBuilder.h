@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Model.h"
+
+#include <vector>
+
+namespace Divide {
+    namespace MeshletBuilder {
+        // Reorders the triangles in indices[indexOffset, indexOffset + indexCount) into clusters of at most
+        // Model::MAX_MESHLET_VERTICES unique vertices and Model::MAX_MESHLET_TRIANGLES triangles, so every meshlet
+        // is a contiguous index range. Clusters grow greedily over shared vertices, preferring triangles that face
+        // the same way as the cluster so the normal cones stay tight. Appends one Meshlet per cluster to 'meshlets'.
+        void build(const Model::Vertex* vertices,
+                   size_t vertexCount,
+                   uint32_t* indices,
+                   uint32_t indexOffset,
+                   uint32_t indexCount,
+                   uint32_t lod,
+                   std::vector<Model::Meshlet>& meshlets);
+
+        // Bounding sphere and normal cone for the triangles in the given index range
+        void computeBounds(const Model::Vertex* vertices, const uint32_t* indices, Model::Meshlet& meshlet);
+    }; //namespace MeshletBuilder
+}; //namespace Divide
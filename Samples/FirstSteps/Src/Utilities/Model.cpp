@@ -1,123 +1,354 @@
 #include "Model.h"
+#include "CookedModel.h"
+#include "UploadBatch.h"
 
-#include "Utils.h"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
-#include <unordered_map>
-
-namespace std {
-    template<>
-    struct hash<Divide::Model::Vertex> {
-        size_t operator()(Divide::Model::Vertex const& vertex) const {
-            size_t seed = 0;
-            Divide::hashCombine(seed, vertex.position, vertex.colour, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-};
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <numeric>
 
 namespace Divide {
 
-    Model::Model(Device& device, const Builder& builder)
+    namespace {
+        // Models may be created off the main thread
+        std::atomic<uint32_t> g_nextSortId{ 0u };
+    };
+
+    Model::Model(Device& device)
         : _device(device)
+        , _sortId(g_nextSortId.fetch_add(1u, std::memory_order_relaxed))
+    {
+    }
+
+    Model::Model(Device& device, const Builder& builder, const bool positionStream)
+        : Model(device)
+    {
+        UploadBatch batch{ _device };
+        upload(builder, batch, positionStream);
+        batch.submit();
+        batch.wait();
+        _resident = true;
+    }
+
+    Model::Model(Device& device, const CookedModelFile& cookedFile, const bool positionStream)
+        : Model(device)
     {
-        createVertexBuffers(builder._vertices);
-        createIndexBuffers(builder._indices);
+        UploadBatch batch{ _device };
+        upload(cookedFile, batch, positionStream);
+        batch.submit();
+        batch.wait();
+        _resident = true;
     }
 
     Model::~Model()
     {
+        _device.getGeometryArena().free(_geometry);
+        _device.getGeometryArena().free(_positionGeometry);
     }
 
     std::unique_ptr<Model> Model::createModelFromFile(Device& device, const std::string& filePath) {
-        Builder builder{};
-        builder.loadModel(filePath);
-        return std::make_unique<Model>(device, builder);
+        const auto startTime = std::chrono::high_resolution_clock::now();
+
+        const ImportOptions options = getRuntimeImportOptions();
+        std::unique_ptr<Model> model{};
+        {
+            CookedModelFile cookedFile{};
+            if (cookedFile.open(CookedModelFile::getCookedPath(filePath))) {
+                model = std::make_unique<Model>(device, cookedFile, options.positionStream);
+            }
+        }
+
+        const bool loadedCooked = model != nullptr;
+        if (!loadedCooked) {
+            Builder builder{};
+            builder.loadModel(filePath, options);
+            model = std::make_unique<Model>(device, builder, options.positionStream);
+        }
+
+        const float loadTimeMS = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        std::cout << "Loaded model [ " << filePath << " ] from " << (loadedCooked ? "cooked mesh" : "source file")
+                  << " in " << loadTimeMS << " ms (peak RSS: " << getPeakResidentMemory() / (1024 * 1024) << " MB)" << std::endl;
+
+        return model;
     }
 
-    void Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
-        _vertexCount = static_cast<uint32_t>(vertices.size());
-        assert(_vertexCount >= 3 && "Vertex count must be at least 3");
+    Model::ImportOptions Model::getRuntimeImportOptions() {
+        ImportOptions options{};
+        options.quantize = true;
+        return options;
+    }
+
+    VkDeviceSize Model::getMemoryUsage() const {
+        VkDeviceSize ret = getVertexStride(_vertexFormat) * _vertexCount + getIndexStride(_indexType) * _indexCount;
+        if (hasPositionStream()) {
+            ret += getPositionStride(_vertexFormat) * _positionCount + getIndexStride(_indexType) * _positionGeometry.indexCount;
+        }
+        return ret;
+    }
+
+    glm::mat4 Model::getDequantisationMatrix() const {
+        if (_vertexFormat != VertexFormat::COMPACT) {
+            return glm::mat4{ 1.f };
+        }
+
+        return glm::scale(glm::translate(glm::mat4{ 1.f }, _boundsMin), getQuantisationExtent(_boundsMin, _boundsMax));
+    }
 
-        constexpr VkDeviceSize vertexSize = sizeof(vertices[0]);
-        const VkDeviceSize bufferSize = vertexSize * _vertexCount;
+    void Model::upload(const Builder& builder, UploadBatch& batch, const bool positionStream) {
+        _boundsMin = builder._boundsMin;
+        _boundsMax = builder._boundsMax;
+        _boundingSphere = builder._boundingSphere;
+        _vertexFormat = builder._vertexFormat;
+        _indexType = getIndexType(builder._vertices.size());
+        _lods = builder._lods;
+        _meshlets = builder._meshlets;
+
+        // Both are copied into staging memory during createGeometry, so the converted copies only need to live until then
+        std::vector<CompactVertex> compactVertices{};
+        const void* vertices = builder._vertices.data();
+        if (_vertexFormat == VertexFormat::COMPACT) {
+            compactVertices = builder.getCompactVertices();
+            vertices = compactVertices.data();
+        }
 
-        Buffer stagingBuffer{
-            _device,
-            vertexSize,
-            _vertexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        std::vector<uint16_t> shortIndices{};
+        const void* indices = builder._indices.data();
+        if (_indexType == VK_INDEX_TYPE_UINT16) {
+            shortIndices.assign(builder._indices.begin(), builder._indices.end());
+            indices = shortIndices.data();
+        }
+
+        const uint32_t indexCount = static_cast<uint32_t>(builder._indices.size());
+        createGeometry(vertices, static_cast<uint32_t>(builder._vertices.size()), indices, indexCount, batch);
+
+        const auto getIndex = [&builder](const uint32_t index) { return builder._indices[index]; };
+        if (positionStream && _vertexFormat == VertexFormat::COMPACT) {
+            createPositionStream<std::array<uint16_t, 4>>(static_cast<uint32_t>(compactVertices.size()),
+                                                          [&compactVertices](const uint32_t vertex) {
+                                                              const uint16_t* position = compactVertices[vertex].position;
+                                                              return std::array<uint16_t, 4>{ position[0], position[1], position[2], 0u };
+                                                          },
+                                                          getIndex,
+                                                          batch);
+        } else if (positionStream) {
+            createPositionStream<glm::vec3>(static_cast<uint32_t>(builder._vertices.size()),
+                                            [&builder](const uint32_t vertex) { return builder._vertices[vertex].position; },
+                                            getIndex,
+                                            batch);
+        }
+
+        if (_lods.empty() && _hasIndexBuffer) {
+            _lods.push_back({ 0u, indexCount, 0.f });
+        }
+        createOccluderMesh(static_cast<uint32_t>(builder._vertices.size()),
+                           [&builder](const uint32_t vertex) { return builder._vertices[vertex].position; },
+                           [&builder](const uint32_t index) { return builder._indices[index]; });
+    }
+
+    void Model::upload(const CookedModelFile& cookedFile, UploadBatch& batch, const bool positionStream) {
+        const auto& header = cookedFile.header();
+        _boundsMin = { header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+        _boundsMax = { header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+        _boundingSphere = { header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3] };
+        _vertexFormat = static_cast<VertexFormat>(header.vertexFormat);
+        _indexType = header.indexStride == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+        _lods.assign(cookedFile.lods(), cookedFile.lods() + header.lodCount);
+        _meshlets.assign(cookedFile.meshlets(), cookedFile.meshlets() + header.meshletCount);
+
+        createGeometry(cookedFile.vertexData(), cookedFile.vertexCount(), cookedFile.indexData(), cookedFile.indexCount(), batch);
+
+        // The file's arrays are in their GPU formats, so positions may need dequantising
+        const std::byte* vertexData = cookedFile.vertexData();
+        const std::byte* indexData = cookedFile.indexData();
+        const glm::mat4 dequantise = getDequantisationMatrix();
+        const auto getIndex = [this, indexData](const uint32_t index) {
+            if (_indexType == VK_INDEX_TYPE_UINT16) {
+                return uint32_t{ reinterpret_cast<const uint16_t*>(indexData)[index] };
+            }
+            return reinterpret_cast<const uint32_t*>(indexData)[index];
         };
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
-        
-        _vertexBufferPtr = std::make_unique<Buffer>(
-            _device,
-            vertexSize,
-            _vertexCount,
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-
-        _device.copyBuffer(stagingBuffer.getBuffer(), _vertexBufferPtr->getBuffer(), bufferSize);
-    }
-
-    void Model::createIndexBuffers(const std::vector<uint32_t>& indices) {
-        _indexCount = static_cast<uint32_t>(indices.size());
+        if (_vertexFormat == VertexFormat::COMPACT) {
+            if (positionStream) {
+                createPositionStream<std::array<uint16_t, 4>>(cookedFile.vertexCount(),
+                                                              [vertexData](const uint32_t vertex) {
+                                                                  const uint16_t* position = reinterpret_cast<const CompactVertex*>(vertexData)[vertex].position;
+                                                                  return std::array<uint16_t, 4>{ position[0], position[1], position[2], 0u };
+                                                              },
+                                                              getIndex,
+                                                              batch);
+            }
+            createOccluderMesh(cookedFile.vertexCount(),
+                               [vertexData, &dequantise](const uint32_t vertex) {
+                                   const CompactVertex& compact = reinterpret_cast<const CompactVertex*>(vertexData)[vertex];
+                                   const glm::vec3 unorm = glm::vec3(compact.position[0], compact.position[1], compact.position[2]) / 65535.f;
+                                   return glm::vec3{ dequantise * glm::vec4{ unorm, 1.f } };
+                               },
+                               getIndex);
+        } else {
+            if (positionStream) {
+                createPositionStream<glm::vec3>(cookedFile.vertexCount(),
+                                                [vertexData](const uint32_t vertex) { return reinterpret_cast<const Vertex*>(vertexData)[vertex].position; },
+                                                getIndex,
+                                                batch);
+            }
+            createOccluderMesh(cookedFile.vertexCount(),
+                               [vertexData](const uint32_t vertex) { return reinterpret_cast<const Vertex*>(vertexData)[vertex].position; },
+                               getIndex);
+        }
+    }
+
+    void Model::createGeometry(const void* vertices, const uint32_t vertexCount, const void* indices, const uint32_t indexCount, UploadBatch& batch) {
+        _vertexCount = vertexCount;
+        _indexCount = indexCount;
         _hasIndexBuffer = _indexCount > 0u;
+        assert(_vertexCount >= 3 && "Vertex count must be at least 3");
 
-        if (!_hasIndexBuffer) {
+        _geometry = _device.getGeometryArena().allocate(getVertexStride(_vertexFormat), _indexType,
+                                                        vertices, _vertexCount,
+                                                        indices, _indexCount,
+                                                        batch);
+    }
+
+    template<typename GetPosition, typename GetIndex>
+    void Model::createOccluderMesh(const uint32_t vertexCount, GetPosition&& getPosition, GetIndex&& getIndex) {
+        _occluderMesh = {};
+        if (!_hasIndexBuffer || _lods.empty()) {
             return;
         }
 
-        constexpr VkDeviceSize indexSize = sizeof(indices[0]);
-        const VkDeviceSize bufferSize = indexSize * _indexCount;
+        const Lod& lod = _lods.back();
+        if (lod.indexCount / 3u > MAX_OCCLUDER_TRIANGLES) {
+            return;
+        }
 
-        Buffer stagingBuffer{
-            _device,
-            indexSize,
-            _indexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+        std::vector<uint32_t> remap(vertexCount, ~0u);
+        _occluderMesh.indices.reserve(lod.indexCount);
+        for (uint32_t i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; ++i) {
+            const uint32_t vertex = getIndex(i);
+            if (remap[vertex] == ~0u) {
+                remap[vertex] = static_cast<uint32_t>(_occluderMesh.positions.size());
+                _occluderMesh.positions.push_back(getPosition(vertex));
+            }
+            _occluderMesh.indices.push_back(remap[vertex]);
+        }
+    }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
+    template<typename Position, typename GetPosition, typename GetIndex>
+    void Model::createPositionStream(const uint32_t vertexCount, GetPosition&& getPosition, GetIndex&& getIndex, UploadBatch& batch) {
+        static_assert(sizeof(Position) == sizeof(Vertex::position) || sizeof(Position) == sizeof(CompactVertex::position), "Unexpected position encoding");
+        assert(sizeof(Position) == getPositionStride(_vertexFormat) && "Position type doesn't match the vertex format");
 
-        _indexBufferPtr = std::make_unique<Buffer>(
-            _device,
-            indexSize,
-            _indexCount,
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
+        std::vector<Position> sourcePositions(vertexCount);
+        for (uint32_t vertex = 0u; vertex < vertexCount; ++vertex) {
+            sourcePositions[vertex] = getPosition(vertex);
+        }
+
+        std::vector<Position> positions{};
+        std::vector<uint32_t> indices{};
+        if (!_hasIndexBuffer) {
+            // Nothing to weld through: a straight copy, drawn non-indexed like the vertices
+            positions = std::move(sourcePositions);
+        } else {
+            // Vertices split only by their other attributes (normal, UV or colour seams) become one. Bitwise equality,
+            // so the pre-pass transforms exactly the values the colour pass does.
+            const auto less = [&sourcePositions](const uint32_t lhs, const uint32_t rhs) {
+                return std::memcmp(&sourcePositions[lhs], &sourcePositions[rhs], sizeof(Position)) < 0;
+            };
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(), order.end(), less);
+
+            // The first vertex of every run of equal positions stands in for the whole run
+            std::vector<uint32_t> canonical(vertexCount);
+            for (uint32_t i = 0u; i < vertexCount; ++i) {
+                canonical[order[i]] = i > 0u && !less(order[i - 1u], order[i]) ? canonical[order[i - 1u]] : order[i];
+            }
+
+            // Numbered in first use order, like the vertices, so fetches stay mostly sequential
+            std::vector<uint32_t> remap(vertexCount, ~0u);
+            indices.resize(_indexCount);
+            for (uint32_t i = 0u; i < _indexCount; ++i) {
+                const uint32_t vertex = canonical[getIndex(i)];
+                if (remap[vertex] == ~0u) {
+                    remap[vertex] = static_cast<uint32_t>(positions.size());
+                    positions.push_back(sourcePositions[vertex]);
+                }
+                indices[i] = remap[vertex];
+            }
+        }
+        _positionCount = static_cast<uint32_t>(positions.size());
+
+        // Copied into staging memory by allocate(), so these only need to live until then
+        std::vector<uint16_t> shortIndices{};
+        const void* indexData = indices.empty() ? nullptr : indices.data();
+        if (_indexType == VK_INDEX_TYPE_UINT16 && !indices.empty()) {
+            shortIndices.assign(indices.begin(), indices.end());
+            indexData = shortIndices.data();
+        }
 
-        _device.copyBuffer(stagingBuffer.getBuffer(), _indexBufferPtr->getBuffer(), bufferSize);
+        _positionGeometry = _device.getGeometryArena().allocate(sizeof(Position), _indexType,
+                                                                positions.data(), _positionCount,
+                                                                indexData, static_cast<uint32_t>(indices.size()),
+                                                                batch);
     }
 
-    void Model::bind(VkCommandBuffer commandBuffer) {
-        VkBuffer buffers[] = { _vertexBufferPtr->getBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    void Model::bind(VkCommandBuffer commandBuffer, const Stream stream) {
+        _device.getGeometryArena().bind(commandBuffer, getGeometry(stream));
+    }
 
+    void Model::draw(VkCommandBuffer commandBuffer, const uint32_t lod, const uint32_t instanceCount, const uint32_t firstInstance, const Stream stream) {
+        const GeometryArena::Range& geometry = getGeometry(stream);
         if (_hasIndexBuffer) {
-            vkCmdBindIndexBuffer(commandBuffer, _indexBufferPtr->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            const Lod& range = _lods[std::min(lod, getLodCount() - 1u)];
+            vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, geometry.firstIndex + range.indexOffset, static_cast<int32_t>(geometry.vertexOffset), firstInstance);
+        } else {
+            vkCmdDraw(commandBuffer, _vertexCount, instanceCount, geometry.vertexOffset, firstInstance);
         }
     }
 
-    void Model::draw(VkCommandBuffer commandBuffer) {
-        if (_hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, _indexCount, 1, 0, 0, 0);
-        } else {
-            vkCmdDraw(commandBuffer, _vertexCount, 1, 0, 0);
+    void Model::drawIndexed(VkCommandBuffer commandBuffer, const uint32_t indexOffset, const uint32_t indexCount, const uint32_t instanceCount, const uint32_t firstInstance, const Stream stream) {
+        assert(_hasIndexBuffer && indexOffset + indexCount <= _indexCount && "Index range out of bounds");
+        const GeometryArena::Range& geometry = getGeometry(stream);
+        vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, geometry.firstIndex + indexOffset, static_cast<int32_t>(geometry.vertexOffset), firstInstance);
+    }
+
+    VkDrawIndexedIndirectCommand Model::getIndirectCommand(const uint32_t lod, const uint32_t instanceCount, const uint32_t firstInstance) const {
+        assert(_hasIndexBuffer && "Indirect commands are only built for indexed models");
+
+        const Lod& range = _lods[std::min(lod, getLodCount() - 1u)];
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = range.indexCount;
+        command.instanceCount = instanceCount;
+        command.firstIndex = _geometry.firstIndex + range.indexOffset;
+        command.vertexOffset = static_cast<int32_t>(_geometry.vertexOffset);
+        command.firstInstance = firstInstance;
+        return command;
+    }
+
+    uint32_t Model::selectLod(const float pixelsPerUnit, const float maxPixelError) const {
+        uint32_t ret = 0u;
+        for (uint32_t lod = 1u; lod < getLodCount(); ++lod) {
+            if (_lods[lod].error * pixelsPerUnit > maxPixelError) {
+                break;
+            }
+            ret = lod;
         }
+
+        return ret;
+    }
+
+    std::pair<uint32_t, uint32_t> Model::getMeshletRange(const uint32_t lod) const {
+        const auto lodLess = [](const Meshlet& meshlet, const uint32_t value) { return meshlet.lod < value; };
+        const auto first = std::lower_bound(_meshlets.begin(), _meshlets.end(), lod, lodLess);
+        const auto last = std::lower_bound(first, _meshlets.end(), lod + 1u, lodLess);
+        return { static_cast<uint32_t>(first - _meshlets.begin()), static_cast<uint32_t>(last - first) };
     }
 
     std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
@@ -138,59 +369,36 @@ namespace Divide {
         return attributeDescriptions;
     }
 
-    void Model::Builder::loadModel(const std::string& filePath) {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
-
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str())) {
-            throw std::runtime_error(warn + err);
-        }
-
-        _vertices.clear();
-        _indices.clear();
-
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    std::vector<VkVertexInputBindingDescription> Model::CompactVertex::getBindingDescriptions() {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(CompactVertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                Vertex vertex{};
+    std::vector<VkVertexInputAttributeDescription> Model::CompactVertex::getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position) });
+        attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM    , offsetof(CompactVertex, colour) });
+        attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM      , offsetof(CompactVertex, normal) });
+        attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT     , offsetof(CompactVertex, uv) });
 
-                if (index.vertex_index >= 0) {
-                    vertex.position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2]
-                    };
+        return attributeDescriptions;
+    }
 
-                    vertex.colour = {
-                        attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2]
-                    };
-                }
-                if (index.normal_index >= 0) {
-                    vertex.normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2]
-                    };
-                }
-                if (index.texcoord_index >= 0) {
-                    vertex.uv = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1]
-                    };
-                }
+    std::vector<VkVertexInputBindingDescription> Model::getPositionBindingDescriptions(const VertexFormat format) {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = static_cast<uint32_t>(getPositionStride(format));
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
 
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(_vertices.size());
-                    _vertices.push_back(vertex);
-                }
+    std::vector<VkVertexInputAttributeDescription> Model::getPositionAttributeDescriptions(const VertexFormat format) {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        attributeDescriptions.push_back({ 0, 0, format == VertexFormat::COMPACT ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT, 0 });
 
-                _indices.push_back(uniqueVertices[vertex]);
-            }
-        }
+        return attributeDescriptions;
     }
 }; //namespace Divide
@@ -2,17 +2,44 @@
 
 #include "Device.h"
 #include "Buffer.h"
+#include "GeometryArena.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <cassert>
 #include <vector>
 #include <memory>
+#include <utility>
 
 namespace Divide {
+    class CookedModelFile;
+    class ModelLoader;
+    class UploadBatch;
+
     class Model {
     public:
+        static constexpr uint32_t MAX_LODS = 8u;
+        static constexpr uint32_t MAX_MESHLET_VERTICES = 64u;
+        static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124u;
+        // Models whose coarsest LOD is larger than this don't keep an occluder mesh
+        static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 4096u;
+
+        enum class VertexFormat : uint8_t {
+            FULL = 0,
+            COMPACT,
+            COUNT
+        };
+
+        // Every model keeps its interleaved vertices in the GeometryArena. Models imported with
+        // ImportOptions::positionStream also keep a position only copy (in the format's position encoding) welded by
+        // position, for depth only passes. Its index buffer has the same layout, so LOD and meshlet ranges apply to both.
+        enum class Stream : uint8_t {
+            VERTEX = 0,
+            POSITION
+        };
+
         struct Vertex {
             glm::vec3 position{};
             glm::vec3 colour{};
@@ -30,15 +57,96 @@ namespace Divide {
             }
         };
 
+        // 20 byte version of Vertex. Positions are UNORM relative to the mesh bounds (see getDequantisationMatrix),
+        // normals are octahedral encoded SNORM, colours are 8 bit UNORM and UVs are half floats.
+        struct CompactVertex {
+            uint16_t position[4]{}; // w is padding
+            uint8_t colour[4]{};    // a is padding
+            int16_t normal[2]{};
+            uint16_t uv[2]{};
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        // A range of the shared index buffer. LOD 0 is the full resolution mesh and 'error' grows with every level.
+        struct Lod {
+            uint32_t indexOffset = 0u;
+            uint32_t indexCount = 0u;
+            // Maximum deviation from the source surface, in model space units
+            float error = 0.f;
+        };
+
+        // A cluster of triangles stored as a contiguous range of the index buffer, with the data needed to cull it.
+        // Culled on the CPU (SimpleRenderSystem), but laid out for std430 so a GPU culler could take the array unchanged.
+        struct Meshlet {
+            // xyz: centre, w: radius. Model space.
+            glm::vec4 boundingSphere{};
+            // Every triangle is back facing when dot(normalize(coneApex - eye), axis) >= cutoff. A cutoff > 1 never culls.
+            glm::vec4 coneApex{};
+            glm::vec4 coneAxisCutoff{};
+            uint32_t indexOffset = 0u;
+            uint32_t indexCount = 0u;
+            uint32_t vertexCount = 0u;
+            uint32_t lod = 0u;
+        };
+
+        // CPU side copy of the coarsest LOD, positions only, for software occlusion culling (see OcclusionRasterizer).
+        // Model space, unquantised.
+        struct OccluderMesh {
+            std::vector<glm::vec3> positions{};
+            std::vector<uint32_t> indices{};
+        };
+
+        struct ImportOptions {
+            // Worker threads used to weld the OBJ index stream. 0 picks the hardware concurrency, scaled back on small
+            // meshes; anything else is used as given.
+            uint32_t threadCount = 0u;
+            // Run the vertex cache, overdraw and vertex fetch passes after welding
+            bool optimize = false;
+            // Upload (or cook) the mesh using CompactVertex instead of Vertex
+            bool quantize = false;
+            // Levels of detail to generate, including the full resolution one. Each level targets half the triangles of the previous.
+            uint32_t lodCount = 1u;
+            // Split every LOD into meshlets after optimisation
+            bool buildMeshlets = false;
+            // Also upload Stream::POSITION, for depth pre-passes. Costs a second index buffer and a weld at load time.
+            // Upload only: cooked files are the same either way.
+            bool positionStream = false;
+        };
+
         struct Builder {
             std::vector<Vertex> _vertices{};
             std::vector<uint32_t> _indices{};
+            glm::vec3 _boundsMin{};
+            glm::vec3 _boundsMax{};
+            // xyz: centre, w: radius. Model space, centred on the AABB but only as large as the furthest vertex needs.
+            glm::vec4 _boundingSphere{};
+            VertexFormat _vertexFormat = VertexFormat::FULL;
+            // Index ranges into _indices. Empty means a single LOD covering all of them.
+            std::vector<Lod> _lods{};
+            // Sorted by LOD. Empty means the LOD ranges are drawn whole.
+            std::vector<Meshlet> _meshlets{};
 
             void loadModel(const std::string& filePath);
+            void loadModel(const std::string& filePath, const ImportOptions& options);
+            void computeBounds();
+            // Reorders _indices for post-transform cache reuse and overdraw, then _vertices for sequential fetch
+            void optimize();
+            // Appends simplified copies of LOD 0 to _indices until 'lodCount' levels exist or simplification stalls
+            void generateLods(uint32_t lodCount);
+            // Reorders the triangles of every LOD into meshlets. Invalidates the vertex cache ordering only within each meshlet.
+            void buildMeshlets();
+            // Encodes _vertices relative to _boundsMin/_boundsMax. Call computeBounds first.
+            [[nodiscard]] std::vector<CompactVertex> getCompactVertices() const;
         };
 
         Model() = default;
-        Model(Device& device, const Builder& builder);
+        // Empty, non-resident model. ModelLoader fills it in once the source data has been parsed and uploaded.
+        explicit Model(Device& device);
+        // Synchronous: the model is resident when the constructor returns
+        Model(Device& device, const Builder& builder, bool positionStream = false);
+        Model(Device& device, const CookedModelFile& cookedFile, bool positionStream = false);
         ~Model();
 
         Model(const Model&) = delete;
@@ -46,23 +154,122 @@ namespace Divide {
         Model(Model&&) = delete;
         Model& operator=(Model&&) = delete;
 
+        // Loads the cooked version of the asset if one is available, falling back to parsing the source file
         static std::unique_ptr<Model> createModelFromFile(Device& device, const std::string& filePath);
+        // Import settings used when a source file has to be parsed at runtime because no cooked mesh exists
+        [[nodiscard]] static ImportOptions getRuntimeImportOptions();
+
+        // False until the vertex/index data has reached GPU memory. Non-resident models must not be bound or drawn.
+        [[nodiscard]] inline bool isResident() const { return _resident; }
+        // Device memory held by this model's vertices and indices
+        [[nodiscard]] VkDeviceSize getMemoryUsage() const;
 
-        void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        // Binds the shared arena buffers this model draws 'stream' from. Models with the same getGeometry(stream).getBindKey() can skip it.
+        void bind(VkCommandBuffer commandBuffer, Stream stream = Stream::VERTEX);
+        void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0u, uint32_t instanceCount = 1u, uint32_t firstInstance = 0u, Stream stream = Stream::VERTEX);
+        // Draws an arbitrary range of the index buffer, e.g. a run of adjacent meshlets
+        void drawIndexed(VkCommandBuffer commandBuffer, uint32_t indexOffset, uint32_t indexCount, uint32_t instanceCount = 1u, uint32_t firstInstance = 0u, Stream stream = Stream::VERTEX);
+        // The parameters draw() would use, for indirect draws. Indexed models only.
+        [[nodiscard]] VkDrawIndexedIndirectCommand getIndirectCommand(uint32_t lod = 0u, uint32_t instanceCount = 1u, uint32_t firstInstance = 0u) const;
+        [[nodiscard]] inline bool hasIndexBuffer() const { return _hasIndexBuffer; }
+
+        // Coarsest LOD whose error, multiplied by 'pixelsPerUnit' (projected size of one model space unit), stays within 'maxPixelError'
+        [[nodiscard]] uint32_t selectLod(float pixelsPerUnit, float maxPixelError) const;
+        [[nodiscard]] inline uint32_t getLodCount() const { return static_cast<uint32_t>(_lods.size()); }
+        [[nodiscard]] inline const Lod& getLod(const uint32_t lod) const { return _lods[lod]; }
+        [[nodiscard]] inline const std::vector<Meshlet>& getMeshlets() const { return _meshlets; }
+        // Meshlets of 'lod' as a [first, first + count) range of getMeshlets()
+        [[nodiscard]] std::pair<uint32_t, uint32_t> getMeshletRange(uint32_t lod) const;
+        // Empty if the model has no index buffer or its coarsest LOD exceeds MAX_OCCLUDER_TRIANGLES
+        [[nodiscard]] inline const OccluderMesh& getOccluderMesh() const { return _occluderMesh; }
+        // Where the vertices and indices live in the device's GeometryArena. Invalid until uploaded.
+        // Stream::POSITION only exists with hasPositionStream().
+        [[nodiscard]] inline const GeometryArena::Range& getGeometry(const Stream stream = Stream::VERTEX) const {
+            if (stream == Stream::POSITION) {
+                assert(_positionGeometry.isValid() && "Model was not imported with ImportOptions::positionStream");
+                return _positionGeometry;
+            }
+            return _geometry;
+        }
+        [[nodiscard]] inline bool hasPositionStream() const { return _positionGeometry.isValid(); }
+        // Unique positions in the position stream, at most the vertex count. 0 without one.
+        [[nodiscard]] inline uint32_t getPositionCount() const { return _positionCount; }
+
+        [[nodiscard]] inline const glm::vec3& getBoundsMin() const { return _boundsMin; }
+        [[nodiscard]] inline const glm::vec3& getBoundsMax() const { return _boundsMax; }
+        // xyz: centre, w: radius. Model space.
+        [[nodiscard]] inline const glm::vec4& getBoundingSphere() const { return _boundingSphere; }
+        [[nodiscard]] inline VertexFormat getVertexFormat() const { return _vertexFormat; }
+        // Unique per model for the life of the process (until it wraps), for draw sort keys
+        [[nodiscard]] inline uint32_t getSortId() const { return _sortId; }
+        [[nodiscard]] inline VkIndexType getIndexType() const { return _indexType; }
+        // Maps compact vertex positions back into model space. Fold it into the model matrix; identity for FULL meshes.
+        [[nodiscard]] glm::mat4 getDequantisationMatrix() const;
+
+        // Size of the box compact positions are normalised to. Flat axes get a unit extent so they stay representable.
+        [[nodiscard]] static inline glm::vec3 getQuantisationExtent(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+            const glm::vec3 extent = boundsMax - boundsMin;
+            return { extent.x > 0.f ? extent.x : 1.f, extent.y > 0.f ? extent.y : 1.f, extent.z > 0.f ? extent.z : 1.f };
+        }
+        // True if every triangle of the meshlet faces away from 'eye' (model space)
+        [[nodiscard]] static inline bool isMeshletBackFacing(const Meshlet& meshlet, const glm::vec3& eye) {
+            const glm::vec3 apex{ meshlet.coneApex };
+            const glm::vec3 direction = apex - eye;
+            const float distance = glm::length(direction);
+            return distance > 0.f && glm::dot(direction, glm::vec3{ meshlet.coneAxisCutoff }) >= meshlet.coneAxisCutoff.w * distance;
+        }
+        [[nodiscard]] static inline VkDeviceSize getVertexStride(const VertexFormat format) {
+            return format == VertexFormat::COMPACT ? sizeof(CompactVertex) : sizeof(Vertex);
+        }
+        // The position stream's layout: CompactVertex::position or Vertex::position on their own, at location 0
+        [[nodiscard]] static inline VkDeviceSize getPositionStride(const VertexFormat format) {
+            return format == VertexFormat::COMPACT ? sizeof(CompactVertex::position) : sizeof(Vertex::position);
+        }
+        static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(VertexFormat format);
+        static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(VertexFormat format);
+        // 16 bit indices whenever every vertex is addressable without hitting the primitive restart value
+        [[nodiscard]] static inline VkIndexType getIndexType(const size_t vertexCount) {
+            return vertexCount < 0xFFFFu ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        }
+        [[nodiscard]] static inline VkDeviceSize getIndexStride(const VkIndexType indexType) {
+            return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
 
     private:
-        void createVertexBuffers(const std::vector<Vertex>& vertices);
-        void createIndexBuffers(const std::vector<uint32_t>& indices);
+        friend class ModelLoader;
+
+        // Creates the GPU buffers and queues their contents on 'batch'. The caller marks the model resident once the batch completes.
+        // 'positionStream' also creates Stream::POSITION (see ImportOptions::positionStream)
+        void upload(const Builder& builder, UploadBatch& batch, bool positionStream);
+        void upload(const CookedModelFile& cookedFile, UploadBatch& batch, bool positionStream);
+        void createGeometry(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount, UploadBatch& batch);
+        // Copies the coarsest LOD's triangles, with only the vertices they reference. 'getPosition' / 'getIndex' read the source arrays.
+        template<typename GetPosition, typename GetIndex>
+        void createOccluderMesh(uint32_t vertexCount, GetPosition&& getPosition, GetIndex&& getIndex);
+        // Welds bitwise identical positions and uploads them with a remapped copy of the index buffer. 'Position' is
+        // the stream's element type, 'getPosition' / 'getIndex' read the source arrays.
+        template<typename Position, typename GetPosition, typename GetIndex>
+        void createPositionStream(uint32_t vertexCount, GetPosition&& getPosition, GetIndex&& getIndex, UploadBatch& batch);
 
     private:
         Device& _device;
+        uint32_t _sortId = 0u;
 
-        std::unique_ptr<Buffer> _vertexBufferPtr;
-        uint32_t _vertexCount = 0u; 
-
+        GeometryArena::Range _geometry{};
+        GeometryArena::Range _positionGeometry{};
+        uint32_t _vertexCount = 0u;
+        uint32_t _positionCount = 0u;
         bool _hasIndexBuffer = false;
-        std::unique_ptr<Buffer> _indexBufferPtr;
         uint32_t _indexCount = 0u;
+
+        glm::vec3 _boundsMin{};
+        glm::vec3 _boundsMax{};
+        glm::vec4 _boundingSphere{};
+        VertexFormat _vertexFormat = VertexFormat::FULL;
+        VkIndexType _indexType = VK_INDEX_TYPE_UINT32;
+        std::vector<Lod> _lods{};
+        std::vector<Meshlet> _meshlets{};
+        OccluderMesh _occluderMesh{};
+        bool _resident = false;
     };
 }; //namespace Divide
@@ -0,0 +1,344 @@
+#include "Model.h"
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "VertexHashTable.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace Divide {
+
+    static_assert(sizeof(Model::CompactVertex) == 20u, "CompactVertex must stay tightly packed");
+
+    namespace {
+        // Below this many indices per worker the thread spawn and merge cost more than they save
+        constexpr size_t MIN_INDICES_PER_IMPORT_THREAD = 1u << 16;
+        // A LOD has to drop at least this fraction of its parent's triangles to be worth keeping
+        constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+        Model::Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+            Model::Vertex vertex{};
+
+            if (index.vertex_index >= 0) {
+                vertex.position = {
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]
+                };
+
+                vertex.colour = {
+                    attrib.colors[3 * index.vertex_index + 0],
+                    attrib.colors[3 * index.vertex_index + 1],
+                    attrib.colors[3 * index.vertex_index + 2]
+                };
+            }
+            if (index.normal_index >= 0) {
+                vertex.normal = {
+                    attrib.normals[3 * index.normal_index + 0],
+                    attrib.normals[3 * index.normal_index + 1],
+                    attrib.normals[3 * index.normal_index + 2]
+                };
+            }
+            if (index.texcoord_index >= 0) {
+                vertex.uv = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+            }
+
+            return vertex;
+        }
+
+        // All shapes' index lists viewed as one contiguous stream
+        struct IndexStream {
+            explicit IndexStream(const std::vector<tinyobj::shape_t>& shapes) {
+                _shapeOffsets.reserve(shapes.size() + 1);
+                _shapeOffsets.push_back(0u);
+                for (const auto& shape : shapes) {
+                    _shapes.push_back(&shape.mesh.indices);
+                    _shapeOffsets.push_back(_shapeOffsets.back() + shape.mesh.indices.size());
+                }
+            }
+
+            [[nodiscard]] size_t size() const { return _shapeOffsets.back(); }
+
+            template<typename Func>
+            void forEach(const size_t begin, const size_t end, Func&& func) const {
+                size_t shape = std::upper_bound(_shapeOffsets.begin(), _shapeOffsets.end(), begin) - _shapeOffsets.begin() - 1;
+                for (size_t i = begin; i < end; ++shape) {
+                    const auto& indices = *_shapes[shape];
+                    const size_t shapeEnd = std::min(end, _shapeOffsets[shape + 1]);
+                    for (; i < shapeEnd; ++i) {
+                        func(indices[i - _shapeOffsets[shape]]);
+                    }
+                }
+            }
+
+        private:
+            std::vector<const std::vector<tinyobj::index_t>*> _shapes{};
+            std::vector<size_t> _shapeOffsets{};
+        };
+
+        // A contiguous slice of the index stream welded in isolation. Vertices are stored in order of first use.
+        struct ImportPartition {
+            size_t _begin = 0u;
+            size_t _end = 0u;
+            std::vector<Model::Vertex> _vertices{};
+            std::vector<uint32_t> _indices{};
+            std::vector<uint32_t> _remap{};
+        };
+
+        void weldPartition(const tinyobj::attrib_t& attrib, const IndexStream& stream, ImportPartition& partition) {
+            const size_t indexCount = partition._end - partition._begin;
+            VertexHashTable uniqueVertices{ indexCount };
+            partition._indices.reserve(indexCount);
+
+            stream.forEach(partition._begin, partition._end, [&](const tinyobj::index_t& index) {
+                partition._indices.push_back(uniqueVertices.weld(makeVertex(attrib, index), partition._vertices));
+            });
+        }
+
+        template<typename Func>
+        void parallelFor(const size_t count, Func&& func) {
+            std::vector<std::thread> workers{};
+            workers.reserve(count - 1);
+            for (size_t i = 1; i < count; ++i) {
+                workers.emplace_back([&func, i]() { func(i); });
+            }
+            func(0u);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        uint16_t packUnorm16(const float value) {
+            return static_cast<uint16_t>(std::lround(std::clamp(value, 0.f, 1.f) * 65535.f));
+        }
+
+        uint8_t packUnorm8(const float value) {
+            return static_cast<uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+        }
+
+        int16_t packSnorm16(const float value) {
+            return static_cast<int16_t>(std::lround(std::clamp(value, -1.f, 1.f) * 32767.f));
+        }
+
+        // Octahedral mapping: project onto |x| + |y| + |z| = 1 and fold the lower hemisphere over the diagonals
+        glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+            const float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if (l1Norm <= 0.f) {
+                return glm::vec2{ 0.f };
+            }
+
+            const glm::vec3 n = normal / l1Norm;
+            if (n.z >= 0.f) {
+                return { n.x, n.y };
+            }
+
+            return {
+                (1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+                (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f)
+            };
+        }
+
+        void weldIndexStream(const tinyobj::attrib_t& attrib,
+                             const IndexStream& stream,
+                             const uint32_t requestedThreadCount,
+                             std::vector<Model::Vertex>& vertices,
+                             std::vector<uint32_t>& indices)
+        {
+            const size_t indexCount = stream.size();
+
+            // Only the automatic count backs off on small meshes; an explicit one is honoured (e.g. to exercise the
+            // parallel path), short of giving a worker nothing to do
+            size_t threadCount = requestedThreadCount;
+            if (threadCount == 0u) {
+                threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+                threadCount = std::min(threadCount, indexCount / MIN_INDICES_PER_IMPORT_THREAD);
+            }
+            threadCount = std::max(std::min(threadCount, indexCount), size_t{ 1u });
+
+            std::vector<ImportPartition> partitions(threadCount);
+            for (size_t i = 0; i < threadCount; ++i) {
+                partitions[i]._begin = indexCount * i / threadCount;
+                partitions[i]._end = indexCount * (i + 1) / threadCount;
+            }
+
+            if (threadCount == 1u) {
+                weldPartition(attrib, stream, partitions.front());
+                vertices = std::move(partitions.front()._vertices);
+                indices = std::move(partitions.front()._indices);
+                return;
+            }
+
+            parallelFor(threadCount, [&](const size_t i) {
+                weldPartition(attrib, stream, partitions[i]);
+            });
+
+            // Walking the partitions in stream order and appending each vertex the first time it is seen
+            // reproduces the single threaded first-use ordering exactly, so the output is deterministic.
+            size_t partitionVertexCount = 0u;
+            for (const auto& partition : partitions) {
+                partitionVertexCount += partition._vertices.size();
+            }
+
+            VertexHashTable uniqueVertices{ partitionVertexCount };
+            vertices.reserve(partitionVertexCount);
+            for (auto& partition : partitions) {
+                partition._remap.resize(partition._vertices.size());
+                for (size_t i = 0; i < partition._vertices.size(); ++i) {
+                    partition._remap[i] = uniqueVertices.weld(partition._vertices[i], vertices);
+                }
+            }
+
+            indices.resize(indexCount);
+            parallelFor(threadCount, [&](const size_t i) {
+                const ImportPartition& partition = partitions[i];
+                for (size_t j = 0; j < partition._indices.size(); ++j) {
+                    indices[partition._begin + j] = partition._remap[partition._indices[j]];
+                }
+            });
+        }
+    };
+
+    void Model::Builder::loadModel(const std::string& filePath) {
+        loadModel(filePath, ImportOptions{});
+    }
+
+    void Model::Builder::loadModel(const std::string& filePath, const ImportOptions& options) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str())) {
+            throw std::runtime_error(warn + err);
+        }
+
+        _vertices.clear();
+        _indices.clear();
+        _lods.clear();
+        _meshlets.clear();
+
+        weldIndexStream(attrib, IndexStream{ shapes }, options.threadCount, _vertices, _indices);
+
+        generateLods(options.lodCount);
+
+        if (options.optimize) {
+            optimize();
+        }
+        if (options.buildMeshlets) {
+            buildMeshlets();
+        }
+        computeBounds();
+        _vertexFormat = options.quantize ? VertexFormat::COMPACT : VertexFormat::FULL;
+    }
+
+    void Model::Builder::optimize() {
+        const std::vector<Lod> lods = _lods.empty() ? std::vector<Lod>{ { 0u, static_cast<uint32_t>(_indices.size()), 0.f } } : _lods;
+        for (const Lod& lod : lods) {
+            uint32_t* indices = _indices.data() + lod.indexOffset;
+            MeshOptimizer::optimizeVertexCache(indices, lod.indexCount, _vertices.size());
+            MeshOptimizer::optimizeOverdraw(indices, lod.indexCount, _vertices.data(), _vertices.size());
+        }
+        // All LODs share the vertex buffer, so fetch order follows LOD 0 first
+        MeshOptimizer::optimizeVertexFetch(_vertices, _indices.data(), _indices.size());
+    }
+
+    void Model::Builder::generateLods(const uint32_t lodCount) {
+        if (_lods.empty()) {
+            _lods.push_back({ 0u, static_cast<uint32_t>(_indices.size()), 0.f });
+        }
+
+        const size_t levelCount = std::min(lodCount, MAX_LODS);
+        std::vector<uint32_t> lodIndices{};
+        while (_lods.size() < levelCount) {
+            const Lod parent = _lods.back();
+            const size_t targetIndexCount = parent.indexCount / 6u * 3u;
+            const float error = MeshSimplifier::simplify(_vertices.data(),
+                                                         _vertices.size(),
+                                                         _indices.data() + parent.indexOffset,
+                                                         parent.indexCount,
+                                                         targetIndexCount,
+                                                         std::numeric_limits<float>::max(),
+                                                         lodIndices);
+
+            if (lodIndices.empty() || lodIndices.size() > parent.indexCount * (1.f - MIN_LOD_REDUCTION)) {
+                break;
+            }
+
+            // Each level is simplified from the previous one, so errors accumulate
+            _lods.push_back({ static_cast<uint32_t>(_indices.size()), static_cast<uint32_t>(lodIndices.size()), parent.error + error });
+            _indices.insert(_indices.end(), lodIndices.begin(), lodIndices.end());
+        }
+    }
+
+    void Model::Builder::buildMeshlets() {
+        if (_lods.empty()) {
+            _lods.push_back({ 0u, static_cast<uint32_t>(_indices.size()), 0.f });
+        }
+
+        _meshlets.clear();
+        for (uint32_t lod = 0u; lod < _lods.size(); ++lod) {
+            MeshletBuilder::build(_vertices.data(), _vertices.size(), _indices.data(), _lods[lod].indexOffset, _lods[lod].indexCount, lod, _meshlets);
+        }
+    }
+
+    std::vector<Model::CompactVertex> Model::Builder::getCompactVertices() const {
+        const glm::vec3 scale = 1.f / getQuantisationExtent(_boundsMin, _boundsMax);
+
+        std::vector<CompactVertex> ret(_vertices.size());
+        for (size_t i = 0; i < _vertices.size(); ++i) {
+            const Vertex& vertex = _vertices[i];
+            CompactVertex& compact = ret[i];
+
+            const glm::vec3 position = (vertex.position - _boundsMin) * scale;
+            const glm::vec2 normal = encodeOctahedral(vertex.normal);
+            for (int j = 0; j < 3; ++j) {
+                compact.position[j] = packUnorm16(position[j]);
+                compact.colour[j] = packUnorm8(vertex.colour[j]);
+            }
+            compact.colour[3] = 255u;
+            compact.normal[0] = packSnorm16(normal.x);
+            compact.normal[1] = packSnorm16(normal.y);
+            compact.uv[0] = glm::packHalf1x16(vertex.uv.x);
+            compact.uv[1] = glm::packHalf1x16(vertex.uv.y);
+        }
+
+        return ret;
+    }
+
+    void Model::Builder::computeBounds() {
+        if (_vertices.empty()) {
+            _boundsMin = _boundsMax = glm::vec3{ 0.f };
+            _boundingSphere = glm::vec4{ 0.f };
+            return;
+        }
+
+        _boundsMin = glm::vec3{ std::numeric_limits<float>::max() };
+        _boundsMax = glm::vec3{ std::numeric_limits<float>::lowest() };
+        for (const Vertex& vertex : _vertices) {
+            _boundsMin = glm::min(_boundsMin, vertex.position);
+            _boundsMax = glm::max(_boundsMax, vertex.position);
+        }
+
+        // Usually noticeably tighter than half the AABB's diagonal
+        const glm::vec3 centre = (_boundsMin + _boundsMax) * 0.5f;
+        float radiusSq = 0.f;
+        for (const Vertex& vertex : _vertices) {
+            const glm::vec3 offset = vertex.position - centre;
+            radiusSq = std::max(radiusSq, glm::dot(offset, offset));
+        }
+        _boundingSphere = glm::vec4(centre, std::sqrt(radiusSq));
+    }
+}; //namespace Divide
@@ -0,0 +1,123 @@
+#include "ModelLoader.h"
+#include "CookedModel.h"
+#include "UploadBatch.h"
+
+#include <iostream>
+
+namespace Divide {
+
+    ModelLoader::ModelLoader(Device& device, const uint32_t threadCount)
+        : _device(device)
+        , _threadPool(threadCount)
+    {
+    }
+
+    ModelLoader::~ModelLoader()
+    {
+        // Queued parses bail out early; the pool's destructor then joins the workers before _inFlight waits on its fences
+        _cancelled.store(true);
+    }
+
+    std::shared_ptr<Model> ModelLoader::loadAsync(const std::string& filePath) {
+        return loadAsync(filePath, Model::getRuntimeImportOptions());
+    }
+
+    std::shared_ptr<Model> ModelLoader::loadAsync(const std::string& filePath, const Model::ImportOptions& options) {
+        auto request = std::make_shared<LoadRequest>();
+        request->_model = std::make_shared<Model>(_device);
+        request->_filePath = filePath;
+        request->_options = options;
+        request->_requestTime = Clock::now();
+        ++_pendingCount;
+
+        _threadPool.enqueue([this, request]() {
+            if (_cancelled.load()) {
+                return;
+            }
+
+            parse(*request);
+
+            std::lock_guard<std::mutex> lock(_parsedLock);
+            _parsed.push_back(request);
+        });
+
+        return request->_model;
+    }
+
+    void ModelLoader::parse(LoadRequest& request) const {
+        try {
+            auto cookedFile = std::make_unique<CookedModelFile>();
+            if (cookedFile->open(CookedModelFile::getCookedPath(request._filePath))) {
+                request._cookedFile = std::move(cookedFile);
+                return;
+            }
+
+            // Parallelism comes from loading several files at once, not from splitting one import
+            Model::ImportOptions options = request._options;
+            options.threadCount = 1u;
+
+            request._builder = std::make_unique<Model::Builder>();
+            request._builder->loadModel(request._filePath, options);
+        } catch (const std::exception& e) {
+            request._builder.reset();
+            request._error = e.what();
+        }
+    }
+
+    void ModelLoader::update() {
+        for (auto it = _inFlight.begin(); it != _inFlight.end();) {
+            if (!it->_batch->isComplete()) {
+                ++it;
+                continue;
+            }
+
+            for (const auto& request : it->_requests) {
+                request->_model->_resident = true;
+                --_pendingCount;
+
+                const float loadTimeMS = std::chrono::duration<float, std::chrono::milliseconds::period>(Clock::now() - request->_requestTime).count();
+                std::cout << "Loaded model [ " << request->_filePath << " ] from " << (request->_cookedFile != nullptr ? "cooked mesh" : "source file")
+                          << " in " << loadTimeMS << " ms" << std::endl;
+            }
+            it = _inFlight.erase(it);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_parsedLock);
+            _uploadQueue.insert(_uploadQueue.end(), _parsed.begin(), _parsed.end());
+            _parsed.clear();
+        }
+
+        if (_uploadQueue.empty()) {
+            return;
+        }
+
+        InFlightBatch inFlight{};
+        inFlight._batch = std::make_unique<UploadBatch>(_device);
+        while (!_uploadQueue.empty() && inFlight._batch->getByteCount() < MAX_UPLOAD_BYTES_PER_UPDATE) {
+            std::shared_ptr<LoadRequest> request = std::move(_uploadQueue.front());
+            _uploadQueue.pop_front();
+
+            if (!request->_error.empty()) {
+                std::cerr << "Failed to load model [ " << request->_filePath << " ]: " << request->_error << std::endl;
+                --_pendingCount;
+                continue;
+            }
+
+            if (request->_cookedFile != nullptr) {
+                request->_model->upload(*request->_cookedFile, *inFlight._batch, request->_options.positionStream);
+                // The data now lives in staging memory, so the mapping (or parsed copy) can go
+                request->_cookedFile->close();
+            } else {
+                request->_model->upload(*request->_builder, *inFlight._batch, request->_options.positionStream);
+                request->_builder.reset();
+            }
+            inFlight._requests.push_back(std::move(request));
+        }
+
+        if (!inFlight._requests.empty()) {
+            inFlight._batch->submit();
+            _inFlight.push_back(std::move(inFlight));
+        }
+    }
+}; //namespace Divide
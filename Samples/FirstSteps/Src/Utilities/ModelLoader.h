@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Model.h"
+#include "ThreadPool.h"
+#include "UploadManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Divide {
+    class CookedModelFile;
+    class UploadBatch;
+
+    // Streams models in without blocking the main loop. Files are mapped/parsed on a worker pool; the GPU side
+    // (buffer creation and copies) happens on the main thread in update(), one batched submit per call, and a model
+    // only becomes resident once the fence of its batch has signalled.
+    class ModelLoader {
+    public:
+        // Staging data handed to the GPU per update() call. Whatever doesn't fit waits for the next frame.
+        // Half the staging ring, so one batch can be filled while the previous one is still in flight.
+        static constexpr VkDeviceSize MAX_UPLOAD_BYTES_PER_UPDATE = UploadManager::DEFAULT_RING_SIZE / 2u;
+
+        explicit ModelLoader(Device& device, uint32_t threadCount = 0u);
+        // Drops requests that haven't started parsing and waits for in-flight uploads
+        ~ModelLoader();
+
+        ModelLoader(const ModelLoader&) = delete;
+        ModelLoader& operator=(const ModelLoader&) = delete;
+        ModelLoader(ModelLoader&&) = delete;
+        ModelLoader& operator=(ModelLoader&&) = delete;
+
+        // Returns straight away with a model that stays non-resident (see Model::isResident) until its data is on the GPU.
+        // Loads the cooked mesh if one exists, otherwise parses the source file with 'options' (threadCount is ignored).
+        [[nodiscard]] std::shared_ptr<Model> loadAsync(const std::string& filePath);
+        [[nodiscard]] std::shared_ptr<Model> loadAsync(const std::string& filePath, const Model::ImportOptions& options);
+
+        // Call once per frame from the thread that owns the device's command pool
+        void update();
+
+        // Models requested but not yet resident (or failed)
+        [[nodiscard]] inline size_t getPendingCount() const { return _pendingCount; }
+
+    private:
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct LoadRequest {
+            std::shared_ptr<Model> _model{};
+            std::string _filePath{};
+            Model::ImportOptions _options{};
+            Clock::time_point _requestTime{};
+            // Exactly one of these is set after a successful parse
+            std::unique_ptr<CookedModelFile> _cookedFile{};
+            std::unique_ptr<Model::Builder> _builder{};
+            std::string _error{};
+        };
+
+        struct InFlightBatch {
+            std::unique_ptr<UploadBatch> _batch{};
+            std::vector<std::shared_ptr<LoadRequest>> _requests{};
+        };
+
+        void parse(LoadRequest& request) const;
+
+        Device& _device;
+
+        // Filled by the workers, drained by update()
+        std::mutex _parsedLock{};
+        std::vector<std::shared_ptr<LoadRequest>> _parsed{};
+
+        // Main thread only
+        std::deque<std::shared_ptr<LoadRequest>> _uploadQueue{};
+        std::vector<InFlightBatch> _inFlight{};
+        size_t _pendingCount = 0u;
+
+        std::atomic_bool _cancelled{ false };
+        // Declared last so the workers are joined before anything they touch is destroyed
+        ThreadPool _threadPool;
+    };
+}; //namespace Divide
@@ -0,0 +1,79 @@
+#include "ModelRegistry.h"
+#include "ModelLoader.h"
+#include "Utils.h"
+
+#include <filesystem>
+
+namespace Divide {
+
+    bool ModelRegistry::Key::operator==(const Key& other) const {
+        // threadCount only changes how an import runs, not what it produces
+        return _canonicalPath == other._canonicalPath &&
+               _options.optimize == other._options.optimize &&
+               _options.quantize == other._options.quantize &&
+               _options.lodCount == other._options.lodCount &&
+               _options.buildMeshlets == other._options.buildMeshlets &&
+               _options.positionStream == other._options.positionStream;
+    }
+
+    size_t ModelRegistry::KeyHash::operator()(const Key& key) const {
+        size_t seed = 0u;
+        hashCombine(seed, key._canonicalPath, key._options.optimize, key._options.quantize, key._options.lodCount, key._options.buildMeshlets, key._options.positionStream);
+        return seed;
+    }
+
+    ModelRegistry::ModelRegistry(ModelLoader& loader)
+        : _loader(loader)
+    {
+    }
+
+    std::shared_ptr<Model> ModelRegistry::acquire(const std::string& filePath) {
+        return acquire(filePath, Model::getRuntimeImportOptions());
+    }
+
+    std::shared_ptr<Model> ModelRegistry::acquire(const std::string& filePath, const Model::ImportOptions& options) {
+        std::error_code error{};
+        std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(filePath, error);
+        if (error) {
+            canonicalPath = std::filesystem::absolute(filePath).lexically_normal();
+        }
+
+        const Key key{ canonicalPath.string(), options };
+        std::weak_ptr<Model>& entry = _models[key];
+        if (std::shared_ptr<Model> model = entry.lock()) {
+            ++_hits;
+            return model;
+        }
+
+        ++_misses;
+        std::shared_ptr<Model> model = _loader.loadAsync(filePath, options);
+        entry = model;
+        return model;
+    }
+
+    ModelRegistry::Stats ModelRegistry::getStats() {
+        Stats stats{};
+        stats.hits = _hits;
+        stats.misses = _misses;
+
+        for (auto it = _models.begin(); it != _models.end();) {
+            const std::shared_ptr<Model> model = it->second.lock();
+            if (model == nullptr) {
+                it = _models.erase(it);
+                continue;
+            }
+
+            // Minus the local lock above
+            const uint32_t references = static_cast<uint32_t>(model.use_count() - 1);
+            const VkDeviceSize memoryUsage = model->isResident() ? model->getMemoryUsage() : 0u;
+
+            stats.liveModels += 1u;
+            stats.references += references;
+            stats.residentBytes += memoryUsage;
+            stats.savedBytes += memoryUsage * (references > 1u ? references - 1u : 0u);
+            ++it;
+        }
+
+        return stats;
+    }
+}; //namespace Divide
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Model.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Divide {
+    class ModelLoader;
+
+    // Deduplicates model loads: every request for the same file (by canonical path) and import options shares one
+    // Model and therefore one set of GPU buffers. Entries are weak, so a model's memory is released as soon as the
+    // last GameObject referencing it lets go, and a later request simply loads it again.
+    class ModelRegistry {
+    public:
+        struct Stats {
+            uint32_t hits = 0u;
+            uint32_t misses = 0u;
+            // Distinct models currently alive
+            uint32_t liveModels = 0u;
+            // Handles to those models held outside the registry
+            uint32_t references = 0u;
+            VkDeviceSize residentBytes = 0u;
+            // What the extra references would have cost as separate copies
+            VkDeviceSize savedBytes = 0u;
+        };
+
+        explicit ModelRegistry(ModelLoader& loader);
+        ~ModelRegistry() = default;
+
+        ModelRegistry(const ModelRegistry&) = delete;
+        ModelRegistry& operator=(const ModelRegistry&) = delete;
+        ModelRegistry(ModelRegistry&&) = delete;
+        ModelRegistry& operator=(ModelRegistry&&) = delete;
+
+        // Shared handle to the model; starts an async load through the ModelLoader on a miss
+        [[nodiscard]] std::shared_ptr<Model> acquire(const std::string& filePath);
+        [[nodiscard]] std::shared_ptr<Model> acquire(const std::string& filePath, const Model::ImportOptions& options);
+
+        // Also forgets entries whose model has been released
+        [[nodiscard]] Stats getStats();
+
+    private:
+        struct Key {
+            std::string _canonicalPath{};
+            Model::ImportOptions _options{};
+
+            bool operator==(const Key& other) const;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key& key) const;
+        };
+
+        ModelLoader& _loader;
+        std::unordered_map<Key, std::weak_ptr<Model>, KeyHash> _models{};
+        uint32_t _hits = 0u;
+        uint32_t _misses = 0u;
+    };
+}; //namespace Divide
@@ -0,0 +1,426 @@
+#include "OcclusionRasterizer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_RASTER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace Divide {
+
+    namespace {
+        constexpr float CLEAR_DEPTH = 1.f;
+        // Pixel centres of a 4 pixel group, relative to the group's first pixel. Both paths add these to the same base
+        // so they round identically.
+        constexpr float LANE_CENTRES[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+
+        uint32_t roundUp(const uint32_t value, const uint32_t multiple) {
+            return (std::max(value, 1u) + multiple - 1u) / multiple * multiple;
+        }
+
+        // Coverage and depth of one triangle over 4 pixel groups [beginX, endX) of a row. Written with the comparisons
+        // and min() operand order of the SSE path.
+        void rasterizeRowScalar(float* row, const uint32_t beginX, const uint32_t endX, const float (&edgeA)[3], const float (&rowEdge)[3],
+                                const float depthX, const float rowDepth, const float maxDepth) {
+            for (uint32_t groupX = beginX; groupX < endX; groupX += 4u) {
+                for (uint32_t lane = 0u; lane < 4u; ++lane) {
+                    const float centreX = static_cast<float>(groupX) + LANE_CENTRES[lane];
+                    const bool covered = edgeA[0] * centreX + rowEdge[0] >= 0.f &&
+                                         edgeA[1] * centreX + rowEdge[1] >= 0.f &&
+                                         edgeA[2] * centreX + rowEdge[2] >= 0.f;
+                    const float planeDepth = depthX * centreX + rowDepth;
+                    const float depth = planeDepth < maxDepth ? planeDepth : maxDepth;
+                    float& pixel = row[groupX + lane];
+                    pixel = covered ? (pixel < depth ? pixel : depth) : pixel;
+                }
+            }
+        }
+
+        // True if anything in [beginX, endX) of the row is at or behind 'nearest'
+        bool isRowVisibleScalar(const float* row, const uint32_t beginX, const uint32_t endX, const float nearest) {
+            for (uint32_t x = beginX; x < endX; ++x) {
+                if (!(nearest > row[x])) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+#if defined(OCCLUSION_RASTER_SSE)
+        void rasterizeRowSSE(float* row, const uint32_t beginX, const uint32_t endX, const float (&edgeA)[3], const float (&rowEdge)[3],
+                             const float depthX, const float rowDepth, const float maxDepth) {
+            const __m128 lanes = _mm_loadu_ps(LANE_CENTRES);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 a0 = _mm_set1_ps(edgeA[0]);
+            const __m128 a1 = _mm_set1_ps(edgeA[1]);
+            const __m128 a2 = _mm_set1_ps(edgeA[2]);
+            const __m128 e0 = _mm_set1_ps(rowEdge[0]);
+            const __m128 e1 = _mm_set1_ps(rowEdge[1]);
+            const __m128 e2 = _mm_set1_ps(rowEdge[2]);
+            const __m128 dx = _mm_set1_ps(depthX);
+            const __m128 dRow = _mm_set1_ps(rowDepth);
+            const __m128 dMax = _mm_set1_ps(maxDepth);
+
+            for (uint32_t groupX = beginX; groupX < endX; groupX += 4u) {
+                const __m128 centreX = _mm_add_ps(_mm_set1_ps(static_cast<float>(groupX)), lanes);
+                const __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centreX), e0), zero),
+                                                             _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centreX), e1), zero)),
+                                                  _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centreX), e2), zero));
+                const __m128 depth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(dx, centreX), dRow), dMax);
+                const __m128 pixels = _mm_loadu_ps(row + groupX);
+                const __m128 closest = _mm_min_ps(pixels, depth);
+                _mm_storeu_ps(row + groupX, _mm_or_ps(_mm_and_ps(covered, closest), _mm_andnot_ps(covered, pixels)));
+            }
+        }
+
+        bool isRowVisibleSSE(const float* row, const uint32_t beginX, const uint32_t endX, const float nearest) {
+            const __m128 nearestV = _mm_set1_ps(nearest);
+            uint32_t x = beginX;
+            for (; x + 4u <= endX; x += 4u) {
+                if (_mm_movemask_ps(_mm_cmpngt_ps(nearestV, _mm_loadu_ps(row + x))) != 0) {
+                    return true;
+                }
+            }
+            return isRowVisibleScalar(row, x, endX, nearest);
+        }
+#endif
+    };
+
+    OcclusionRasterizer::Path OcclusionRasterizer::getBestPath() {
+#if defined(OCCLUSION_RASTER_SSE)
+        return Path::SSE;
+#else
+        return Path::SCALAR;
+#endif
+    }
+
+    bool OcclusionRasterizer::isSupported(const Path path) {
+        switch (path) {
+            case Path::SCALAR: return true;
+#if defined(OCCLUSION_RASTER_SSE)
+            case Path::SSE: return true;
+#endif
+            default: break;
+        }
+        return false;
+    }
+
+    const char* OcclusionRasterizer::getPathName(const Path path) {
+        switch (path) {
+            case Path::SCALAR: return "scalar";
+            case Path::SSE: return "SSE";
+            default: break;
+        }
+        return "unknown";
+    }
+
+    OcclusionRasterizer::OcclusionRasterizer(const uint32_t width, const uint32_t height, const uint32_t threadCount)
+        : _width{ roundUp(width, TILE_WIDTH) }
+        , _height{ roundUp(height, TILE_HEIGHT) }
+        , _tilesX{ _width / TILE_WIDTH }
+        , _tilesY{ _height / TILE_HEIGHT }
+    {
+        _depth.assign(size_t{ _width } * _height, CLEAR_DEPTH);
+        _tileMaxDepth.assign(size_t{ _tilesX } * _tilesY, CLEAR_DEPTH);
+        _bins.resize(size_t{ _tilesX } * _tilesY);
+
+        const uint32_t totalThreads = threadCount > 0u ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+        if (totalThreads > 1u) {
+            _threadPoolPtr = std::make_unique<ThreadPool>(totalThreads - 1u);
+        }
+    }
+
+    OcclusionRasterizer::~OcclusionRasterizer()
+    {
+    }
+
+    uint32_t OcclusionRasterizer::getThreadCount() const {
+        return _threadPoolPtr != nullptr ? static_cast<uint32_t>(_threadPoolPtr->getThreadCount()) + 1u : 1u;
+    }
+
+    void OcclusionRasterizer::beginFrame(const glm::mat4& viewProjection) {
+        _viewProjection = viewProjection;
+        _triangles.clear();
+        for (std::vector<uint32_t>& bin : _bins) {
+            bin.clear();
+        }
+        _stats = {};
+    }
+
+    void OcclusionRasterizer::addOccluder(const glm::mat4& modelMatrix, const glm::vec3* positions, const uint32_t* indices, const uint32_t indexCount) {
+        _stats.occluders += 1u;
+
+        const glm::mat4 modelViewProjection = _viewProjection * modelMatrix;
+        for (uint32_t i = 0u; i + 2u < indexCount; i += 3u) {
+            _stats.triangles += 1u;
+
+            const std::array<glm::vec4, 3> vertices{
+                modelViewProjection * glm::vec4{ positions[indices[i + 0u]], 1.f },
+                modelViewProjection * glm::vec4{ positions[indices[i + 1u]], 1.f },
+                modelViewProjection * glm::vec4{ positions[indices[i + 2u]], 1.f }
+            };
+
+            // Only the near plane (z >= 0) is clipped against. The others are handled by clamping to the screen.
+            const bool inside[3] = { vertices[0].z >= 0.f, vertices[1].z >= 0.f, vertices[2].z >= 0.f };
+            if (inside[0] && inside[1] && inside[2]) {
+                setupTriangle(vertices[0], vertices[1], vertices[2]);
+                continue;
+            }
+            if (!inside[0] && !inside[1] && !inside[2]) {
+                continue;
+            }
+
+            // One plane turns a triangle into at most a quad
+            std::array<glm::vec4, 4> polygon{};
+            uint32_t vertexCount = 0u;
+            for (uint32_t edge = 0u; edge < 3u; ++edge) {
+                const uint32_t next = (edge + 1u) % 3u;
+                if (inside[edge]) {
+                    polygon[vertexCount++] = vertices[edge];
+                }
+                if (inside[edge] != inside[next]) {
+                    const float t = vertices[edge].z / (vertices[edge].z - vertices[next].z);
+                    polygon[vertexCount++] = vertices[edge] + (vertices[next] - vertices[edge]) * t;
+                }
+            }
+            for (uint32_t v = 1u; v + 1u < vertexCount; ++v) {
+                setupTriangle(polygon[0], polygon[v], polygon[v + 1u]);
+            }
+        }
+    }
+
+    void OcclusionRasterizer::setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2) {
+        if (!(v0.w > 0.f) || !(v1.w > 0.f) || !(v2.w > 0.f)) {
+            return;
+        }
+
+        const auto toScreen = [this](const glm::vec4& v) {
+            const float invW = 1.f / v.w;
+            return glm::vec3{ (v.x * invW * 0.5f + 0.5f) * _width, (v.y * invW * 0.5f + 0.5f) * _height, v.z * invW };
+        };
+        std::array<glm::vec3, 3> p{ toScreen(v0), toScreen(v1), toScreen(v2) };
+
+        // Either winding: occluders are rasterised double sided
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if (!(std::abs(area) > 0.f)) {
+            return;
+        }
+        if (area < 0.f) {
+            std::swap(p[1], p[2]);
+            area = -area;
+        }
+
+        const float minX = std::max(std::floor(std::min({ p[0].x, p[1].x, p[2].x })), 0.f);
+        const float minY = std::max(std::floor(std::min({ p[0].y, p[1].y, p[2].y })), 0.f);
+        const float maxX = std::min(std::ceil(std::max({ p[0].x, p[1].x, p[2].x })), static_cast<float>(_width));
+        const float maxY = std::min(std::ceil(std::max({ p[0].y, p[1].y, p[2].y })), static_cast<float>(_height));
+        if (!(minX < maxX) || !(minY < maxY)) {
+            return;
+        }
+
+        Triangle triangle{};
+        triangle.minX = static_cast<uint32_t>(minX);
+        triangle.minY = static_cast<uint32_t>(minY);
+        triangle.maxX = static_cast<uint32_t>(maxX);
+        triangle.maxY = static_cast<uint32_t>(maxY);
+
+        // Shifting every edge inwards by half the pixel's extent along its normal keeps only fully covered pixels
+        for (uint32_t edge = 0u; edge < 3u; ++edge) {
+            const glm::vec3& a = p[edge];
+            const glm::vec3& b = p[(edge + 1u) % 3u];
+            triangle.edgeA[edge] = a.y - b.y;
+            triangle.edgeB[edge] = b.x - a.x;
+            triangle.edgeC[edge] = a.x * b.y - b.x * a.y - 0.5f * (std::abs(triangle.edgeA[edge]) + std::abs(triangle.edgeB[edge]));
+        }
+
+        // Depth is linear in screen space. Moving half a pixel from the centre along both gradients gives the farthest
+        // depth within the pixel, and no point of the triangle is farther than its farthest vertex.
+        const float invArea = 1.f / area;
+        triangle.depthX = ((p[1].z - p[0].z) * (p[2].y - p[0].y) - (p[2].z - p[0].z) * (p[1].y - p[0].y)) * invArea;
+        triangle.depthY = ((p[1].x - p[0].x) * (p[2].z - p[0].z) - (p[2].x - p[0].x) * (p[1].z - p[0].z)) * invArea;
+        triangle.depthC = p[0].z - triangle.depthX * p[0].x - triangle.depthY * p[0].y + 0.5f * (std::abs(triangle.depthX) + std::abs(triangle.depthY));
+        triangle.maxDepth = std::max({ p[0].z, p[1].z, p[2].z });
+
+        const uint32_t index = static_cast<uint32_t>(_triangles.size());
+        _triangles.push_back(triangle);
+        _stats.rasterizedTriangles += 1u;
+
+        for (uint32_t tileY = triangle.minY / TILE_HEIGHT; tileY <= (triangle.maxY - 1u) / TILE_HEIGHT; ++tileY) {
+            for (uint32_t tileX = triangle.minX / TILE_WIDTH; tileX <= (triangle.maxX - 1u) / TILE_WIDTH; ++tileX) {
+                _bins[tileY * _tilesX + tileX].push_back(index);
+                _stats.binnedTriangles += 1u;
+            }
+        }
+    }
+
+    void OcclusionRasterizer::rasterize(const Path path) {
+        assert(isSupported(path) && "Rasterisation path not available in this build");
+
+        const uint32_t tileCount = _tilesX * _tilesY;
+        _nextTile.store(0u);
+        // Tiles are handed out one at a time, so threads that get cheap tiles pick up more of them
+        const auto work = [this, path, tileCount]() {
+            for (uint32_t tile = _nextTile.fetch_add(1u); tile < tileCount; tile = _nextTile.fetch_add(1u)) {
+                rasterizeTile(tile, path);
+            }
+        };
+
+        if (_threadPoolPtr == nullptr) {
+            work();
+            return;
+        }
+
+        const uint32_t helperCount = std::min(static_cast<uint32_t>(_threadPoolPtr->getThreadCount()), tileCount - 1u);
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _pendingWorkers = helperCount;
+        }
+        for (uint32_t i = 0u; i < helperCount; ++i) {
+            _threadPoolPtr->enqueue([this, work]() {
+                work();
+                // Notified under the lock so the waiting thread can't return (and destroy us) mid-notify
+                std::lock_guard<std::mutex> lock(_lock);
+                _pendingWorkers -= 1u;
+                _condition.notify_one();
+            });
+        }
+
+        work();
+
+        std::unique_lock<std::mutex> lock(_lock);
+        _condition.wait(lock, [this]() { return _pendingWorkers == 0u; });
+    }
+
+    void OcclusionRasterizer::rasterizeTile(const uint32_t tile, const Path path) {
+        const uint32_t tileMinX = (tile % _tilesX) * TILE_WIDTH;
+        const uint32_t tileMinY = (tile / _tilesX) * TILE_HEIGHT;
+        const uint32_t tileMaxX = tileMinX + TILE_WIDTH;
+        const uint32_t tileMaxY = tileMinY + TILE_HEIGHT;
+
+        for (uint32_t y = tileMinY; y < tileMaxY; ++y) {
+            std::fill_n(_depth.begin() + size_t{ y } * _width + tileMinX, TILE_WIDTH, CLEAR_DEPTH);
+        }
+
+        for (const uint32_t index : _bins[tile]) {
+            const Triangle& triangle = _triangles[index];
+
+            // Whole 4 pixel groups: tiles are multiples of 4 wide, and the edge tests reject the extra pixels
+            const uint32_t beginX = std::max(triangle.minX, tileMinX) & ~3u;
+            const uint32_t endX = (std::min(triangle.maxX, tileMaxX) + 3u) & ~3u;
+            const uint32_t beginY = std::max(triangle.minY, tileMinY);
+            const uint32_t endY = std::min(triangle.maxY, tileMaxY);
+
+            for (uint32_t y = beginY; y < endY; ++y) {
+                const float centreY = static_cast<float>(y) + 0.5f;
+                const float rowEdge[3] = {
+                    triangle.edgeB[0] * centreY + triangle.edgeC[0],
+                    triangle.edgeB[1] * centreY + triangle.edgeC[1],
+                    triangle.edgeB[2] * centreY + triangle.edgeC[2]
+                };
+                const float rowDepth = triangle.depthY * centreY + triangle.depthC;
+                float* row = _depth.data() + size_t{ y } * _width;
+
+                switch (path) {
+#if defined(OCCLUSION_RASTER_SSE)
+                    case Path::SSE:
+                        rasterizeRowSSE(row, beginX, endX, triangle.edgeA, rowEdge, triangle.depthX, rowDepth, triangle.maxDepth);
+                        break;
+#endif
+                    default:
+                        rasterizeRowScalar(row, beginX, endX, triangle.edgeA, rowEdge, triangle.depthX, rowDepth, triangle.maxDepth);
+                        break;
+                }
+            }
+        }
+
+        float maxDepth = 0.f;
+        for (uint32_t y = tileMinY; y < tileMaxY; ++y) {
+            const auto rowBegin = _depth.cbegin() + size_t{ y } * _width + tileMinX;
+            maxDepth = std::max(maxDepth, *std::max_element(rowBegin, rowBegin + TILE_WIDTH));
+        }
+        _tileMaxDepth[tile] = maxDepth;
+    }
+
+    bool OcclusionRasterizer::isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelMatrix, const Path path) const {
+        assert(isSupported(path) && "Rasterisation path not available in this build");
+
+        // Screen rectangle and closest depth of the box's corners
+        const glm::mat4 modelViewProjection = _viewProjection * modelMatrix;
+        float minX = std::numeric_limits<float>::max();
+        float minY = std::numeric_limits<float>::max();
+        float maxX = std::numeric_limits<float>::lowest();
+        float maxY = std::numeric_limits<float>::lowest();
+        float nearest = std::numeric_limits<float>::max();
+        for (uint32_t corner = 0u; corner < 8u; ++corner) {
+            const glm::vec4 position{ (corner & 1u) ? boundsMax.x : boundsMin.x,
+                                      (corner & 2u) ? boundsMax.y : boundsMin.y,
+                                      (corner & 4u) ? boundsMax.z : boundsMin.z,
+                                      1.f };
+            const glm::vec4 clip = modelViewProjection * position;
+            if (!(clip.z >= 0.f) || !(clip.w > 0.f)) {
+                return false;
+            }
+
+            const float invW = 1.f / clip.w;
+            const float x = (clip.x * invW * 0.5f + 0.5f) * _width;
+            const float y = (clip.y * invW * 0.5f + 0.5f) * _height;
+            minX = std::min(minX, x);
+            minY = std::min(minY, y);
+            maxX = std::max(maxX, x);
+            maxY = std::max(maxY, y);
+            nearest = std::min(nearest, clip.z * invW);
+        }
+
+        // Every pixel the rectangle touches, not just the ones whose centres it covers
+        const float beginXf = std::max(std::floor(minX), 0.f);
+        const float beginYf = std::max(std::floor(minY), 0.f);
+        const float endXf = std::min(std::ceil(maxX), static_cast<float>(_width));
+        const float endYf = std::min(std::ceil(maxY), static_cast<float>(_height));
+        if (!(beginXf < endXf) || !(beginYf < endYf)) {
+            // Off screen is the frustum test's business
+            return false;
+        }
+        const uint32_t beginX = static_cast<uint32_t>(beginXf);
+        const uint32_t beginY = static_cast<uint32_t>(beginYf);
+        const uint32_t endX = static_cast<uint32_t>(endXf);
+        const uint32_t endY = static_cast<uint32_t>(endYf);
+
+        for (uint32_t tileY = beginY / TILE_HEIGHT; tileY <= (endY - 1u) / TILE_HEIGHT; ++tileY) {
+            for (uint32_t tileX = beginX / TILE_WIDTH; tileX <= (endX - 1u) / TILE_WIDTH; ++tileX) {
+                // Behind everything in the tile
+                if (nearest > _tileMaxDepth[tileY * _tilesX + tileX]) {
+                    continue;
+                }
+
+                const uint32_t rowBegin = std::max(beginX, tileX * TILE_WIDTH);
+                const uint32_t rowEnd = std::min(endX, (tileX + 1u) * TILE_WIDTH);
+                for (uint32_t y = std::max(beginY, tileY * TILE_HEIGHT); y < std::min(endY, (tileY + 1u) * TILE_HEIGHT); ++y) {
+                    const float* row = _depth.data() + size_t{ y } * _width;
+                    bool visible = false;
+                    switch (path) {
+#if defined(OCCLUSION_RASTER_SSE)
+                        case Path::SSE:
+                            visible = isRowVisibleSSE(row, rowBegin, rowEnd, nearest);
+                            break;
+#endif
+                        default:
+                            visible = isRowVisibleScalar(row, rowBegin, rowEnd, nearest);
+                            break;
+                    }
+                    if (visible) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+}; //namespace Divide
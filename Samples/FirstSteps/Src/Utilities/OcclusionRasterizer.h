@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Camera.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Divide {
+    class ThreadPool;
+
+    // CPU occlusion culling, for when GPU culling (GpuCullingSystem) isn't available or the GPU is the bottleneck.
+    // Designated occluders are rasterised into a small depth buffer, tile by tile across threads, and candidate bounding
+    // boxes are tested against it before any commands are recorded.
+    //
+    // Rasterisation is inner-conservative: a pixel only takes an occluder's depth if the triangle covers all of it, and
+    // it takes the farthest depth the triangle reaches within the pixel. A box is occluded only if every pixel it
+    // touches holds something strictly closer than the box's closest point, so visible objects are never rejected.
+    // Occluders thinner than a pixel simply don't register. Depth is z / w of Camera's [0, 1] projection.
+    //
+    // Rows are processed 4 pixels at a time with SSE when the build has it, or by a scalar loop. Both paths produce
+    // exactly the same depth buffer and results.
+    class OcclusionRasterizer {
+    public:
+        enum class Path : uint8_t {
+            SCALAR = 0,
+            SSE,
+            COUNT
+        };
+
+        // Every tile is rasterised by one thread, from its own list of triangles
+        static constexpr uint32_t TILE_WIDTH = 32u;
+        static constexpr uint32_t TILE_HEIGHT = 16u;
+
+        struct Stats {
+            // Since the last beginFrame()
+            uint32_t occluders = 0u;
+            uint32_t triangles = 0u;
+            // Triangles left after near plane clipping, minus degenerate and off screen ones
+            uint32_t rasterizedTriangles = 0u;
+            // Sum of every tile's triangle list
+            uint32_t binnedTriangles = 0u;
+        };
+
+        // Widest path this build was compiled for
+        [[nodiscard]] static Path getBestPath();
+        [[nodiscard]] static bool isSupported(Path path);
+        [[nodiscard]] static const char* getPathName(Path path);
+
+        // The resolution is rounded up to whole tiles. 'threadCount' threads rasterise, including the calling one:
+        // 0 picks the hardware concurrency, 1 rasterises on the calling thread only.
+        OcclusionRasterizer(uint32_t width, uint32_t height, uint32_t threadCount = 0u);
+        ~OcclusionRasterizer();
+
+        OcclusionRasterizer(const OcclusionRasterizer&) = delete;
+        OcclusionRasterizer& operator=(const OcclusionRasterizer&) = delete;
+        OcclusionRasterizer(OcclusionRasterizer&&) = delete;
+        OcclusionRasterizer& operator=(OcclusionRasterizer&&) = delete;
+
+        // Forgets the previous frame's occluders. 'viewProjection' is Camera::getProjection() * Camera::getView().
+        void beginFrame(const glm::mat4& viewProjection);
+        // Transforms, clips and bins a triangle list (model space positions, e.g. Model::getOccluderMesh())
+        void addOccluder(const glm::mat4& modelMatrix, const glm::vec3* positions, const uint32_t* indices, uint32_t indexCount);
+        // Clears the depth buffer and rasterises every occluder added since beginFrame(). Returns once all tiles are done.
+        void rasterize() { rasterize(getBestPath()); }
+        void rasterize(Path path);
+
+        // True if the model space box, transformed by 'modelMatrix', is hidden by the occluders. Boxes crossing the near
+        // plane never are. Call after rasterize(); safe to call from several threads at once.
+        [[nodiscard]] bool isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelMatrix) const { return isOccluded(boundsMin, boundsMax, modelMatrix, getBestPath()); }
+        [[nodiscard]] bool isOccluded(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& modelMatrix, Path path) const;
+
+        [[nodiscard]] inline uint32_t getWidth() const { return _width; }
+        [[nodiscard]] inline uint32_t getHeight() const { return _height; }
+        // Row major, _width * _height, 1 where nothing was drawn
+        [[nodiscard]] inline const std::vector<float>& getDepthBuffer() const { return _depth; }
+        [[nodiscard]] inline const Stats& getStats() const { return _stats; }
+        // Threads rasterize() uses, including the calling one
+        [[nodiscard]] uint32_t getThreadCount() const;
+
+    private:
+        // Screen space setup of a clipped triangle: coverage is A * x + B * y + C >= 0 for all three edges at the pixel
+        // centre, with C already biased by half a pixel's extent. Depth is Dx * x + Dy * y + Dc, clamped to maxDepth.
+        struct Triangle {
+            float edgeA[3]{};
+            float edgeB[3]{};
+            float edgeC[3]{};
+            float depthX = 0.f;
+            float depthY = 0.f;
+            float depthC = 0.f;
+            float maxDepth = 0.f;
+            // Pixel bounds, [min, max)
+            uint32_t minX = 0u;
+            uint32_t minY = 0u;
+            uint32_t maxX = 0u;
+            uint32_t maxY = 0u;
+        };
+
+        // Clip space triangle, in front of the near plane
+        void setupTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+        void rasterizeTile(uint32_t tile, Path path);
+
+        uint32_t _width = 0u;
+        uint32_t _height = 0u;
+        uint32_t _tilesX = 0u;
+        uint32_t _tilesY = 0u;
+        glm::mat4 _viewProjection{ 1.f };
+
+        std::vector<float> _depth{};
+        // Farthest depth in each tile, so tests can skip tiles the box is entirely behind
+        std::vector<float> _tileMaxDepth{};
+        std::vector<Triangle> _triangles{};
+        // Per tile indices into _triangles. Kept across frames so steady state frames don't allocate.
+        std::vector<std::vector<uint32_t>> _bins{};
+
+        // Null when rasterising on the calling thread only
+        std::unique_ptr<ThreadPool> _threadPoolPtr{};
+        std::atomic<uint32_t> _nextTile{ 0u };
+        std::mutex _lock{};
+        std::condition_variable _condition{};
+        uint32_t _pendingWorkers = 0u;
+
+        Stats _stats{};
+    };
+}; //namespace Divide
@@ -45,10 +45,13 @@ namespace Divide {
         assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
         auto vertCode = readFile(vertFile);
-        auto fragCode = readFile(fragFile);
-
-        createShaderModule(vertCode, &_vertShaderModule);
-        createShaderModule(fragCode, &_fragShaderModule);
+        createShaderModule(_device, vertCode, &_vertShaderModule);
+        // Depth only pipelines don't need a fragment stage at all
+        const bool hasFragmentStage = !fragFile.empty();
+        if (hasFragmentStage) {
+            auto fragCode = readFile(fragFile);
+            createShaderModule(_device, fragCode, &_fragShaderModule);
+        }
 
         VkPipelineShaderStageCreateInfo shaderStages[2];
         shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -77,12 +80,14 @@ namespace Divide {
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
         vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+        const std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(configInfo.colorAttachmentCount, configInfo.colorBlendAttachment);
+
         VkPipelineColorBlendStateCreateInfo colorBlendInfo{};
         colorBlendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlendInfo.logicOpEnable = VK_FALSE;
         colorBlendInfo.logicOp = VK_LOGIC_OP_COPY;
-        colorBlendInfo.attachmentCount = 1;
-        colorBlendInfo.pAttachments = &configInfo.colorBlendAttachment;
+        colorBlendInfo.attachmentCount = static_cast<uint32_t>(colorBlendAttachments.size());
+        colorBlendInfo.pAttachments = colorBlendAttachments.data();
         colorBlendInfo.blendConstants[0] = 0.f;
         colorBlendInfo.blendConstants[1] = 0.f;
         colorBlendInfo.blendConstants[2] = 0.f;
@@ -90,7 +95,7 @@ namespace Divide {
 
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
+        pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
         pipelineInfo.pStages = shaderStages;
         pipelineInfo.pVertexInputState = &vertexInputInfo;
         pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -113,13 +118,13 @@ namespace Divide {
         }
     }
 
-    void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
+    void Pipeline::createShaderModule(Device& device, const std::vector<char>& code, VkShaderModule* shaderModule) {
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
         createInfo.codeSize = code.size();
         createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
-        if (vkCreateShaderModule(_device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
+        if (vkCreateShaderModule(device.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
             throw std::runtime_error("Faile to create shader module!");
         }
     }
@@ -184,4 +189,39 @@ namespace Divide {
         configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
         configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
     }
+
+    ComputePipeline::ComputePipeline(Device& device, const std::string& compFile, VkPipelineLayout pipelineLayout)
+        : _device(device)
+    {
+        assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+        Pipeline::createShaderModule(_device, Pipeline::readFile(compFile), &_compShaderModule);
+
+        VkPipelineShaderStageCreateInfo shaderStage{};
+        shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStage.module = _compShaderModule;
+        shaderStage.pName = "main";
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = shaderStage;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        if (vkCreateComputePipelines(_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_computePipeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute pipeline!");
+        }
+    }
+
+    ComputePipeline::~ComputePipeline()
+    {
+        vkDestroyShaderModule(_device.device(), _compShaderModule, nullptr);
+        vkDestroyPipeline(_device.device(), _computePipeline, nullptr);
+    }
+
+    void ComputePipeline::bind(VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipeline);
+    }
 };
\ No newline at end of file
@@ -18,6 +18,8 @@ namespace Divide {
         VkPipelineRasterizationStateCreateInfo rasterizationInfo{};
         VkPipelineMultisampleStateCreateInfo multisampleInfo{};
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        // The subpass's colour attachments, all blended with colorBlendAttachment
+        uint32_t colorAttachmentCount = 1u;
         VkPipelineDepthStencilStateCreateInfo depthStencilInfo{};
 
         std::vector<VkDynamicState> dynamicStateEnables;
@@ -31,6 +33,7 @@ namespace Divide {
     class Pipeline {
     public:
         Pipeline() = default;
+        // An empty 'fragFile' creates a pipeline without a fragment stage, e.g. for depth only passes
         Pipeline(Device& device, const std::string& vertFile, const std::string& fragFile, const PipelineConfigInfo& configInfo);
         ~Pipeline();
 
@@ -43,14 +46,39 @@ namespace Divide {
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 
     private:
+        friend class ComputePipeline;
+
         static std::vector<char> readFile(const std::string& filePath);
+        static void createShaderModule(Device& device, const std::vector<char>& code, VkShaderModule* shaderModule);
 
         void createGraphicsPipeline(const std::string& vertFile, const std::string& fragFile, const PipelineConfigInfo& configInfo);
-        void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
         Device& _device;
         VkPipeline _graphicsPipeline;
         VkShaderModule _vertShaderModule;
-        VkShaderModule _fragShaderModule;
+        VkShaderModule _fragShaderModule = VK_NULL_HANDLE;
+    };
+
+    // A single compute shader. Unlike graphics pipelines there's no config beyond the layout.
+    class ComputePipeline {
+    public:
+        ComputePipeline(Device& device, const std::string& compFile, VkPipelineLayout pipelineLayout);
+        ~ComputePipeline();
+
+        ComputePipeline(const ComputePipeline&) = delete;
+        ComputePipeline& operator=(const ComputePipeline&) = delete;
+        ComputePipeline(ComputePipeline&&) = delete;
+        ComputePipeline& operator=(ComputePipeline&&) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+        // Workgroups of 'groupSize' invocations needed to cover 'invocationCount'
+        [[nodiscard]] static inline uint32_t getGroupCount(const uint32_t invocationCount, const uint32_t groupSize) {
+            return (invocationCount + groupSize - 1u) / groupSize;
+        }
+
+    private:
+        Device& _device;
+        VkPipeline _computePipeline;
+        VkShaderModule _compShaderModule;
     };
 }; //namespace Divide
\ No newline at end of file
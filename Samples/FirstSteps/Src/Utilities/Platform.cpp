@@ -0,0 +1,139 @@
+#include "Platform.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Divide {
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+#if defined(_WIN32)
+    bool MappedFile::open(const std::string& filePath) {
+        close();
+
+        HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        _fileHandle = file;
+        _mappingHandle = mapping;
+        _data = static_cast<const std::byte*>(view);
+        _size = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (_data != nullptr) {
+            UnmapViewOfFile(_data);
+            _data = nullptr;
+        }
+        if (_mappingHandle != nullptr) {
+            CloseHandle(_mappingHandle);
+            _mappingHandle = nullptr;
+        }
+        if (_fileHandle != nullptr) {
+            CloseHandle(_fileHandle);
+            _fileHandle = nullptr;
+        }
+        _size = 0u;
+    }
+
+    size_t getPeakResidentMemory() {
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return static_cast<size_t>(counters.PeakWorkingSetSize);
+        }
+
+        return 0u;
+    }
+#else
+    bool MappedFile::open(const std::string& filePath) {
+        close();
+
+        const int fd = ::open(filePath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat fileStat{};
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+
+        // We stream the whole file into a staging buffer right away
+        madvise(view, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+
+        _fileDescriptor = fd;
+        _data = static_cast<const std::byte*>(view);
+        _size = static_cast<size_t>(fileStat.st_size);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (_data != nullptr) {
+            munmap(const_cast<std::byte*>(_data), _size);
+            _data = nullptr;
+        }
+        if (_fileDescriptor >= 0) {
+            ::close(_fileDescriptor);
+            _fileDescriptor = -1;
+        }
+        _size = 0u;
+    }
+
+    size_t getPeakResidentMemory() {
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+            return static_cast<size_t>(usage.ru_maxrss);
+#else
+            return static_cast<size_t>(usage.ru_maxrss) * 1024u;
+#endif
+        }
+
+        return 0u;
+    }
+#endif
+}; //namespace Divide
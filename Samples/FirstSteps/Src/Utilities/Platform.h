@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Divide {
+    // Read-only memory mapping of a whole file. The mapping stays valid until close() or destruction.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&&) = delete;
+        MappedFile& operator=(MappedFile&&) = delete;
+
+        [[nodiscard]] bool open(const std::string& filePath);
+        void close();
+
+        [[nodiscard]] inline bool isOpen() const { return _data != nullptr; }
+        [[nodiscard]] inline const std::byte* data() const { return _data; }
+        [[nodiscard]] inline size_t size() const { return _size; }
+
+    private:
+        const std::byte* _data = nullptr;
+        size_t _size = 0u;
+
+#if defined(_WIN32)
+        void* _fileHandle = nullptr;
+        void* _mappingHandle = nullptr;
+#else
+        int _fileDescriptor = -1;
+#endif
+    };
+
+    // Peak resident set size of the current process in bytes (0 if the platform can't report it)
+    [[nodiscard]] size_t getPeakResidentMemory();
+}; //namespace Divide
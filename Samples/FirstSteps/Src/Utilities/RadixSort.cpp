@@ -0,0 +1,91 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace Divide {
+
+    namespace {
+        constexpr uint32_t DIGIT_BITS = 8u;
+        constexpr uint32_t BUCKET_COUNT = 1u << DIGIT_BITS;
+        constexpr uint32_t PASS_COUNT = 64u / DIGIT_BITS;
+
+        void insertionSort(uint64_t* keys, uint32_t* values, const uint32_t count) {
+            for (uint32_t i = 1u; i < count; ++i) {
+                const uint64_t key = keys[i];
+                const uint32_t value = values != nullptr ? values[i] : 0u;
+                uint32_t j = i;
+                for (; j > 0u && keys[j - 1u] > key; --j) {
+                    keys[j] = keys[j - 1u];
+                    if (values != nullptr) {
+                        values[j] = values[j - 1u];
+                    }
+                }
+                keys[j] = key;
+                if (values != nullptr) {
+                    values[j] = value;
+                }
+            }
+        }
+    };
+
+    void RadixSort::sort(uint64_t* keys, uint32_t* values, const uint32_t count) {
+        if (count < INSERTION_SORT_THRESHOLD) {
+            insertionSort(keys, values, count);
+            return;
+        }
+
+        // Every pass's histogram in one read of the keys
+        std::array<std::array<uint32_t, BUCKET_COUNT>, PASS_COUNT> histograms{};
+        for (uint32_t i = 0u; i < count; ++i) {
+            const uint64_t key = keys[i];
+            for (uint32_t pass = 0u; pass < PASS_COUNT; ++pass) {
+                ++histograms[pass][(key >> (pass * DIGIT_BITS)) & (BUCKET_COUNT - 1u)];
+            }
+        }
+
+        _keyScratch.resize(count);
+        if (values != nullptr) {
+            _valueScratch.resize(count);
+        }
+
+        uint64_t* srcKeys = keys;
+        uint64_t* dstKeys = _keyScratch.data();
+        uint32_t* srcValues = values;
+        uint32_t* dstValues = values != nullptr ? _valueScratch.data() : nullptr;
+        for (uint32_t pass = 0u; pass < PASS_COUNT; ++pass) {
+            std::array<uint32_t, BUCKET_COUNT>& histogram = histograms[pass];
+            const uint32_t shift = pass * DIGIT_BITS;
+            // Every key has the same digit: the pass wouldn't move anything
+            if (histogram[(srcKeys[0] >> shift) & (BUCKET_COUNT - 1u)] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0u;
+            for (uint32_t& bucket : histogram) {
+                const uint32_t bucketCount = bucket;
+                bucket = offset;
+                offset += bucketCount;
+            }
+
+            for (uint32_t i = 0u; i < count; ++i) {
+                const uint32_t target = histogram[(srcKeys[i] >> shift) & (BUCKET_COUNT - 1u)]++;
+                dstKeys[target] = srcKeys[i];
+                if (srcValues != nullptr) {
+                    dstValues[target] = srcValues[i];
+                }
+            }
+            std::swap(srcKeys, dstKeys);
+            std::swap(srcValues, dstValues);
+        }
+
+        // An odd number of passes ran: the result is in the scratch buffers
+        if (srcKeys != keys) {
+            std::memcpy(keys, srcKeys, sizeof(uint64_t) * count);
+            if (values != nullptr) {
+                std::memcpy(values, srcValues, sizeof(uint32_t) * count);
+            }
+        }
+    }
+}; //namespace Divide
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Divide {
+    // LSD radix sort of 64 bit keys, 8 bits per pass. Stable, and passes whose digit is the same in every key are skipped,
+    // so keys that only use a few of their bits cost a few passes. The scratch buffers are kept between calls, so steady
+    // state sorting doesn't allocate.
+    class RadixSort {
+    public:
+        // Below this many keys, building the histograms costs more than it saves and an insertion sort runs instead
+        static constexpr uint32_t INSERTION_SORT_THRESHOLD = 32u;
+
+        // Ascending. 'values' (may be null) is permuted along with 'keys'.
+        void sort(uint64_t* keys, uint32_t* values, uint32_t count);
+
+    private:
+        std::vector<uint64_t> _keyScratch{};
+        std::vector<uint32_t> _valueScratch{};
+    };
+}; //namespace Divide
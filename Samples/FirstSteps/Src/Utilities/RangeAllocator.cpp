@@ -0,0 +1,71 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace Divide {
+
+    RangeAllocator::RangeAllocator(const uint64_t capacity)
+        : _capacity(capacity)
+    {
+        if (_capacity > 0u) {
+            _freeRanges.emplace(0u, _capacity);
+        }
+    }
+
+    uint64_t RangeAllocator::allocate(const uint64_t size) {
+        if (size == 0u) {
+            return INVALID_OFFSET;
+        }
+
+        for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it) {
+            if (it->second < size) {
+                continue;
+            }
+
+            const uint64_t offset = it->first;
+            const uint64_t remaining = it->second - size;
+            _freeRanges.erase(it);
+            if (remaining > 0u) {
+                _freeRanges.emplace(offset + size, remaining);
+            }
+
+            _usedSize += size;
+            return offset;
+        }
+
+        return INVALID_OFFSET;
+    }
+
+    void RangeAllocator::free(uint64_t offset, uint64_t size) {
+        assert(size > 0u && offset + size <= _capacity && size <= _usedSize && "Invalid range allocator free");
+        _usedSize -= size;
+
+        auto next = _freeRanges.lower_bound(offset);
+        assert((next == _freeRanges.end() || offset + size <= next->first) && "Range freed twice");
+
+        if (next != _freeRanges.end() && offset + size == next->first) {
+            size += next->second;
+            next = _freeRanges.erase(next);
+        }
+        if (next != _freeRanges.begin()) {
+            const auto previous = std::prev(next);
+            assert(previous->first + previous->second <= offset && "Range freed twice");
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                _freeRanges.erase(previous);
+            }
+        }
+        _freeRanges.emplace(offset, size);
+    }
+
+    uint64_t RangeAllocator::getLargestFreeRange() const {
+        uint64_t ret = 0u;
+        for (const auto& [offset, size] : _freeRanges) {
+            ret = std::max(ret, size);
+        }
+        return ret;
+    }
+}; //namespace Divide
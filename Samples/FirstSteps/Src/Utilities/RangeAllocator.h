@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace Divide {
+    // First fit allocator over an abstract [0, capacity) range with exact sizes (no rounding), for data that is
+    // addressed by element offset rather than byte alignment, e.g. vertices and indices in a shared buffer.
+    // Free neighbours are merged straight away.
+    class RangeAllocator {
+    public:
+        static constexpr uint64_t INVALID_OFFSET = ~uint64_t{ 0u };
+
+        explicit RangeAllocator(uint64_t capacity);
+
+        // Returns INVALID_OFFSET if no free range is large enough
+        [[nodiscard]] uint64_t allocate(uint64_t size);
+        void free(uint64_t offset, uint64_t size);
+
+        [[nodiscard]] inline uint64_t getCapacity() const { return _capacity; }
+        [[nodiscard]] inline uint64_t getUsedSize() const { return _usedSize; }
+        [[nodiscard]] inline bool empty() const { return _usedSize == 0u; }
+        [[nodiscard]] uint64_t getLargestFreeRange() const;
+
+    private:
+        uint64_t _capacity = 0u;
+        uint64_t _usedSize = 0u;
+        // Offset -> size of every free range
+        std::map<uint64_t, uint64_t> _freeRanges{};
+    };
+}; //namespace Divide
@@ -11,13 +11,13 @@
 
 namespace Divide {
 
-    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent)
-        : SwapChain(deviceRef, extent, nullptr)
+    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, const bool withGBuffer)
+        : SwapChain(deviceRef, extent, nullptr, withGBuffer)
     {
     }
 
-    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-        : device{ deviceRef }, windowExtent{ extent }, _oldSwapChain(previous)
+    SwapChain::SwapChain(Device& deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous, const bool withGBuffer)
+        : device{ deviceRef }, windowExtent{ extent }, _oldSwapChain(previous), deferred{ withGBuffer }
     {
         init();
 
@@ -40,14 +40,28 @@ namespace Divide {
         for (int i = 0; i < depthImages.size(); i++) {
             vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
             vkDestroyImage(device.device(), depthImages[i], nullptr);
-            vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+            device.freeMemory(depthImageMemorys[i]);
         }
 
         for (auto framebuffer : swapChainFramebuffers) {
             vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
         }
 
-        vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        for (VkRenderPass renderPass : renderPasses) {
+            vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        }
+
+        for (auto framebuffer : deferredFramebuffers) {
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        }
+        for (size_t i = 0; i < gBufferImages.size(); i++) {
+            vkDestroyImageView(device.device(), gBufferImageViews[i], nullptr);
+            vkDestroyImage(device.device(), gBufferImages[i], nullptr);
+            device.freeMemory(gBufferImageMemorys[i]);
+        }
+        if (deferredRenderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(device.device(), deferredRenderPass, nullptr);
+        }
 
         // cleanup synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -60,9 +74,14 @@ namespace Divide {
     void SwapChain::init() {
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        createRenderPasses();
         createDepthResources();
         createFramebuffers();
+        if (deferred) {
+            createDeferredRenderPass();
+            createGBufferResources();
+            createDeferredFramebuffers();
+        }
         createSyncObjects();
     }
 
@@ -212,15 +231,25 @@ namespace Divide {
         }
     }
 
-    void SwapChain::createRenderPass() {
+    void SwapChain::createRenderPasses() {
+        for (uint8_t i = 0u; i < static_cast<uint8_t>(RenderPassType::COUNT); ++i) {
+            renderPasses[i] = createRenderPass(static_cast<RenderPassType>(i));
+        }
+    }
+
+    VkRenderPass SwapChain::createRenderPass(const RenderPassType type) {
+        const bool continues = type == RenderPassType::LAST;
+        const bool presents = type != RenderPassType::FIRST;
+
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp = continues ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        // Whatever comes after FIRST may sample it
+        depthAttachment.storeOp = presents ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout = continues ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference depthAttachmentRef{};
@@ -230,12 +259,12 @@ namespace Divide {
         VkAttachmentDescription colorAttachment = {};
         colorAttachment.format = getSwapChainImageFormat();
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.loadOp = continues ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.initialLayout = continues ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = presents ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef = {};
         colorAttachmentRef.attachment = 0;
@@ -254,6 +283,11 @@ namespace Divide {
         dependency.dstSubpass = 0;
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask =VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (continues) {
+            // Load what the previous pass wrote. Depth is handed back by whoever sampled it, with its own barrier.
+            dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
 
         std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
         VkRenderPassCreateInfo renderPassInfo = {};
@@ -265,9 +299,11 @@ namespace Divide {
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
+        VkRenderPass renderPass = VK_NULL_HANDLE;
         if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+        return renderPass;
     }
 
     void SwapChain::createFramebuffers() {
@@ -278,7 +314,8 @@ namespace Divide {
             VkExtent2D swapChainExtent = getSwapChainExtent();
             VkFramebufferCreateInfo framebufferInfo = {};
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            framebufferInfo.renderPass = renderPass;
+            // Compatible with every pass type
+            framebufferInfo.renderPass = getRenderPass();
             framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
             framebufferInfo.pAttachments = attachments.data();
             framebufferInfo.width = swapChainExtent.width;
@@ -316,7 +353,8 @@ namespace Divide {
             imageInfo.format = depthFormat;
             imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
             imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            // Sampled between FIRST and LAST passes (e.g. to build a depth pyramid), read by deferred lighting
+            imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
             imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
             imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
             imageInfo.flags = 0;
@@ -344,6 +382,162 @@ namespace Divide {
         }
     }
 
+    void SwapChain::createDeferredRenderPass() {
+        // 0: swap chain image, 1: depth, then the G-buffer. Only the swap chain image is ever stored.
+        std::array<VkAttachmentDescription, 2 + GBUFFER_ATTACHMENT_COUNT> attachments{};
+        attachments[0].format = getSwapChainImageFormat();
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        attachments[1].format = findDepthFormat();
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        for (uint32_t i = 0u; i < GBUFFER_ATTACHMENT_COUNT; ++i) {
+            attachments[2 + i].format = GBUFFER_FORMATS[i];
+        }
+        for (uint32_t i = 0u; i < attachments.size(); ++i) {
+            VkAttachmentDescription& attachment = attachments[i];
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            attachment.storeOp = i == 0u ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (i >= 2u) {
+                attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            }
+        }
+
+        std::array<VkAttachmentReference, GBUFFER_ATTACHMENT_COUNT> gBufferWriteRefs{};
+        // The lighting subpass reads the G-buffer followed by depth
+        std::array<VkAttachmentReference, GBUFFER_ATTACHMENT_COUNT + 1> gBufferReadRefs{};
+        for (uint32_t i = 0u; i < GBUFFER_ATTACHMENT_COUNT; ++i) {
+            gBufferWriteRefs[i] = { 2 + i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+            gBufferReadRefs[i] = { 2 + i, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        }
+        gBufferReadRefs[GBUFFER_ATTACHMENT_COUNT] = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+        const VkAttachmentReference colorRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        const VkAttachmentReference depthWriteRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        // Light volumes are depth tested against the G-buffer's depth, which is also an input: both uses are read only
+        const VkAttachmentReference depthReadRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+        std::array<VkSubpassDescription, 2> subpasses{};
+        subpasses[GBUFFER_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[GBUFFER_SUBPASS].colorAttachmentCount = static_cast<uint32_t>(gBufferWriteRefs.size());
+        subpasses[GBUFFER_SUBPASS].pColorAttachments = gBufferWriteRefs.data();
+        subpasses[GBUFFER_SUBPASS].pDepthStencilAttachment = &depthWriteRef;
+        subpasses[LIGHTING_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[LIGHTING_SUBPASS].inputAttachmentCount = static_cast<uint32_t>(gBufferReadRefs.size());
+        subpasses[LIGHTING_SUBPASS].pInputAttachments = gBufferReadRefs.data();
+        subpasses[LIGHTING_SUBPASS].colorAttachmentCount = 1;
+        subpasses[LIGHTING_SUBPASS].pColorAttachments = &colorRef;
+        subpasses[LIGHTING_SUBPASS].pDepthStencilAttachment = &depthReadRef;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = 0;
+        dependencies[0].dstSubpass = GBUFFER_SUBPASS;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        // Per pixel: each lighting fragment only reads what the G-buffer subpass wrote at the same location
+        dependencies[1].srcSubpass = GBUFFER_SUBPASS;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstSubpass = LIGHTING_SUBPASS;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &deferredRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create deferred render pass!");
+        }
+    }
+
+    void SwapChain::createGBufferResources() {
+        // Never loaded or stored, so tilers don't need to back them with memory at all
+        const VkMemoryPropertyFlags memoryProperties = device.supportsLazilyAllocatedMemory()
+                                                     ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+                                                     : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VkExtent2D swapChainExtent = getSwapChainExtent();
+
+        gBufferImages.resize(imageCount() * GBUFFER_ATTACHMENT_COUNT);
+        gBufferImageMemorys.resize(gBufferImages.size());
+        gBufferImageViews.resize(gBufferImages.size());
+
+        for (size_t i = 0; i < gBufferImages.size(); i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent.width = swapChainExtent.width;
+            imageInfo.extent.height = swapChainExtent.height;
+            imageInfo.extent.depth = 1;
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = GBUFFER_FORMATS[i % GBUFFER_ATTACHMENT_COUNT];
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.flags = 0;
+
+            device.createImageWithInfo(
+                imageInfo,
+                memoryProperties,
+                gBufferImages[i],
+                gBufferImageMemorys[i]);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = gBufferImages[i];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = imageInfo.format;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &gBufferImageViews[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create G-buffer image view!");
+            }
+        }
+    }
+
+    void SwapChain::createDeferredFramebuffers() {
+        deferredFramebuffers.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            std::array<VkImageView, 2 + GBUFFER_ATTACHMENT_COUNT> attachments = {
+                swapChainImageViews[i],
+                depthImageViews[i],
+                getGBufferImageView(static_cast<int>(i), GBufferAttachment::ALBEDO),
+                getGBufferImageView(static_cast<int>(i), GBufferAttachment::NORMAL)
+            };
+
+            VkExtent2D swapChainExtent = getSwapChainExtent();
+            VkFramebufferCreateInfo framebufferInfo = {};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = deferredRenderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
+            framebufferInfo.width = swapChainExtent.width;
+            framebufferInfo.height = swapChainExtent.height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &deferredFramebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create deferred framebuffer!");
+            }
+        }
+    }
+
     void SwapChain::createSyncObjects() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -421,7 +615,7 @@ namespace Divide {
         return device.findSupportedFormat(
             { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
             VK_IMAGE_TILING_OPTIMAL,
-            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+            VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
     }
 
 }; //namespace Divide
@@ -4,6 +4,7 @@
 
 // vulkan headers
 #include <vulkan/vulkan.h>
+#include <array>
 #include <memory>
 
 namespace Divide {
@@ -12,9 +13,32 @@ class SwapChain {
 public:
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
+    // All passes use the same attachments and are compatible with each other, so pipelines created for one work in all
+    // of them. A frame either renders in a single pass or in a FIRST pass followed by any number of LAST ones, with
+    // the depth buffer available for sampling in between (see getDepthImage()).
+    enum class RenderPassType : uint8_t {
+        SINGLE = 0, // Clears, then leaves the image for presentation
+        FIRST,      // Clears and keeps colour and depth for a later pass
+        LAST,       // Continues from FIRST, then leaves the image for presentation
+        COUNT
+    };
+
+    // Deferred shading renders in its own pass, which isn't compatible with the ones above: a G-buffer subpass followed
+    // by a lighting subpass that reads the G-buffer (and depth) as input attachments, so tilers can keep it all on chip.
+    // The G-buffer is transient and lazily allocated where the device supports it. Only built with 'deferred'.
+    static constexpr uint32_t GBUFFER_SUBPASS = 0u;
+    static constexpr uint32_t LIGHTING_SUBPASS = 1u;
+    enum class GBufferAttachment : uint8_t {
+        ALBEDO = 0, // RGBA8: surface colour
+        NORMAL,     // RGBA16F: world space normal
+        COUNT
+    };
+    static constexpr uint32_t GBUFFER_ATTACHMENT_COUNT = static_cast<uint32_t>(GBufferAttachment::COUNT);
+    static constexpr VkFormat GBUFFER_FORMATS[GBUFFER_ATTACHMENT_COUNT] = { VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R16G16B16A16_SFLOAT };
+
     SwapChain() = default;
-    SwapChain(Device& deviceRef, VkExtent2D windowExtent);
-    SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+    SwapChain(Device& deviceRef, VkExtent2D windowExtent, bool deferred = false);
+    SwapChain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous, bool deferred = false);
 
     ~SwapChain();
 
@@ -24,10 +48,18 @@ public:
     SwapChain& operator=(SwapChain&&) = delete;
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-    VkRenderPass getRenderPass() { return renderPass; }
+    VkRenderPass getRenderPass(const RenderPassType type = RenderPassType::SINGLE) { return renderPasses[static_cast<size_t>(type)]; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+    // Sampleable. In DEPTH_STENCIL_ATTACHMENT_OPTIMAL layout once a FIRST pass ends, and expected back in it by LAST.
+    VkImage getDepthImage(int index) { return depthImages[index]; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
+    bool hasGBuffer() const { return deferred; }
+    VkRenderPass getDeferredRenderPass() { return deferredRenderPass; }
+    VkFramebuffer getDeferredFrameBuffer(int index) { return deferredFramebuffers[index]; }
+    VkImageView getGBufferImageView(int index, GBufferAttachment attachment) { return gBufferImageViews[index * GBUFFER_ATTACHMENT_COUNT + static_cast<uint32_t>(attachment)]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+    VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
@@ -49,8 +81,12 @@ private:
     void createSwapChain();
     void createImageViews();
     void createDepthResources();
-    void createRenderPass();
+    void createRenderPasses();
+    [[nodiscard]] VkRenderPass createRenderPass(RenderPassType type);
     void createFramebuffers();
+    void createGBufferResources();
+    void createDeferredRenderPass();
+    void createDeferredFramebuffers();
     void createSyncObjects();
 
     // Helper functions
@@ -63,10 +99,10 @@ private:
     VkExtent2D swapChainExtent;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
+    std::array<VkRenderPass, static_cast<size_t>(RenderPassType::COUNT)> renderPasses{};
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<MemoryAllocation> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
@@ -81,5 +117,13 @@ private:
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
     size_t currentFrame = 0;
+
+    // Deferred shading only. G-buffer images are indexed by swap chain image * GBUFFER_ATTACHMENT_COUNT + attachment.
+    bool deferred = false;
+    VkRenderPass deferredRenderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> deferredFramebuffers;
+    std::vector<VkImage> gBufferImages;
+    std::vector<MemoryAllocation> gBufferImageMemorys;
+    std::vector<VkImageView> gBufferImageViews;
 };
 }; //namespace Divide
@@ -0,0 +1,53 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace Divide {
+
+    ThreadPool::ThreadPool(const uint32_t threadCount)
+    {
+        const uint32_t workerCount = threadCount > 0u ? threadCount : std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+
+        _workers.reserve(workerCount);
+        for (uint32_t i = 0u; i < workerCount; ++i) {
+            _workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _stopping = true;
+        }
+        _condition.notify_all();
+
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::enqueue(std::function<void()>&& task) {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _tasks.push_back(std::move(task));
+        }
+        _condition.notify_one();
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task{};
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _condition.wait(lock, [this]() { return _stopping || !_tasks.empty(); });
+                if (_tasks.empty()) {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+}; //namespace Divide
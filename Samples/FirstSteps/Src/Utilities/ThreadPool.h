@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Divide {
+    // Fixed set of worker threads pulling tasks from a shared FIFO queue
+    class ThreadPool {
+    public:
+        // 0 uses one worker per hardware thread, minus one for the main thread
+        explicit ThreadPool(uint32_t threadCount = 0u);
+        // Finishes every queued task before joining
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        void enqueue(std::function<void()>&& task);
+
+        [[nodiscard]] inline size_t getThreadCount() const { return _workers.size(); }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> _workers{};
+        std::deque<std::function<void()>> _tasks{};
+        std::mutex _lock{};
+        std::condition_variable _condition{};
+        bool _stopping = false;
+    };
+}; //namespace Divide
@@ -0,0 +1,47 @@
+#include "UploadBatch.h"
+
+#include <cassert>
+
+namespace Divide {
+
+    UploadBatch::UploadBatch(Device& device)
+        : _uploadManager(device.getUploadManager())
+    {
+    }
+
+    UploadBatch::~UploadBatch()
+    {
+        assert((_submitted || empty()) && "Upload batch destroyed with unsubmitted copies");
+        if (_submitted) {
+            wait();
+        }
+    }
+
+    void UploadBatch::copyToBuffer(const void* data, const VkDeviceSize size, VkBuffer dstBuffer, const VkDeviceSize dstOffset) {
+        assert(!_submitted && "Cannot add copies to a batch that was already submitted");
+        _uploadManager.copyToBuffer(data, size, dstBuffer, dstOffset);
+        _byteCount += size;
+    }
+
+    void UploadBatch::submit() {
+        assert(!_submitted && "Upload batch submitted twice");
+        _submitted = true;
+
+        if (!empty()) {
+            // Copies may already have gone out early if they filled the ring; this ticket covers those too
+            _ticket = _uploadManager.submit();
+        }
+    }
+
+    void UploadBatch::wait() {
+        assert(_submitted && "Cannot wait on an upload batch that was never submitted");
+        _uploadManager.wait(_ticket);
+    }
+
+    bool UploadBatch::isComplete() {
+        if (!_submitted) {
+            return empty();
+        }
+        return _uploadManager.isComplete(_ticket);
+    }
+}; //namespace Divide
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "UploadManager.h"
+
+namespace Divide {
+    // A group of uploads that completes as a unit. Staging goes through the device's UploadManager ring and the
+    // whole batch is one command buffer + fence rather than Device::copyBuffer's submit + vkQueueWaitIdle per copy.
+    // Only one batch may be recording at a time and only on the thread that owns the device's command pool.
+    class UploadBatch {
+    public:
+        explicit UploadBatch(Device& device);
+        // Blocks until the GPU is done with a submitted batch
+        ~UploadBatch();
+
+        UploadBatch(const UploadBatch&) = delete;
+        UploadBatch& operator=(const UploadBatch&) = delete;
+        UploadBatch(UploadBatch&&) = delete;
+        UploadBatch& operator=(UploadBatch&&) = delete;
+
+        // 'data' is copied into staging memory straight away, so it only needs to live for the duration of the call
+        void copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0u);
+
+        // Submits every queued copy. Does not wait.
+        void submit();
+        void wait();
+        // Non-blocking fence check. Also true for an empty batch.
+        [[nodiscard]] bool isComplete();
+
+        [[nodiscard]] inline bool isSubmitted() const { return _submitted; }
+        [[nodiscard]] inline bool empty() const { return _byteCount == 0u; }
+        [[nodiscard]] inline VkDeviceSize getByteCount() const { return _byteCount; }
+
+    private:
+        UploadManager& _uploadManager;
+        VkDeviceSize _byteCount = 0u;
+        UploadManager::Ticket _ticket = 0u;
+        bool _submitted = false;
+    };
+}; //namespace Divide
@@ -0,0 +1,376 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace Divide {
+
+    UploadManager::UploadManager(Device& device, const VkDeviceSize ringSize)
+        : _device(device)
+        , _ring(device,
+                ringSize,
+                1u,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        , _ringSize(ringSize)
+        , _dedicatedTransfer(device.hasDedicatedTransferQueue())
+    {
+        if (_ring.map() != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map the staging ring!");
+        }
+        _ringMemory = static_cast<std::byte*>(_ring.getMappedMemory());
+        _stats.ringSize = _ringSize;
+    }
+
+    UploadManager::~UploadManager()
+    {
+        assert(_pendingCopies.empty() && "Upload manager destroyed with unsubmitted copies");
+        wait(_lastTicket);
+        for (VkFence fence : _freeFences) {
+            vkDestroyFence(_device.device(), fence, nullptr);
+        }
+        for (VkSemaphore semaphore : _freeSemaphores) {
+            vkDestroySemaphore(_device.device(), semaphore, nullptr);
+        }
+    }
+
+    VkDeviceSize UploadManager::tryAllocate(const VkDeviceSize size) {
+        if (_ringUsedBytes == 0u) {
+            _head = _tail = 0u;
+        }
+
+        const VkDeviceSize alignedHead = (_head + STAGING_ALIGNMENT - 1u) & ~(STAGING_ALIGNMENT - 1u);
+
+        VkDeviceSize offset = VK_WHOLE_SIZE;
+        if (_ringUsedBytes < _ringSize && _head >= _tail) {
+            // Free space is [head, end) followed by [0, tail)
+            if (alignedHead + size <= _ringSize) {
+                offset = alignedHead;
+            } else if (size <= _tail) {
+                offset = 0u;
+            }
+        } else if (_head < _tail && alignedHead + size <= _tail) {
+            offset = alignedHead;
+        }
+
+        if (offset == VK_WHOLE_SIZE) {
+            return VK_WHOLE_SIZE;
+        }
+
+        // Alignment padding, and the unused end of the ring when wrapping, stay reserved until this submission retires
+        const VkDeviceSize consumed = offset >= _head ? offset + size - _head : _ringSize - _head + size;
+        _head = offset + size;
+        _ringUsedBytes += consumed;
+        _pendingRingBytes += consumed;
+        _stats.peakRingUsedBytes = std::max(_stats.peakRingUsedBytes, _ringUsedBytes);
+        return offset;
+    }
+
+    VkDeviceSize UploadManager::allocate(const VkDeviceSize size) {
+        VkDeviceSize offset = tryAllocate(size);
+        if (offset != VK_WHOLE_SIZE) {
+            return offset;
+        }
+
+        retire();
+        while ((offset = tryAllocate(size)) == VK_WHOLE_SIZE) {
+            ++_stats.stalls;
+            const bool copyInFlight = std::any_of(_inFlight.begin(), _inFlight.end(), [](const Submission& submission) {
+                return submission._state == SubmissionState::COPYING;
+            });
+            if (!copyInFlight) {
+                // The copies recorded so far fill the ring on their own: push them out to make room
+                (void)submit();
+            }
+            waitOldestCopy();
+        }
+        return offset;
+    }
+
+    void UploadManager::copyToBuffer(const void* data, const VkDeviceSize size, VkBuffer dstBuffer, const VkDeviceSize dstOffset) {
+        if (size == 0u) {
+            return;
+        }
+
+        Copy copy{};
+        copy._dstBuffer = dstBuffer;
+        copy._dstOffset = dstOffset;
+        copy._size = size;
+
+        if (size > _ringSize) {
+            auto stagingBuffer = std::make_unique<Buffer>(
+                _device,
+                size,
+                1u,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            stagingBuffer->map();
+            stagingBuffer->writeToBuffer(const_cast<void*>(data), size);
+            stagingBuffer->unmap();
+
+            copy._srcBuffer = stagingBuffer->getBuffer();
+            _pendingOversizedBuffers.push_back(std::move(stagingBuffer));
+            ++_stats.oversizedUploads;
+        } else {
+            copy._srcBuffer = _ring.getBuffer();
+            copy._srcOffset = allocate(size);
+            std::memcpy(_ringMemory + copy._srcOffset, data, size);
+        }
+
+        _pendingCopies.push_back(copy);
+        ++_stats.copies;
+        _stats.uploadedBytes += size;
+    }
+
+    UploadManager::Ticket UploadManager::submit() {
+        if (_pendingCopies.empty()) {
+            return _lastTicket;
+        }
+
+        Submission submission{};
+        submission._ticket = ++_lastTicket;
+        submission._ringBytes = _pendingRingBytes;
+        submission._ringEnd = _head;
+        submission._oversizedBuffers = std::move(_pendingOversizedBuffers);
+        _pendingOversizedBuffers.clear();
+        _pendingRingBytes = 0u;
+
+        submission._commandBuffer = beginCommandBuffer(_device.getTransferCommandPool());
+        for (const Copy& copy : _pendingCopies) {
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = copy._srcOffset;
+            copyRegion.dstOffset = copy._dstOffset;
+            copyRegion.size = copy._size;
+            vkCmdCopyBuffer(submission._commandBuffer, copy._srcBuffer, copy._dstBuffer, 1, &copyRegion);
+
+            if (_dedicatedTransfer) {
+                VkBufferMemoryBarrier ownershipBarrier{};
+                ownershipBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                ownershipBarrier.srcQueueFamilyIndex = _device.getTransferQueueFamily();
+                ownershipBarrier.dstQueueFamilyIndex = _device.getGraphicsQueueFamily();
+                ownershipBarrier.buffer = copy._dstBuffer;
+                ownershipBarrier.offset = copy._dstOffset;
+                ownershipBarrier.size = copy._size;
+                submission._ownershipBarriers.push_back(ownershipBarrier);
+            }
+        }
+        _pendingCopies.clear();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission._commandBuffer;
+
+        if (_dedicatedTransfer) {
+            // Release half of the ownership transfer. The destination access mask is ignored on the releasing queue.
+            for (VkBufferMemoryBarrier& barrier : submission._ownershipBarriers) {
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = 0u;
+            }
+            vkCmdPipelineBarrier(submission._commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(submission._ownershipBarriers.size()), submission._ownershipBarriers.data(),
+                                 0, nullptr);
+
+            submission._semaphore = acquireSemaphore();
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &submission._semaphore;
+        } else {
+            // Later submissions on this queue may read the data as soon as the copies are done, without waiting on the fence
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(submission._commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                                 0,
+                                 1, &barrier,
+                                 0, nullptr,
+                                 0, nullptr);
+        }
+
+        vkEndCommandBuffer(submission._commandBuffer);
+
+        submission._fence = acquireFence();
+        if (vkQueueSubmit(_device.transferQueue(), 1, &submitInfo, submission._fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload batch!");
+        }
+
+        ++_stats.submissions;
+        _inFlight.push_back(std::move(submission));
+        return _lastTicket;
+    }
+
+    void UploadManager::submitAcquire(Submission& submission) {
+        // Acquire half of the ownership transfer. The source access mask is ignored on the acquiring queue.
+        for (VkBufferMemoryBarrier& barrier : submission._ownershipBarriers) {
+            barrier.srcAccessMask = 0u;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        }
+
+        submission._acquireCommandBuffer = beginCommandBuffer(_device.getCommandPool());
+        vkCmdPipelineBarrier(submission._acquireCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                             0,
+                             0, nullptr,
+                             static_cast<uint32_t>(submission._ownershipBarriers.size()), submission._ownershipBarriers.data(),
+                             0, nullptr);
+        vkEndCommandBuffer(submission._acquireCommandBuffer);
+
+        // The copy has already finished by now, so this wait is satisfied immediately and never holds up rendering
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = 1;
+        submitInfo.pWaitSemaphores = &submission._semaphore;
+        submitInfo.pWaitDstStageMask = &waitStage;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission._acquireCommandBuffer;
+
+        submission._acquireFence = acquireFence();
+        if (vkQueueSubmit(_device.graphicsQueue(), 1, &submitInfo, submission._acquireFence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload ownership acquire!");
+        }
+    }
+
+    VkCommandBuffer UploadManager::beginCommandBuffer(VkCommandPool commandPool) const {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(_device.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        return commandBuffer;
+    }
+
+    VkFence UploadManager::acquireFence() {
+        if (!_freeFences.empty()) {
+            VkFence fence = _freeFences.back();
+            _freeFences.pop_back();
+            vkResetFences(_device.device(), 1, &fence);
+            return fence;
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence = VK_NULL_HANDLE;
+        if (vkCreateFence(_device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence!");
+        }
+        return fence;
+    }
+
+    VkSemaphore UploadManager::acquireSemaphore() {
+        if (!_freeSemaphores.empty()) {
+            VkSemaphore semaphore = _freeSemaphores.back();
+            _freeSemaphores.pop_back();
+            return semaphore;
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        if (vkCreateSemaphore(_device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload semaphore!");
+        }
+        return semaphore;
+    }
+
+    void UploadManager::onCopyComplete(Submission& submission) {
+        vkFreeCommandBuffers(_device.device(), _device.getTransferCommandPool(), 1, &submission._commandBuffer);
+        _freeFences.push_back(submission._fence);
+        submission._oversizedBuffers.clear();
+
+        // Copies complete in submission order, so the tail simply advances
+        _ringUsedBytes -= submission._ringBytes;
+        _tail = submission._ringEnd;
+
+        if (_dedicatedTransfer) {
+            submitAcquire(submission);
+            submission._state = SubmissionState::ACQUIRING;
+        } else {
+            submission._state = SubmissionState::DONE;
+        }
+    }
+
+    void UploadManager::release(Submission& submission) {
+        if (submission._acquireCommandBuffer != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(_device.device(), _device.getCommandPool(), 1, &submission._acquireCommandBuffer);
+            _freeFences.push_back(submission._acquireFence);
+            // Unsignalled again: the acquire submission consumed it
+            _freeSemaphores.push_back(submission._semaphore);
+        }
+        _retiredTicket = submission._ticket;
+    }
+
+    void UploadManager::retire() {
+        bool copiesInOrder = true;
+        for (Submission& submission : _inFlight) {
+            if (submission._state == SubmissionState::COPYING) {
+                if (!copiesInOrder || vkGetFenceStatus(_device.device(), submission._fence) != VK_SUCCESS) {
+                    copiesInOrder = false;
+                    continue;
+                }
+                onCopyComplete(submission);
+            }
+            if (submission._state == SubmissionState::ACQUIRING && vkGetFenceStatus(_device.device(), submission._acquireFence) == VK_SUCCESS) {
+                submission._state = SubmissionState::DONE;
+            }
+        }
+
+        while (!_inFlight.empty() && _inFlight.front()._state == SubmissionState::DONE) {
+            release(_inFlight.front());
+            _inFlight.pop_front();
+        }
+    }
+
+    void UploadManager::waitOldestCopy() {
+        const auto it = std::find_if(_inFlight.begin(), _inFlight.end(), [](const Submission& submission) {
+            return submission._state == SubmissionState::COPYING;
+        });
+        assert(it != _inFlight.end() && "No copy in flight to wait on");
+
+        vkWaitForFences(_device.device(), 1, &it->_fence, VK_TRUE, UINT64_MAX);
+        retire();
+    }
+
+    bool UploadManager::isComplete(const Ticket ticket) {
+        assert(ticket <= _lastTicket && "Ticket was never handed out");
+        retire();
+        return ticket <= _retiredTicket;
+    }
+
+    void UploadManager::wait(const Ticket ticket) {
+        assert(ticket <= _lastTicket && "Ticket was never handed out");
+        retire();
+        while (ticket > _retiredTicket) {
+            Submission& oldest = _inFlight.front();
+            vkWaitForFences(_device.device(), 1, oldest._state == SubmissionState::COPYING ? &oldest._fence : &oldest._acquireFence, VK_TRUE, UINT64_MAX);
+            retire();
+        }
+    }
+
+    UploadManager::Stats UploadManager::getStats() const {
+        Stats stats = _stats;
+        stats.ringUsedBytes = _ringUsedBytes;
+        stats.inFlightSubmissions = static_cast<uint32_t>(_inFlight.size());
+        return stats;
+    }
+}; //namespace Divide
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Divide {
+    // Owns a persistently mapped staging ring. Copies are sub-allocated from the ring, recorded together into one
+    // command buffer per submit() and the ring space is handed back once that submission's fence has signalled.
+    // When the ring is full the oldest submission is waited on (a "stall"); uploads larger than the whole ring get
+    // a one-off staging buffer. Main thread only (it records into the device's command pools).
+    //
+    // With a dedicated transfer queue the copies run there and end in a queue family release of every destination
+    // buffer. Once the copy fence signals, a small graphics queue submission waits on the copy's semaphore and
+    // performs the matching acquire, so the render queue never sits behind an in-progress copy. Without one, copies
+    // go straight to the graphics queue behind a plain memory barrier.
+    class UploadManager {
+    public:
+        static constexpr VkDeviceSize DEFAULT_RING_SIZE = VkDeviceSize{ 64u } << 20;
+        // Staging offsets are kept 16 byte aligned so the memcpy into the ring stays vector friendly
+        static constexpr VkDeviceSize STAGING_ALIGNMENT = 16u;
+
+        using Ticket = uint64_t;
+
+        struct Stats {
+            VkDeviceSize ringSize = 0u;
+            // Staging bytes not yet returned to the ring (recorded or in flight), now and at worst
+            VkDeviceSize ringUsedBytes = 0u;
+            VkDeviceSize peakRingUsedBytes = 0u;
+            uint64_t submissions = 0u;
+            uint64_t copies = 0u;
+            uint64_t uploadedBytes = 0u;
+            // Times an allocation had to block on the GPU because the ring was full
+            uint64_t stalls = 0u;
+            uint64_t oversizedUploads = 0u;
+            uint32_t inFlightSubmissions = 0u;
+        };
+
+        explicit UploadManager(Device& device, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+        // Waits for every in-flight submission
+        ~UploadManager();
+
+        UploadManager(const UploadManager&) = delete;
+        UploadManager& operator=(const UploadManager&) = delete;
+        UploadManager(UploadManager&&) = delete;
+        UploadManager& operator=(UploadManager&&) = delete;
+
+        // Copies 'data' into the ring straight away and queues the GPU copy for the next submit()
+        void copyToBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0u);
+
+        // Records every queued copy into one command buffer and submits it. The returned ticket completes once those
+        // copies (and every earlier one) are done. With nothing queued, returns the last ticket handed out.
+        [[nodiscard]] Ticket submit();
+        // Non-blocking. Retires whatever finished on the way.
+        [[nodiscard]] bool isComplete(Ticket ticket);
+        void wait(Ticket ticket);
+        // Returns the ring space of every finished submission. Cheap; called implicitly by the functions above.
+        void retire();
+
+        [[nodiscard]] Stats getStats() const;
+
+    private:
+        struct Copy {
+            VkBuffer _srcBuffer = VK_NULL_HANDLE;
+            VkDeviceSize _srcOffset = 0u;
+            VkBuffer _dstBuffer = VK_NULL_HANDLE;
+            VkDeviceSize _dstOffset = 0u;
+            VkDeviceSize _size = 0u;
+        };
+
+        enum class SubmissionState : uint8_t {
+            COPYING = 0,
+            ACQUIRING,
+            DONE
+        };
+
+        struct Submission {
+            Ticket _ticket = 0u;
+            SubmissionState _state = SubmissionState::COPYING;
+            VkCommandBuffer _commandBuffer = VK_NULL_HANDLE;
+            VkFence _fence = VK_NULL_HANDLE;
+            // Dedicated transfer queue only: ownership release -> acquire handoff
+            std::vector<VkBufferMemoryBarrier> _ownershipBarriers{};
+            VkSemaphore _semaphore = VK_NULL_HANDLE;
+            VkCommandBuffer _acquireCommandBuffer = VK_NULL_HANDLE;
+            VkFence _acquireFence = VK_NULL_HANDLE;
+            // Ring bytes (padding included) to release and where the ring tail moves to once it completes
+            VkDeviceSize _ringBytes = 0u;
+            VkDeviceSize _ringEnd = 0u;
+            std::vector<std::unique_ptr<Buffer>> _oversizedBuffers{};
+        };
+
+        // Ring offset for 'size' bytes, or VK_WHOLE_SIZE if it doesn't fit right now
+        [[nodiscard]] VkDeviceSize tryAllocate(VkDeviceSize size);
+        [[nodiscard]] VkDeviceSize allocate(VkDeviceSize size);
+        // Blocks on the oldest submission that is still copying, then retires
+        void waitOldestCopy();
+        // Moves finished copies on to the acquire step (or straight to done) and returns their ring space
+        void onCopyComplete(Submission& submission);
+        void submitAcquire(Submission& submission);
+        void release(Submission& submission);
+        [[nodiscard]] VkCommandBuffer beginCommandBuffer(VkCommandPool commandPool) const;
+        [[nodiscard]] VkFence acquireFence();
+        [[nodiscard]] VkSemaphore acquireSemaphore();
+
+        Device& _device;
+        Buffer _ring;
+        std::byte* _ringMemory = nullptr;
+        const VkDeviceSize _ringSize;
+        // Next free byte and oldest byte still in use. _ringUsedBytes disambiguates full from empty.
+        VkDeviceSize _head = 0u;
+        VkDeviceSize _tail = 0u;
+        VkDeviceSize _ringUsedBytes = 0u;
+
+        // Recorded but not yet submitted
+        std::vector<Copy> _pendingCopies{};
+        std::vector<std::unique_ptr<Buffer>> _pendingOversizedBuffers{};
+        VkDeviceSize _pendingRingBytes = 0u;
+
+        // In submission order; the same queue completes them in order too
+        std::deque<Submission> _inFlight{};
+        std::vector<VkFence> _freeFences{};
+        std::vector<VkSemaphore> _freeSemaphores{};
+        const bool _dedicatedTransfer;
+        Ticket _lastTicket = 0u;
+        Ticket _retiredTicket = 0u;
+
+        Stats _stats{};
+    };
+}; //namespace Divide
@@ -0,0 +1,98 @@
+#include "VertexHashTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Divide {
+
+    namespace {
+        // Probe sequences stay short as long as the table is at most 3/4 full
+        constexpr size_t MAX_LOAD_NUMERATOR = 3u;
+        constexpr size_t MAX_LOAD_DENOMINATOR = 4u;
+        constexpr size_t MIN_CAPACITY = 16u;
+
+        constexpr size_t VERTEX_WORDS = sizeof(Model::Vertex) / sizeof(uint32_t);
+        static_assert(sizeof(Model::Vertex) % sizeof(uint32_t) == 0u, "Vertex must be made of 32 bit floats only");
+        static_assert(VERTEX_WORDS <= 12u, "Vertex hash assumes at most 3 SIMD lanes worth of data");
+
+        size_t nextPowerOfTwo(const size_t value) {
+            size_t ret = 1u;
+            while (ret < value) {
+                ret <<= 1;
+            }
+            return ret;
+        }
+
+        uint64_t mix(uint64_t value) {
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdull;
+            value ^= value >> 33;
+            value *= 0xc4ceb9fe1a85ec53ull;
+            value ^= value >> 33;
+            return value;
+        }
+    };
+
+    VertexHashTable::VertexHashTable(const size_t expectedVertexCount)
+    {
+        const size_t capacity = nextPowerOfTwo(std::max(expectedVertexCount * MAX_LOAD_DENOMINATOR / MAX_LOAD_NUMERATOR + 1u, MIN_CAPACITY));
+        _slots.resize(capacity);
+        _mask = capacity - 1u;
+        _growThreshold = capacity * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR;
+    }
+
+    uint32_t VertexHashTable::hash(const Model::Vertex& vertex) {
+        alignas(16) uint32_t words[12]{};
+        std::memcpy(words, &vertex, sizeof(Model::Vertex));
+
+        // Clear the sign bit of zeroes so that -0.f and 0.f (which compare equal) land in the same bucket
+#if defined(VERTEX_HASH_SSE2)
+        const __m128i absMask = _mm_set1_epi32(0x7FFFFFFF);
+        const __m128i zero = _mm_setzero_si128();
+        for (size_t i = 0u; i < 12u; i += 4u) {
+            __m128i lane = _mm_load_si128(reinterpret_cast<const __m128i*>(words + i));
+            const __m128i isZero = _mm_cmpeq_epi32(_mm_and_si128(lane, absMask), zero);
+            lane = _mm_andnot_si128(isZero, lane);
+            _mm_store_si128(reinterpret_cast<__m128i*>(words + i), lane);
+        }
+#else
+        for (uint32_t& word : words) {
+            if ((word & 0x7FFFFFFFu) == 0u) {
+                word = 0u;
+            }
+        }
+#endif
+
+        uint64_t ret = 0u;
+        for (size_t i = 0u; i < 12u; i += 2u) {
+            ret = mix(ret ^ (uint64_t{ words[i] } | (uint64_t{ words[i + 1] } << 32)));
+        }
+        return static_cast<uint32_t>(ret ^ (ret >> 32));
+    }
+
+    void VertexHashTable::grow() {
+        std::vector<Slot> oldSlots = std::move(_slots);
+
+        const size_t capacity = oldSlots.size() * 2u;
+        _slots.assign(capacity, Slot{});
+        _mask = capacity - 1u;
+        _growThreshold = capacity * MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR;
+
+        for (const Slot& oldSlot : oldSlots) {
+            if (oldSlot._index == EMPTY_SLOT) {
+                continue;
+            }
+
+            size_t slot = oldSlot._hash & _mask;
+            while (_slots[slot]._index != EMPTY_SLOT) {
+                slot = (slot + 1) & _mask;
+            }
+            _slots[slot] = oldSlot;
+        }
+    }
+}; //namespace Divide
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Model.h"
+
+#include <vector>
+
+namespace Divide {
+    // Flat, linear probing map from Model::Vertex to its index in an output vertex array. The table only stores
+    // {hash, index} pairs; keys are compared against the vertex array itself, so a lookup touches one 8 byte
+    // slot per probe and there are no per-vertex allocations.
+    class VertexHashTable {
+    public:
+        static constexpr uint32_t EMPTY_SLOT = ~0u;
+
+        // Expected number of unique vertices. The index count is a safe upper bound.
+        explicit VertexHashTable(size_t expectedVertexCount);
+
+        VertexHashTable(const VertexHashTable&) = delete;
+        VertexHashTable& operator=(const VertexHashTable&) = delete;
+        VertexHashTable(VertexHashTable&&) = delete;
+        VertexHashTable& operator=(VertexHashTable&&) = delete;
+
+        // Bitwise hash of all vertex attributes. -0.f and 0.f hash the same so it agrees with Vertex::operator==
+        [[nodiscard]] static uint32_t hash(const Model::Vertex& vertex);
+
+        // Returns the index of an equal vertex in 'vertices', appending 'vertex' first if there is none yet
+        [[nodiscard]] inline uint32_t weld(const Model::Vertex& vertex, std::vector<Model::Vertex>& vertices);
+
+        [[nodiscard]] inline size_t size() const { return _size; }
+        [[nodiscard]] inline size_t capacity() const { return _slots.size(); }
+
+    private:
+        struct Slot {
+            uint32_t _hash = 0u;
+            uint32_t _index = EMPTY_SLOT;
+        };
+
+        void grow();
+
+    private:
+        std::vector<Slot> _slots{};
+        size_t _mask = 0u;
+        size_t _size = 0u;
+        size_t _growThreshold = 0u;
+    };
+
+    uint32_t VertexHashTable::weld(const Model::Vertex& vertex, std::vector<Model::Vertex>& vertices) {
+        const uint32_t vertexHash = hash(vertex);
+
+        size_t slot = vertexHash & _mask;
+        while (_slots[slot]._index != EMPTY_SLOT) {
+            if (_slots[slot]._hash == vertexHash && vertices[_slots[slot]._index] == vertex) {
+                return _slots[slot]._index;
+            }
+            slot = (slot + 1) & _mask;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(vertex);
+        _slots[slot] = { vertexHash, index };
+
+        if (++_size > _growThreshold) {
+            grow();
+        }
+
+        return index;
+    }
+}; //namespace Divide
@@ -0,0 +1,1048 @@
+// AssetTool : offline asset processing for FirstSteps.
+//
+// Usage:
+//   AssetTool cook <source.obj> <output.mesh>   - import, weld and write a cooked binary mesh
+//   AssetTool load <file.obj|file.mesh>         - time a CPU-side load of either format and report peak RSS
+//   AssetTool import <source.obj> [threads]     - compare single and multi-threaded import (timing + identical output)
+//   AssetTool generate <output.obj> <gridSize>  - write a gridSize x gridSize quad grid (2 * gridSize^2 triangles)
+//   AssetTool optimize <source.obj>             - ACMR/ATVR before and after the mesh optimiser, plus a topology check
+//   AssetTool dedup <source.obj>                - vertex welding throughput/allocations: std::unordered_map vs VertexHashTable
+//   AssetTool meshlets <source.obj>             - meshlet fill rate, cone tightness and back facing cull rate, plus a validity check
+//   AssetTool allocator [operations]            - randomised MemoryAllocator stress test against a CPU heap: overlap/alignment checks and fragmentation
+//   AssetTool cull [objects]                    - FrustumCuller throughput (objects/ms) for every SIMD path, checked against the scalar result
+//   AssetTool occlusion [objects]               - OcclusionRasterizer timings per path and thread count, checked against the scalar single-threaded result
+//   AssetTool lights [lights]                   - LightClusters build time and occupancy, checked against a brute force light list per sample point
+//   AssetTool sort [keys]                       - RadixSort throughput against std::stable_sort, checked for order and stability on several key distributions
+
+#include "Utilities/CookedModel.h"
+#include "Utilities/FrustumCuller.h"
+#include "Utilities/LightClusters.h"
+#include "Utilities/MemoryAllocator.h"
+#include "Utilities/MeshOptimizer.h"
+#include "Utilities/OcclusionRasterizer.h"
+#include "Utilities/Platform.h"
+#include "Utilities/RadixSort.h"
+#include "Utilities/Utils.h"
+#include "Utilities/VertexHashTable.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    std::atomic_size_t g_allocationCount{ 0u };
+
+    // Every replaced form goes through this malloc/free pair, so any new can be released by any delete
+    void* countedAllocate(const size_t size) {
+        g_allocationCount.fetch_add(1u, std::memory_order_relaxed);
+        if (void* ptr = std::malloc(size != 0u ? size : 1u)) {
+            return ptr;
+        }
+        throw std::bad_alloc{};
+    }
+
+    void countedFree(void* ptr) noexcept {
+        std::free(ptr);
+    }
+};
+
+void* operator new(const size_t size) {
+    return countedAllocate(size);
+}
+
+void* operator new[](const size_t size) {
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    countedFree(ptr);
+}
+
+// The hasher Model::Builder used before VertexHashTable, kept here as the dedup benchmark baseline
+namespace std {
+    template<>
+    struct hash<Divide::Model::Vertex> {
+        size_t operator()(Divide::Model::Vertex const& vertex) const {
+            size_t seed = 0;
+            Divide::hashCombine(seed, vertex.position, vertex.colour, vertex.normal, vertex.uv);
+            return seed;
+        }
+    };
+};
+
+namespace {
+    using Clock = std::chrono::high_resolution_clock;
+
+    constexpr uint32_t COOKED_LOD_COUNT = 4u;
+
+    float elapsedMS(const Clock::time_point start) {
+        return std::chrono::duration<float, std::chrono::milliseconds::period>(Clock::now() - start).count();
+    }
+
+    void printUsage() {
+        std::cout << "Usage:" << std::endl
+                  << "\tAssetTool cook <source.obj> <output.mesh>" << std::endl
+                  << "\tAssetTool load <file.obj|file.mesh>" << std::endl
+                  << "\tAssetTool import <source.obj> [threads]" << std::endl
+                  << "\tAssetTool generate <output.obj> <gridSize>" << std::endl
+                  << "\tAssetTool optimize <source.obj>" << std::endl
+                  << "\tAssetTool dedup <source.obj>" << std::endl
+                  << "\tAssetTool meshlets <source.obj>" << std::endl
+                  << "\tAssetTool allocator [operations]" << std::endl
+                  << "\tAssetTool cull [objects]" << std::endl
+                  << "\tAssetTool occlusion [objects]" << std::endl
+                  << "\tAssetTool lights [lights]" << std::endl
+                  << "\tAssetTool sort [keys]" << std::endl;
+    }
+
+    void printVertexCacheStats(const char* name, const Divide::Model::Builder& builder) {
+        // LOD 0 only: the other levels reuse a subset of the same vertices and would skew ATVR
+        const size_t indexCount = builder._lods.empty() ? builder._indices.size() : builder._lods.front().indexCount;
+        const auto stats = Divide::MeshOptimizer::analyzeVertexCache(builder._indices.data(), indexCount, builder._vertices.size());
+        std::cout << "\t" << name << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr << std::endl;
+    }
+
+    void printLods(const Divide::Model::Builder& builder) {
+        for (size_t i = 0; i < builder._lods.size(); ++i) {
+            const auto& lod = builder._lods[i];
+            std::cout << "\tLOD " << i << ": " << lod.indexCount / 3 << " triangles, error " << lod.error << std::endl;
+        }
+    }
+
+    // GPU bytes for the full float / 32 bit index layout vs what the cooked file actually stores
+    void printMemorySavings(const Divide::Model::Builder& builder) {
+        const size_t vertexCount = builder._vertices.size();
+        const size_t indexCount = builder._indices.size();
+        const size_t fullBytes = vertexCount * sizeof(Divide::Model::Vertex) + indexCount * sizeof(uint32_t);
+        const size_t cookedBytes = vertexCount * Divide::Model::getVertexStride(builder._vertexFormat) +
+                                   indexCount * Divide::Model::getIndexStride(Divide::Model::getIndexType(vertexCount));
+
+        std::cout << "\tGPU memory: " << fullBytes << " -> " << cookedBytes << " bytes ("
+                  << 100.f * (fullBytes - cookedBytes) / std::max(fullBytes, size_t{ 1u }) << "% saved)" << std::endl;
+    }
+
+    int cook(const std::string& sourcePath, const std::string& outputPath) {
+        const auto startTime = Clock::now();
+
+        Divide::Model::ImportOptions options{};
+        options.optimize = true;
+        options.quantize = true;
+        options.lodCount = COOKED_LOD_COUNT;
+        options.buildMeshlets = true;
+
+        Divide::Model::Builder builder{};
+        builder.loadModel(sourcePath, options);
+
+        if (!Divide::CookedModelFile::write(outputPath, builder)) {
+            std::cerr << "Failed to write cooked mesh [ " << outputPath << " ]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "Cooked [ " << sourcePath << " ] -> [ " << outputPath << " ]: "
+                  << builder._vertices.size() << " vertices, "
+                  << builder._indices.size() << " indices, "
+                  << builder._meshlets.size() << " meshlets in " << elapsedMS(startTime) << " ms" << std::endl;
+        printVertexCacheStats("optimised", builder);
+        printLods(builder);
+        printMemorySavings(builder);
+        return EXIT_SUCCESS;
+    }
+
+    // Mirrors what Model does at runtime minus the GPU copy: get the vertex/index data into a staging-sized block
+    int load(const std::string& filePath) {
+        const auto startTime = Clock::now();
+
+        size_t vertexCount = 0u, indexCount = 0u;
+        std::vector<std::byte> staging{};
+
+        const bool isCooked = filePath.size() > std::strlen(Divide::CookedModelFile::FILE_EXTENSION) &&
+                              filePath.compare(filePath.size() - std::strlen(Divide::CookedModelFile::FILE_EXTENSION),
+                                               std::string::npos,
+                                               Divide::CookedModelFile::FILE_EXTENSION) == 0;
+        if (isCooked) {
+            Divide::CookedModelFile cookedFile{};
+            if (!cookedFile.open(filePath)) {
+                std::cerr << "Failed to open cooked mesh [ " << filePath << " ]" << std::endl;
+                return EXIT_FAILURE;
+            }
+            vertexCount = cookedFile.vertexCount();
+            indexCount = cookedFile.indexCount();
+
+            const size_t vertexBytes = cookedFile.vertexDataSize();
+            const size_t indexBytes = cookedFile.indexDataSize();
+            staging.resize(vertexBytes + indexBytes);
+            std::memcpy(staging.data(), cookedFile.vertexData(), vertexBytes);
+            std::memcpy(staging.data() + vertexBytes, cookedFile.indexData(), indexBytes);
+        } else {
+            Divide::Model::Builder builder{};
+            builder.loadModel(filePath);
+            vertexCount = builder._vertices.size();
+            indexCount = builder._indices.size();
+
+            const size_t vertexBytes = vertexCount * sizeof(Divide::Model::Vertex);
+            const size_t indexBytes = indexCount * sizeof(uint32_t);
+            staging.resize(vertexBytes + indexBytes);
+            std::memcpy(staging.data(), builder._vertices.data(), vertexBytes);
+            std::memcpy(staging.data() + vertexBytes, builder._indices.data(), indexBytes);
+        }
+
+        std::cout << "Loaded [ " << filePath << " ] (" << (isCooked ? "cooked" : "source") << "): "
+                  << vertexCount << " vertices, " << indexCount << " indices in " << elapsedMS(startTime) << " ms, "
+                  << "peak RSS " << Divide::getPeakResidentMemory() / 1024 << " KB" << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    int import(const std::string& sourcePath, const uint32_t threadCount) {
+        Divide::Model::ImportOptions singleThreaded{};
+        singleThreaded.threadCount = 1u;
+        // Always an explicit count: the automatic one stays single threaded on small meshes, which would compare the
+        // single threaded path against itself
+        Divide::Model::ImportOptions multiThreaded{};
+        multiThreaded.threadCount = threadCount > 0u ? threadCount : std::max(std::thread::hardware_concurrency(), 2u);
+
+        auto startTime = Clock::now();
+        Divide::Model::Builder reference{};
+        reference.loadModel(sourcePath, singleThreaded);
+        const float singleThreadedMS = elapsedMS(startTime);
+
+        startTime = Clock::now();
+        Divide::Model::Builder parallel{};
+        parallel.loadModel(sourcePath, multiThreaded);
+        const float multiThreadedMS = elapsedMS(startTime);
+
+        const bool identical = reference._vertices.size() == parallel._vertices.size() &&
+                               reference._indices == parallel._indices &&
+                               std::memcmp(reference._vertices.data(), parallel._vertices.data(), reference._vertices.size() * sizeof(Divide::Model::Vertex)) == 0;
+
+        std::cout << "Imported [ " << sourcePath << " ]: " << reference._vertices.size() << " vertices, " << reference._indices.size() << " indices" << std::endl
+                  << "\t1 thread: " << singleThreadedMS << " ms" << std::endl
+                  << "\t" << multiThreaded.threadCount << " threads: " << multiThreadedMS << " ms" << std::endl
+                  << "\toutput " << (identical ? "identical" : "DIFFERS") << std::endl;
+        return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int generate(const std::string& outputPath, const uint32_t gridSize) {
+        std::ofstream stream{ outputPath, std::ios::trunc };
+        if (!stream.is_open() || gridSize == 0u) {
+            std::cerr << "Failed to write [ " << outputPath << " ]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const uint32_t rowSize = gridSize + 1u;
+        for (uint32_t y = 0u; y < rowSize; ++y) {
+            for (uint32_t x = 0u; x < rowSize; ++x) {
+                const float u = static_cast<float>(x) / gridSize;
+                const float v = static_cast<float>(y) / gridSize;
+                stream << "v " << u * 2.f - 1.f << " " << 0.1f * std::sin(u * 20.f) * std::cos(v * 20.f) << " " << v * 2.f - 1.f << "\n";
+                stream << "vt " << u << " " << v << "\n";
+            }
+        }
+        stream << "vn 0 -1 0\n";
+
+        for (uint32_t y = 0u; y < gridSize; ++y) {
+            for (uint32_t x = 0u; x < gridSize; ++x) {
+                const uint32_t i0 = y * rowSize + x + 1u;
+                const uint32_t i1 = i0 + 1u;
+                const uint32_t i2 = i0 + rowSize;
+                const uint32_t i3 = i2 + 1u;
+                stream << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i1 << "/" << i1 << "/1\n";
+                stream << "f " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+            }
+        }
+
+        std::cout << "Generated [ " << outputPath << " ]: " << 2u * gridSize * gridSize << " triangles" << std::endl;
+        return stream.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Every triangle as its three vertices, rotated (winding preserved) so the smallest vertex comes first, then sorted.
+    // Two index buffers describe the same topology if and only if these lists match.
+    std::vector<std::array<Divide::Model::Vertex, 3>> getCanonicalTriangles(const Divide::Model::Builder& builder) {
+        const auto less = [](const Divide::Model::Vertex& lhs, const Divide::Model::Vertex& rhs) {
+            return std::memcmp(&lhs, &rhs, sizeof(Divide::Model::Vertex)) < 0;
+        };
+
+        std::vector<std::array<Divide::Model::Vertex, 3>> triangles(builder._indices.size() / 3);
+        for (size_t i = 0; i < triangles.size(); ++i) {
+            auto& triangle = triangles[i];
+            for (size_t j = 0; j < 3; ++j) {
+                triangle[j] = builder._vertices[builder._indices[i * 3 + j]];
+            }
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end(), less), triangle.end());
+        }
+
+        std::sort(triangles.begin(), triangles.end(), [&less](const auto& lhs, const auto& rhs) {
+            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), less);
+        });
+        return triangles;
+    }
+
+    int optimize(const std::string& sourcePath) {
+        Divide::Model::Builder builder{};
+        builder.loadModel(sourcePath);
+        const auto sourceTriangles = getCanonicalTriangles(builder);
+        const size_t sourceVertexCount = builder._vertices.size();
+
+        std::cout << "Optimising [ " << sourcePath << " ]: " << builder._vertices.size() << " vertices, " << builder._indices.size() / 3 << " triangles" << std::endl;
+        printVertexCacheStats("source", builder);
+
+        const auto startTime = Clock::now();
+        Divide::MeshOptimizer::optimizeVertexCache(builder._indices.data(), builder._indices.size(), builder._vertices.size());
+        const float vertexCacheMS = elapsedMS(startTime);
+        printVertexCacheStats("vertex cache", builder);
+
+        Divide::MeshOptimizer::optimizeOverdraw(builder._indices.data(), builder._indices.size(), builder._vertices.data(), builder._vertices.size());
+        printVertexCacheStats("overdraw", builder);
+
+        Divide::MeshOptimizer::optimizeVertexFetch(builder._vertices, builder._indices.data(), builder._indices.size());
+        const float totalMS = elapsedMS(startTime);
+        printVertexCacheStats("vertex fetch", builder);
+
+        const bool sameTopology = builder._vertices.size() == sourceVertexCount && getCanonicalTriangles(builder) == sourceTriangles;
+        std::cout << "\t" << vertexCacheMS << " ms vertex cache, " << totalMS << " ms total" << std::endl
+                  << "\ttopology " << (sameTopology ? "preserved" : "CHANGED") << std::endl;
+        return sameTopology ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    void printDedupStats(const char* name, const size_t vertexCount, const float durationMS, const size_t allocations) {
+        std::cout << "\t" << name << ": " << durationMS << " ms ("
+                  << (vertexCount / 1000.f) / std::max(durationMS, 1e-3f) << " M vertices/s), "
+                  << allocations << " allocations" << std::endl;
+    }
+
+    int dedup(const std::string& sourcePath) {
+        Divide::Model::Builder builder{};
+        builder.loadModel(sourcePath);
+
+        // Un-weld the mesh again so both paths see the same per-corner vertex stream loadModel does
+        std::vector<Divide::Model::Vertex> corners(builder._indices.size());
+        for (size_t i = 0; i < corners.size(); ++i) {
+            corners[i] = builder._vertices[builder._indices[i]];
+        }
+
+        std::vector<Divide::Model::Vertex> mapVertices{}, tableVertices{};
+        std::vector<uint32_t> mapIndices{}, tableIndices{};
+        mapIndices.reserve(corners.size());
+        tableIndices.reserve(corners.size());
+
+        size_t allocations = g_allocationCount.load();
+        auto startTime = Clock::now();
+        {
+            std::unordered_map<Divide::Model::Vertex, uint32_t> uniqueVertices{};
+            for (const auto& vertex : corners) {
+                if (uniqueVertices.count(vertex) == 0) {
+                    uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+                    mapVertices.push_back(vertex);
+                }
+                mapIndices.push_back(uniqueVertices[vertex]);
+            }
+        }
+        const float mapMS = elapsedMS(startTime);
+        const size_t mapAllocations = g_allocationCount.load() - allocations;
+
+        allocations = g_allocationCount.load();
+        startTime = Clock::now();
+        {
+            Divide::VertexHashTable uniqueVertices{ corners.size() };
+            for (const auto& vertex : corners) {
+                tableIndices.push_back(uniqueVertices.weld(vertex, tableVertices));
+            }
+        }
+        const float tableMS = elapsedMS(startTime);
+        const size_t tableAllocations = g_allocationCount.load() - allocations;
+
+        const bool identical = mapIndices == tableIndices &&
+                               mapVertices.size() == tableVertices.size() &&
+                               std::memcmp(mapVertices.data(), tableVertices.data(), mapVertices.size() * sizeof(Divide::Model::Vertex)) == 0;
+
+        std::cout << "Welded [ " << sourcePath << " ]: " << corners.size() << " corners -> " << tableVertices.size() << " vertices" << std::endl;
+        printDedupStats("std::unordered_map", corners.size(), mapMS, mapAllocations);
+        printDedupStats("VertexHashTable", corners.size(), tableMS, tableAllocations);
+        std::cout << "\toutput " << (identical ? "identical" : "DIFFERS") << std::endl;
+        return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Checks the invariants the renderer relies on: meshlets tile each LOD's index range in order, respect the
+    // size limits, their spheres contain their vertices and a cone only reports back facing when every triangle is.
+    bool validateMeshlets(const Divide::Model::Builder& builder, const std::vector<glm::vec3>& eyes) {
+        using Divide::Model;
+
+        size_t meshlet = 0u;
+        for (uint32_t lod = 0u; lod < builder._lods.size(); ++lod) {
+            uint32_t indexOffset = builder._lods[lod].indexOffset;
+            for (; meshlet < builder._meshlets.size() && builder._meshlets[meshlet].lod == lod; ++meshlet) {
+                const Model::Meshlet& data = builder._meshlets[meshlet];
+                const uint32_t* indices = builder._indices.data() + data.indexOffset;
+
+                std::vector<uint32_t> uniqueVertices(indices, indices + data.indexCount);
+                std::sort(uniqueVertices.begin(), uniqueVertices.end());
+                uniqueVertices.erase(std::unique(uniqueVertices.begin(), uniqueVertices.end()), uniqueVertices.end());
+
+                if (data.indexOffset != indexOffset ||
+                    data.indexCount == 0u ||
+                    data.indexCount > Model::MAX_MESHLET_TRIANGLES * 3u ||
+                    data.vertexCount > Model::MAX_MESHLET_VERTICES ||
+                    data.vertexCount != uniqueVertices.size())
+                {
+                    std::cerr << "\tmeshlet " << meshlet << " has an invalid range or exceeds the size limits" << std::endl;
+                    return false;
+                }
+                indexOffset += data.indexCount;
+
+                const glm::vec3 centre{ data.boundingSphere };
+                for (const uint32_t vertex : uniqueVertices) {
+                    if (glm::length(builder._vertices[vertex].position - centre) > data.boundingSphere.w * 1.0001f + 1e-6f) {
+                        std::cerr << "\tmeshlet " << meshlet << " bounding sphere misses a vertex" << std::endl;
+                        return false;
+                    }
+                }
+
+                for (const glm::vec3& eye : eyes) {
+                    if (!Model::isMeshletBackFacing(data, eye)) {
+                        continue;
+                    }
+                    for (uint32_t i = 0u; i < data.indexCount; i += 3u) {
+                        const glm::vec3& p0 = builder._vertices[indices[i + 0]].position;
+                        const glm::vec3& p1 = builder._vertices[indices[i + 1]].position;
+                        const glm::vec3& p2 = builder._vertices[indices[i + 2]].position;
+                        const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                        if (glm::dot(normal, p0 - eye) < -1e-5f * glm::length(normal) * glm::length(p0 - eye)) {
+                            std::cerr << "\tmeshlet " << meshlet << " cone culls a front facing triangle" << std::endl;
+                            return false;
+                        }
+                    }
+                }
+            }
+
+            if (indexOffset != builder._lods[lod].indexOffset + builder._lods[lod].indexCount) {
+                std::cerr << "\tLOD " << lod << " is not fully covered by its meshlets" << std::endl;
+                return false;
+            }
+        }
+
+        return meshlet == builder._meshlets.size();
+    }
+
+    int meshlets(const std::string& sourcePath) {
+        Divide::Model::ImportOptions options{};
+        options.optimize = true;
+        options.lodCount = COOKED_LOD_COUNT;
+
+        Divide::Model::Builder builder{};
+        builder.loadModel(sourcePath, options);
+        const auto sourceTriangles = getCanonicalTriangles(builder);
+
+        const auto startTime = Clock::now();
+        builder.buildMeshlets();
+        const float buildMS = elapsedMS(startTime);
+
+        // Views from all around the mesh at a few distances, seeded so runs are comparable
+        const glm::vec3 centre = (builder._boundsMin + builder._boundsMax) * 0.5f;
+        const float radius = std::max(glm::length(builder._boundsMax - builder._boundsMin) * 0.5f, 1e-3f);
+        std::mt19937 generator{ 1234u };
+        std::normal_distribution<float> distribution{};
+        std::vector<glm::vec3> eyes(256u);
+        for (size_t i = 0u; i < eyes.size(); ++i) {
+            glm::vec3 direction{ distribution(generator), distribution(generator), distribution(generator) };
+            direction /= std::max(glm::length(direction), 1e-6f);
+            eyes[i] = centre + direction * radius * (1.5f + static_cast<float>(i % 4u) * 2.f);
+        }
+
+        std::cout << "Meshlets for [ " << sourcePath << " ] built in " << buildMS << " ms" << std::endl;
+
+        size_t meshlet = 0u;
+        for (uint32_t lod = 0u; lod < builder._lods.size(); ++lod) {
+            size_t count = 0u, vertexFill = 0u, triangleFill = 0u, cones = 0u, culled = 0u;
+            float coneAngle = 0.f;
+            for (; meshlet < builder._meshlets.size() && builder._meshlets[meshlet].lod == lod; ++meshlet, ++count) {
+                const auto& data = builder._meshlets[meshlet];
+                vertexFill += data.vertexCount;
+                triangleFill += data.indexCount / 3u;
+                if (data.coneAxisCutoff.w <= 1.f) {
+                    ++cones;
+                    coneAngle += std::asin(data.coneAxisCutoff.w);
+                }
+                for (const glm::vec3& eye : eyes) {
+                    culled += Divide::Model::isMeshletBackFacing(data, eye) ? 1u : 0u;
+                }
+            }
+
+            const float meshletCount = static_cast<float>(std::max(count, size_t{ 1u }));
+            std::cout << "\tLOD " << lod << ": " << count << " meshlets, "
+                      << 100.f * vertexFill / (meshletCount * Divide::Model::MAX_MESHLET_VERTICES) << "% vertex fill, "
+                      << 100.f * triangleFill / (meshletCount * Divide::Model::MAX_MESHLET_TRIANGLES) << "% triangle fill, "
+                      << 100.f * cones / meshletCount << "% with a cone (avg half angle "
+                      << (cones > 0u ? glm::degrees(coneAngle / cones) : 0.f) << " deg), "
+                      << 100.f * culled / (meshletCount * eyes.size()) << "% back facing per view" << std::endl;
+        }
+
+        const bool valid = getCanonicalTriangles(builder) == sourceTriangles && validateMeshlets(builder, eyes);
+        std::cout << "\tmeshlets " << (valid ? "valid" : "INVALID") << std::endl;
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Plain heap standing in for vkAllocateMemory so MemoryAllocator can be exercised without a device
+    class HeapMemoryBackend final : public Divide::DeviceMemoryBackend {
+    public:
+        explicit HeapMemoryBackend(const VkDeviceSize heapSize) : _heapSize(heapSize) {}
+
+        VkDeviceMemory allocate(const uint32_t memoryTypeIndex, const VkDeviceSize size) override {
+            (void)memoryTypeIndex;
+            if (_usedBytes + size > _heapSize) {
+                return VK_NULL_HANDLE;
+            }
+
+            // Left uninitialised so untouched pages are never committed
+            std::unique_ptr<std::byte[]> memory{ new std::byte[size] };
+            const VkDeviceMemory handle = reinterpret_cast<VkDeviceMemory>(memory.get());
+            _allocations[handle] = std::move(memory);
+            _usedBytes += size;
+            _sizes[handle] = size;
+            ++_allocateCalls;
+            return handle;
+        }
+
+        void free(VkDeviceMemory memory) override {
+            _usedBytes -= _sizes.at(memory);
+            _sizes.erase(memory);
+            _allocations.erase(memory);
+        }
+
+        void* map(VkDeviceMemory memory) override {
+            return _allocations.at(memory).get();
+        }
+
+        [[nodiscard]] size_t getLiveAllocationCount() const { return _allocations.size(); }
+        [[nodiscard]] size_t getAllocateCalls() const { return _allocateCalls; }
+        [[nodiscard]] VkDeviceSize getSize(VkDeviceMemory memory) const { return _sizes.at(memory); }
+
+    private:
+        const VkDeviceSize _heapSize;
+        VkDeviceSize _usedBytes = 0u;
+        size_t _allocateCalls = 0u;
+        std::map<VkDeviceMemory, std::unique_ptr<std::byte[]>> _allocations{};
+        std::map<VkDeviceMemory, VkDeviceSize> _sizes{};
+    };
+
+    struct LiveAllocation {
+        Divide::MemoryAllocation _allocation{};
+        VkDeviceSize _alignment = 1u;
+    };
+
+    bool validateAllocations(const std::vector<LiveAllocation>& live, const HeapMemoryBackend& backend, const VkDeviceSize nonCoherentAtomSize) {
+        std::map<VkDeviceMemory, std::vector<std::pair<VkDeviceSize, VkDeviceSize>>> ranges{};
+        for (const LiveAllocation& entry : live) {
+            const Divide::MemoryAllocation& allocation = entry._allocation;
+            const bool nonCoherent = allocation.memoryTypeIndex == 1u;
+            if (allocation.offset % entry._alignment != 0u ||
+                (nonCoherent && allocation.offset % nonCoherentAtomSize != 0u) ||
+                allocation.offset + allocation.size > backend.getSize(allocation.memory) ||
+                (nonCoherent && allocation.mapped != static_cast<const void*>(reinterpret_cast<const std::byte*>(allocation.memory) + allocation.offset)))
+            {
+                std::cerr << "\tallocation at offset " << allocation.offset << " breaks alignment, bounds or mapping" << std::endl;
+                return false;
+            }
+            ranges[allocation.memory].emplace_back(allocation.offset, allocation.offset + allocation.size);
+        }
+
+        for (auto& [memory, memoryRanges] : ranges) {
+            std::sort(memoryRanges.begin(), memoryRanges.end());
+            for (size_t i = 1u; i < memoryRanges.size(); ++i) {
+                if (memoryRanges[i].first < memoryRanges[i - 1u].second) {
+                    std::cerr << "\toverlapping allocations at offset " << memoryRanges[i].first << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void printAllocatorStats(const char* name, const Divide::MemoryAllocator::Stats& stats) {
+        std::cout << "\t" << name << ": " << stats.allocationCount << " allocations in " << stats.blockCount << " blocks + "
+                  << stats.dedicatedAllocationCount << " dedicated, " << (stats.usedBytes >> 20) << " / " << (stats.reservedBytes >> 20)
+                  << " MB used, " << (stats.roundingBytes >> 10) << " KB rounding, fragmentation " << stats.fragmentation << std::endl;
+    }
+
+    int allocator(const size_t operationCount) {
+        // Type 0: device local. Type 1: host visible but not coherent, so allocations must be atom aligned.
+        constexpr VkDeviceSize NON_COHERENT_ATOM_SIZE = 64u;
+        constexpr VkDeviceSize HEAP_SIZE = VkDeviceSize{ 2u } << 30;
+
+        HeapMemoryBackend backend{ HEAP_SIZE };
+        std::vector<LiveAllocation> live{};
+        bool valid = true;
+        size_t allocationCount = 0u;
+        Divide::MemoryAllocator::Stats peakStats{};
+        float elapsed = 0.f;
+        {
+            Divide::MemoryAllocator allocator{ backend,
+                                               { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT },
+                                               NON_COHERENT_ATOM_SIZE };
+
+            std::mt19937 generator{ 1234u };
+            std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+            const auto startTime = Clock::now();
+            for (size_t i = 0u; i < operationCount && valid; ++i) {
+                // Grow towards ~2000 live resources, then churn around that
+                const bool allocate = live.empty() || unit(generator) < (live.size() < 2000u ? 0.7f : 0.5f);
+                if (allocate) {
+                    // Log-uniform sizes between 256 B and 2 MB, plus the odd very large resource that should go dedicated
+                    VkMemoryRequirements requirements{};
+                    requirements.size = unit(generator) < 0.002f ? VkDeviceSize{ 48u } << 20 : static_cast<VkDeviceSize>(std::exp2(8.f + unit(generator) * 13.f));
+                    requirements.alignment = VkDeviceSize{ 1u } << static_cast<uint32_t>(unit(generator) * 13.f);
+                    requirements.memoryTypeBits = 0x3u;
+
+                    const uint32_t memoryTypeIndex = unit(generator) < 0.3f ? 1u : 0u;
+                    const auto tiling = memoryTypeIndex == 0u && unit(generator) < 0.3f ? Divide::ResourceTiling::OPTIMAL : Divide::ResourceTiling::LINEAR;
+
+                    live.push_back({ allocator.allocate(requirements, memoryTypeIndex, tiling), requirements.alignment });
+                    ++allocationCount;
+                } else {
+                    const size_t index = static_cast<size_t>(unit(generator) * live.size()) % live.size();
+                    allocator.free(live[index]._allocation);
+                    live[index] = live.back();
+                    live.pop_back();
+                }
+
+                if (live.size() > peakStats.allocationCount) {
+                    peakStats = allocator.getStats();
+                }
+                if (i % 1000u == 0u) {
+                    valid = validateAllocations(live, backend, NON_COHERENT_ATOM_SIZE);
+                }
+            }
+            elapsed = elapsedMS(startTime);
+            valid = valid && validateAllocations(live, backend, NON_COHERENT_ATOM_SIZE);
+
+            std::cout << "Allocator stress test: " << operationCount << " operations, " << allocationCount << " allocations in " << elapsed << " ms" << std::endl;
+            printAllocatorStats("peak", peakStats);
+            printAllocatorStats("final", allocator.getStats());
+            std::cout << "\tdriver allocations: " << backend.getAllocateCalls() << " (one per resource would be " << allocationCount << ")" << std::endl;
+
+            for (LiveAllocation& entry : live) {
+                allocator.free(entry._allocation);
+            }
+            const Divide::MemoryAllocator::Stats emptyStats = allocator.getStats();
+            valid = valid && emptyStats.allocationCount == 0u && emptyStats.usedBytes == 0u;
+        }
+
+        valid = valid && backend.getLiveAllocationCount() == 0u;
+        std::cout << "\tallocator " << (valid ? "valid" : "INVALID") << std::endl;
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int cull(const uint32_t objectCount) {
+        constexpr uint32_t ITERATIONS = 200u;
+
+        // Objects scattered all around the camera: most are culled, with plenty straddling the planes
+        std::mt19937 generator{ 1234u };
+        std::uniform_real_distribution<float> position{ -100.f, 100.f };
+        std::uniform_real_distribution<float> radius{ 0.1f, 4.f };
+
+        Divide::FrustumCuller culler{};
+        culler.reserve(objectCount);
+        for (uint32_t i = 0u; i < objectCount; ++i) {
+            culler.addSphere({ position(generator), position(generator), position(generator), radius(generator) });
+        }
+
+        Divide::Camera camera{};
+        camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.01f, 100.f);
+        camera.setViewYXZ({ 0.f, 0.f, -20.f }, { 0.f, 0.3f, 0.f });
+        const Divide::FrustumPlanes planes = camera.getFrustumPlanes();
+
+        std::vector<uint32_t> reference{};
+        culler.cull(planes, reference, Divide::FrustumCuller::Path::SCALAR);
+        std::cout << "Frustum culling " << objectCount << " objects: " << reference.size() << " visible, "
+                  << objectCount - reference.size() << " culled" << std::endl;
+
+        bool valid = true;
+        std::vector<uint32_t> visible{};
+        for (uint8_t i = 0u; i < static_cast<uint8_t>(Divide::FrustumCuller::Path::COUNT); ++i) {
+            const auto path = static_cast<Divide::FrustumCuller::Path>(i);
+            if (!Divide::FrustumCuller::isSupported(path)) {
+                std::cout << "\t" << Divide::FrustumCuller::getPathName(path) << ": not available in this build" << std::endl;
+                continue;
+            }
+
+            const auto startTime = Clock::now();
+            for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+                culler.cull(planes, visible, path);
+            }
+            const float elapsed = elapsedMS(startTime) / ITERATIONS;
+
+            const bool matches = visible == reference;
+            valid = valid && matches;
+            std::cout << "\t" << Divide::FrustumCuller::getPathName(path) << ": " << elapsed << " ms, "
+                      << static_cast<uint64_t>(objectCount / std::max(elapsed, 1e-6f)) << " objects/ms"
+                      << (matches ? "" : " (MISMATCH against scalar)") << std::endl;
+        }
+
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int occlusion(const uint32_t objectCount) {
+        constexpr uint32_t ITERATIONS = 100u;
+        constexpr uint32_t WIDTH = 320u;
+        constexpr uint32_t HEIGHT = 192u;
+
+        // [-1, 1] cube: corner i has x, y and z set by bits 0, 1 and 2
+        std::array<glm::vec3, 8> cubePositions{};
+        for (uint32_t i = 0u; i < 8u; ++i) {
+            cubePositions[i] = { (i & 1u) ? 1.f : -1.f, (i & 2u) ? 1.f : -1.f, (i & 4u) ? 1.f : -1.f };
+        }
+        constexpr uint32_t CUBE_FACES[6][4] = { { 0, 2, 6, 4 }, { 1, 5, 7, 3 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 1, 3, 2 }, { 4, 6, 7, 5 } };
+        std::vector<uint32_t> cubeIndices{};
+        for (const auto& face : CUBE_FACES) {
+            cubeIndices.insert(cubeIndices.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+        }
+
+        // A wall with a gap in the middle, and pillars in front of it. Nothing is occluded closer than OCCLUDER_MIN_Z.
+        constexpr float OCCLUDER_MIN_Z = -5.5f;
+        std::vector<glm::mat4> occluders{};
+        occluders.push_back(glm::scale(glm::translate(glm::mat4{ 1.f }, { -7.f, 0.f, 0.f }), { 6.f, 6.f, .25f }));
+        occluders.push_back(glm::scale(glm::translate(glm::mat4{ 1.f }, { 7.f, 0.f, 0.f }), { 6.f, 6.f, .25f }));
+        for (uint32_t i = 0u; i < 4u; ++i) {
+            occluders.push_back(glm::scale(glm::translate(glm::mat4{ 1.f }, { -6.f + 4.f * i, 0.f, -5.f }), { .5f, 6.f, .5f }));
+        }
+
+        // Boxes on both sides of the wall. Only the ones in the frustum get tested, like at runtime.
+        std::mt19937 generator{ 1234u };
+        std::uniform_real_distribution<float> positionX{ -20.f, 20.f };
+        std::uniform_real_distribution<float> positionY{ -10.f, 10.f };
+        std::uniform_real_distribution<float> positionZ{ -15.f, 40.f };
+        std::uniform_real_distribution<float> halfExtent{ .1f, 1.5f };
+
+        std::vector<std::pair<glm::vec3, glm::vec3>> boxes{};
+        Divide::FrustumCuller culler{};
+        culler.reserve(objectCount);
+        for (uint32_t i = 0u; i < objectCount; ++i) {
+            const glm::vec3 centre{ positionX(generator), positionY(generator), positionZ(generator) };
+            const glm::vec3 extent{ halfExtent(generator), halfExtent(generator), halfExtent(generator) };
+            boxes.emplace_back(centre - extent, centre + extent);
+            culler.addSphere({ centre, glm::length(extent) });
+        }
+
+        Divide::Camera camera{};
+        camera.setPerspectiveProjection(glm::radians(50.f), static_cast<float>(WIDTH) / HEIGHT, 0.1f, 100.f);
+        camera.setViewYXZ({ 0.f, 0.f, -20.f }, { 0.f, 0.f, 0.f });
+        const glm::mat4 viewProjection = camera.getProjection() * camera.getView();
+
+        std::vector<uint32_t> candidates{};
+        culler.cull(camera.getFrustumPlanes(), candidates);
+
+        const auto render = [&](Divide::OcclusionRasterizer& rasterizer, const Divide::OcclusionRasterizer::Path path) {
+            rasterizer.beginFrame(viewProjection);
+            for (const glm::mat4& occluder : occluders) {
+                rasterizer.addOccluder(occluder, cubePositions.data(), cubeIndices.data(), static_cast<uint32_t>(cubeIndices.size()));
+            }
+            rasterizer.rasterize(path);
+        };
+        const auto test = [&](const Divide::OcclusionRasterizer& rasterizer, const Divide::OcclusionRasterizer::Path path, std::vector<uint32_t>& occluded) {
+            occluded.clear();
+            for (const uint32_t candidate : candidates) {
+                if (rasterizer.isOccluded(boxes[candidate].first, boxes[candidate].second, glm::mat4{ 1.f }, path)) {
+                    occluded.push_back(candidate);
+                }
+            }
+        };
+
+        // Scalar and single threaded is the reference every other configuration has to match exactly
+        Divide::OcclusionRasterizer reference{ WIDTH, HEIGHT, 1u };
+        render(reference, Divide::OcclusionRasterizer::Path::SCALAR);
+        std::vector<uint32_t> referenceOccluded{};
+        test(reference, Divide::OcclusionRasterizer::Path::SCALAR, referenceOccluded);
+
+        // Conservativeness: nothing in front of every occluder can be hidden
+        bool valid = true;
+        for (const uint32_t candidate : referenceOccluded) {
+            if (boxes[candidate].second.z < OCCLUDER_MIN_Z) {
+                valid = false;
+                std::cout << "\tbox " << candidate << " is in front of every occluder but was reported occluded" << std::endl;
+            }
+        }
+
+        const Divide::OcclusionRasterizer::Stats& stats = reference.getStats();
+        std::cout << "Occlusion culling " << objectCount << " objects at " << reference.getWidth() << "x" << reference.getHeight() << ": "
+                  << candidates.size() << " in the frustum, " << referenceOccluded.size() << " occluded by " << stats.occluders << " occluders ("
+                  << stats.rasterizedTriangles << " / " << stats.triangles << " triangles rasterised, " << stats.binnedTriangles << " binned)" << std::endl;
+
+        std::vector<uint32_t> occluded{};
+        for (uint8_t i = 0u; i < static_cast<uint8_t>(Divide::OcclusionRasterizer::Path::COUNT); ++i) {
+            const auto path = static_cast<Divide::OcclusionRasterizer::Path>(i);
+            if (!Divide::OcclusionRasterizer::isSupported(path)) {
+                std::cout << "\t" << Divide::OcclusionRasterizer::getPathName(path) << ": not available in this build" << std::endl;
+                continue;
+            }
+
+            for (const uint32_t threadCount : { 1u, 0u }) {
+                Divide::OcclusionRasterizer rasterizer{ WIDTH, HEIGHT, threadCount };
+
+                auto startTime = Clock::now();
+                for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+                    render(rasterizer, path);
+                }
+                const float rasterizeMS = elapsedMS(startTime) / ITERATIONS;
+
+                startTime = Clock::now();
+                for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+                    test(rasterizer, path, occluded);
+                }
+                const float testMS = elapsedMS(startTime) / ITERATIONS;
+
+                const bool matches = rasterizer.getDepthBuffer() == reference.getDepthBuffer() && occluded == referenceOccluded;
+                valid = valid && matches;
+                std::cout << "\t" << Divide::OcclusionRasterizer::getPathName(path) << ", " << rasterizer.getThreadCount() << " thread(s): rasterise "
+                          << rasterizeMS << " ms, test " << testMS << " ms (" << static_cast<uint64_t>(candidates.size() / std::max(testMS, 1e-6f)) << " boxes/ms)"
+                          << (matches ? "" : " (MISMATCH against scalar)") << std::endl;
+            }
+        }
+
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int lights(const uint32_t lightCount) {
+        constexpr uint32_t ITERATIONS = 100u;
+        constexpr uint32_t SAMPLE_COUNT = 100000u;
+        constexpr float FAR_PLANE = 100.f;
+
+        // Small lights scattered all around the camera, like the ones placed in a level
+        std::mt19937 generator{ 1234u };
+        std::uniform_real_distribution<float> positionX{ -20.f, 20.f };
+        std::uniform_real_distribution<float> positionY{ -10.f, 10.f };
+        std::uniform_real_distribution<float> positionZ{ -25.f, 40.f };
+        std::uniform_real_distribution<float> range{ .5f, 3.f };
+
+        std::vector<glm::vec4> spheres{};
+        for (uint32_t i = 0u; i < lightCount; ++i) {
+            spheres.emplace_back(positionX(generator), positionY(generator), positionZ(generator), range(generator));
+        }
+
+        Divide::Camera camera{};
+        camera.setPerspectiveProjection(glm::radians(50.f), 16.f / 9.f, 0.01f, FAR_PLANE);
+        camera.setViewYXZ({ 0.f, 0.f, -20.f }, { 0.f, 0.f, 0.f });
+
+        Divide::LightClusters clusters{};
+        clusters.build(camera.getView(), camera.getProjection(), spheres.data(), lightCount);
+
+        const auto startTime = Clock::now();
+        for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+            clusters.build(camera.getView(), camera.getProjection(), spheres.data(), lightCount);
+        }
+        const float buildMS = elapsedMS(startTime) / ITERATIONS;
+
+        const Divide::LightClusters::Stats& stats = clusters.getStats();
+        std::cout << "Clustering " << lightCount << " lights into " << Divide::LightClusters::GRID_X << "x" << Divide::LightClusters::GRID_Y << "x"
+                  << Divide::LightClusters::GRID_Z << " clusters: " << buildMS << " ms, " << stats.visibleLights << " in view, "
+                  << stats.occupiedClusters << " / " << Divide::LightClusters::CLUSTER_COUNT << " clusters occupied, " << stats.lightIndices
+                  << " light indices (" << clusters.getClusterData().size() * sizeof(uint32_t) / 1024 << " KB), at most " << stats.maxLightsPerCluster
+                  << " per cluster" << std::endl;
+
+        // Points throughout the frustum: every light that reaches one must be in its cluster's list
+        std::uniform_real_distribution<float> ndc{ -1.f, 1.f };
+        std::uniform_real_distribution<float> depth{ 0.01f, 60.f };
+        const glm::mat4& projection = camera.getProjection();
+        const std::vector<uint32_t>& clusterData = clusters.getClusterData();
+        uint64_t listedLights = 0u;
+        uint64_t reachingLights = 0u;
+        uint32_t missingLights = 0u;
+        for (uint32_t sample = 0u; sample < SAMPLE_COUNT; ++sample) {
+            const float z = depth(generator);
+            const glm::vec3 viewPosition{ ndc(generator) * z / projection[0][0], ndc(generator) * z / projection[1][1], z };
+            const glm::vec3 worldPosition = glm::vec3(camera.getInverseView() * glm::vec4(viewPosition, 1.f));
+
+            const uint32_t cluster = clusters.findCluster(viewPosition);
+            const uint32_t* first = clusterData.data() + clusterData[2u * cluster];
+            const uint32_t* last = first + clusterData[2u * cluster + 1u];
+            listedLights += clusterData[2u * cluster + 1u];
+            for (uint32_t i = 0u; i < lightCount; ++i) {
+                const glm::vec3 offset = glm::vec3(spheres[i]) - worldPosition;
+                // Right at the range the light contributes nothing, so rounding there doesn't matter
+                if (glm::dot(offset, offset) < spheres[i].w * spheres[i].w * 0.999f) {
+                    reachingLights += 1u;
+                    if (!std::binary_search(first, last, i)) {
+                        missingLights += 1u;
+                    }
+                }
+            }
+        }
+
+        std::cout << "\tper sample point: " << static_cast<float>(listedLights) / SAMPLE_COUNT << " lights listed, "
+                  << static_cast<float>(reachingLights) / SAMPLE_COUNT << " reaching it, " << lightCount << " without clustering" << std::endl;
+        std::cout << "\tcluster lists " << (missingLights == 0u ? "valid" : "INVALID") << " (" << missingLights << " missing lights)" << std::endl;
+        return missingLights == 0u ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int sort(const uint32_t keyCount) {
+        constexpr uint32_t ITERATIONS = 20u;
+        constexpr uint32_t THRESHOLD = Divide::RadixSort::INSERTION_SORT_THRESHOLD;
+
+        std::mt19937_64 generator{ 1234u };
+        const auto randomKeys = [&generator](const uint32_t count, const uint64_t mask, const uint64_t fixedBits) {
+            std::vector<uint64_t> keys(count);
+            for (uint64_t& key : keys) {
+                key = (generator() & mask) | fixedBits;
+            }
+            return keys;
+        };
+
+        struct Case {
+            const char* name;
+            std::vector<uint64_t> keys;
+        };
+        // Narrow masks give plenty of equal keys (stability) and digits shared by every key (skipped passes). One and
+        // three varying digits leave the result in the scratch buffer, so it has to be copied back.
+        const Case cases[] = {
+            { "random", randomKeys(keyCount, ~uint64_t{ 0u }, 0u) },
+            { "shared high bytes", randomKeys(keyCount, 0xFFFFu, 0xABCD'EF01'2300'0000u) },
+            { "one digit", randomKeys(keyCount, 0xFFu, 0x5500'0000'0000'0000u) },
+            { "three digits", randomKeys(keyCount, 0xFF'00FF'00FFu, 0u) },
+            { "all equal", randomKeys(keyCount, 0u, 42u) },
+            { "below threshold", randomKeys(THRESHOLD - 1u, 0xFFu, 0u) },
+            { "at threshold", randomKeys(THRESHOLD, 0xFFu, 0u) },
+            { "above threshold", randomKeys(THRESHOLD + 1u, 0xFFu, 0u) },
+            { "empty", {} },
+        };
+
+        std::cout << "Sorting " << keyCount << " keys" << std::endl;
+
+        bool valid = true;
+        Divide::RadixSort radixSort{};
+        for (const Case& sortCase : cases) {
+            const uint32_t count = static_cast<uint32_t>(sortCase.keys.size());
+
+            // Values are the original positions, so the reference order also pins down stability
+            std::vector<std::pair<uint64_t, uint32_t>> reference(count);
+            for (uint32_t i = 0u; i < count; ++i) {
+                reference[i] = { sortCase.keys[i], i };
+            }
+            std::stable_sort(reference.begin(), reference.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+            std::vector<uint64_t> keys = sortCase.keys;
+            std::vector<uint32_t> values(count);
+            for (uint32_t i = 0u; i < count; ++i) {
+                values[i] = i;
+            }
+            radixSort.sort(keys.data(), values.data(), count);
+
+            std::vector<uint64_t> keysOnly = sortCase.keys;
+            radixSort.sort(keysOnly.data(), nullptr, count);
+
+            bool matches = keys == keysOnly;
+            for (uint32_t i = 0u; i < count && matches; ++i) {
+                matches = keys[i] == reference[i].first && values[i] == reference[i].second;
+            }
+            valid = valid && matches;
+            std::cout << "\t" << sortCase.name << " (" << count << " keys): " << (matches ? "valid" : "MISMATCH against std::stable_sort") << std::endl;
+        }
+
+        // Timed on the random keys, with the values the render queue sorts along
+        const std::vector<uint64_t>& source = cases[0].keys;
+        std::vector<uint64_t> keys{};
+        std::vector<uint32_t> values(keyCount);
+
+        float radixMS = 0.f;
+        for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+            keys = source;
+            const auto startTime = Clock::now();
+            radixSort.sort(keys.data(), values.data(), keyCount);
+            radixMS += elapsedMS(startTime);
+        }
+
+        float stableSortMS = 0.f;
+        std::vector<std::pair<uint64_t, uint32_t>> pairs(keyCount);
+        for (uint32_t iteration = 0u; iteration < ITERATIONS; ++iteration) {
+            for (uint32_t i = 0u; i < keyCount; ++i) {
+                pairs[i] = { source[i], i };
+            }
+            const auto startTime = Clock::now();
+            std::stable_sort(pairs.begin(), pairs.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+            stableSortMS += elapsedMS(startTime);
+        }
+
+        std::cout << "\tRadixSort: " << radixMS / ITERATIONS << " ms, std::stable_sort: " << stableSortMS / ITERATIONS << " ms" << std::endl;
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string command = argv[1];
+    try {
+        if (command == "cook" && argc == 4) {
+            return cook(argv[2], argv[3]);
+        }
+        if (command == "load" && argc == 3) {
+            return load(argv[2]);
+        }
+        if (command == "import" && (argc == 3 || argc == 4)) {
+            return import(argv[2], argc == 4 ? static_cast<uint32_t>(std::stoul(argv[3])) : 0u);
+        }
+        if (command == "generate" && argc == 4) {
+            return generate(argv[2], static_cast<uint32_t>(std::stoul(argv[3])));
+        }
+        if (command == "optimize" && argc == 3) {
+            return optimize(argv[2]);
+        }
+        if (command == "dedup" && argc == 3) {
+            return dedup(argv[2]);
+        }
+        if (command == "meshlets" && argc == 3) {
+            return meshlets(argv[2]);
+        }
+        if (command == "allocator" && (argc == 2 || argc == 3)) {
+            return allocator(argc == 3 ? std::stoul(argv[2]) : 100000u);
+        }
+        if (command == "cull" && (argc == 2 || argc == 3)) {
+            return cull(argc == 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 100000u);
+        }
+        if (command == "occlusion" && (argc == 2 || argc == 3)) {
+            return occlusion(argc == 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 10000u);
+        }
+        if (command == "lights" && (argc == 2 || argc == 3)) {
+            return lights(argc == 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4000u);
+        }
+        if (command == "sort" && (argc == 2 || argc == 3)) {
+            return sort(argc == 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 100000u);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    printUsage();
+    return EXIT_FAILURE;
+}